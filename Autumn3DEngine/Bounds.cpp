@@ -0,0 +1,157 @@
+#include "Bounds.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+void Bounds::Merge(const Bounds& other)
+{
+    if (other.IsEmpty())
+        return;
+    if (IsEmpty())
+    {
+        *this = other;
+        return;
+    }
+
+    // The merged sphere keeps the box centre, so it has to reach the far side of both spheres from there
+    const glm::vec3 center = GetCenter(), otherCenter = other.GetCenter();
+    m_Min = glm::min(m_Min, other.m_Min);
+    m_Max = glm::max(m_Max, other.m_Max);
+    const glm::vec3 mergedCenter = GetCenter();
+    const float radius = std::max(glm::length(center - mergedCenter) + m_Radius, glm::length(otherCenter - mergedCenter) + other.m_Radius);
+
+    // The sphere through the corners of the merged box is never beaten by a looser one
+    m_Radius = std::min(radius, glm::length(GetExtents()));
+}
+
+Bounds Bounds::Transform(const glm::mat4& matrix) const
+{
+    if (IsEmpty())
+        return *this;
+
+    // Arvo: the transformed extents are the absolute rotation-scale part times the extents
+    const glm::vec3 center = glm::vec3(matrix * glm::vec4(GetCenter(), 1.0f));
+    const glm::vec3 extents = GetExtents();
+    const glm::mat3 linear(matrix);
+    const glm::vec3 transformedExtents = glm::abs(linear[0]) * extents.x + glm::abs(linear[1]) * extents.y + glm::abs(linear[2]) * extents.z;
+
+    Bounds result;
+    result.m_Min = center - transformedExtents;
+    result.m_Max = center + transformedExtents;
+    const float scale = std::max(glm::length(linear[0]), std::max(glm::length(linear[1]), glm::length(linear[2])));
+    result.m_Radius = std::min(m_Radius * scale, glm::length(transformedExtents));
+    return result;
+}
+
+Bounds Bounds::FromBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    Bounds bounds;
+    bounds.m_Min = boundsMin;
+    bounds.m_Max = boundsMax;
+    bounds.m_Radius = bounds.IsEmpty() ? 0.0f : glm::length(bounds.GetExtents());
+    return bounds;
+}
+
+Bounds Bounds::FromPositions(const void* positions, size_t count, size_t stride)
+{
+    Bounds bounds;
+    if (count == 0)
+        return bounds;
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(positions);
+    auto position = [bytes, stride](size_t i) { return reinterpret_cast<const float*>(bytes + i * stride); };
+
+    // Vector loads read one float past the position, which stays inside the data while another position follows it
+    const size_t vectorCount = stride >= 4 * sizeof(float) ? count - 1 : 0;
+    float radiusSquared = 0.0f;
+
+#if defined(AUTUMN3D_SIMD_SSE2)
+
+    __m128 lower = _mm_set1_ps(std::numeric_limits<float>::max());
+    __m128 upper = _mm_set1_ps(-std::numeric_limits<float>::max());
+    for (size_t i = 0; i < vectorCount; ++i)
+    {
+        const __m128 p = _mm_loadu_ps(position(i));
+        lower = _mm_min_ps(lower, p);
+        upper = _mm_max_ps(upper, p);
+    }
+
+    float lowerLanes[4], upperLanes[4];
+    _mm_storeu_ps(lowerLanes, lower);
+    _mm_storeu_ps(upperLanes, upper);
+    bounds.m_Min = glm::vec3(lowerLanes[0], lowerLanes[1], lowerLanes[2]);
+    bounds.m_Max = glm::vec3(upperLanes[0], upperLanes[1], upperLanes[2]);
+
+#elif defined(AUTUMN3D_SIMD_NEON)
+
+    float32x4_t lower = vdupq_n_f32(std::numeric_limits<float>::max());
+    float32x4_t upper = vdupq_n_f32(-std::numeric_limits<float>::max());
+    for (size_t i = 0; i < vectorCount; ++i)
+    {
+        const float32x4_t p = vld1q_f32(position(i));
+        lower = vminq_f32(lower, p);
+        upper = vmaxq_f32(upper, p);
+    }
+
+    bounds.m_Min = glm::vec3(vgetq_lane_f32(lower, 0), vgetq_lane_f32(lower, 1), vgetq_lane_f32(lower, 2));
+    bounds.m_Max = glm::vec3(vgetq_lane_f32(upper, 0), vgetq_lane_f32(upper, 1), vgetq_lane_f32(upper, 2));
+
+#endif
+
+    // Whatever the vector loop did not cover, including the last position
+#if defined(AUTUMN3D_SIMD_SSE2) || defined(AUTUMN3D_SIMD_NEON)
+    const size_t scalarStart = vectorCount;
+#else
+    const size_t scalarStart = 0;
+#endif
+    for (size_t i = scalarStart; i < count; ++i)
+    {
+        const glm::vec3 p(position(i)[0], position(i)[1], position(i)[2]);
+        bounds.m_Min = glm::min(bounds.m_Min, p);
+        bounds.m_Max = glm::max(bounds.m_Max, p);
+    }
+
+    // Second pass: the farthest position from the box centre
+    const glm::vec3 center = bounds.GetCenter();
+
+#if defined(AUTUMN3D_SIMD_SSE2)
+
+    const __m128 center4 = _mm_setr_ps(center.x, center.y, center.z, 0.0f);
+    const __m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    __m128 farthest = _mm_setzero_ps();
+    for (size_t i = 0; i < vectorCount; ++i)
+    {
+        __m128 offset = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(position(i)), center4), xyzMask);
+        offset = _mm_mul_ps(offset, offset);
+        offset = _mm_add_ps(offset, _mm_shuffle_ps(offset, offset, _MM_SHUFFLE(2, 3, 0, 1)));
+        offset = _mm_add_ps(offset, _mm_shuffle_ps(offset, offset, _MM_SHUFFLE(1, 0, 3, 2)));
+        farthest = _mm_max_ss(farthest, offset);
+    }
+    radiusSquared = _mm_cvtss_f32(farthest);
+
+#elif defined(AUTUMN3D_SIMD_NEON)
+
+    const float32x4_t center4 = { center.x, center.y, center.z, 0.0f };
+    float32x2_t farthest = vdup_n_f32(0.0f);
+    for (size_t i = 0; i < vectorCount; ++i)
+    {
+        float32x4_t offset = vsetq_lane_f32(0.0f, vsubq_f32(vld1q_f32(position(i)), center4), 3);
+        offset = vmulq_f32(offset, offset);
+        float32x2_t sum = vpadd_f32(vget_low_f32(offset), vget_high_f32(offset));
+        sum = vpadd_f32(sum, sum);
+        farthest = vmax_f32(farthest, sum);
+    }
+    radiusSquared = vget_lane_f32(farthest, 0);
+
+#endif
+
+    for (size_t i = scalarStart; i < count; ++i)
+    {
+        const glm::vec3 offset = glm::vec3(position(i)[0], position(i)[1], position(i)[2]) - center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+
+    bounds.m_Radius = std::sqrt(radiusSquared);
+    return bounds;
+}
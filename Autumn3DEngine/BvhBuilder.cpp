@@ -0,0 +1,246 @@
+#include "BvhBuilder.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <future>
+#include <limits>
+
+namespace
+{
+    // Subtrees are only handed to the pool above this many primitives
+    const size_t PARALLEL_PRIMITIVE_COUNT = 4096;
+
+    // Primitives are partitioned in place rather than through an index array, so every pass reads them sequentially
+    struct Primitive
+    {
+        glm::vec3 m_Min;
+        uint32_t m_Index;
+        glm::vec3 m_Max;
+        float m_Padding;
+
+        glm::vec3 GetCentroid() const { return (m_Min + m_Max) * 0.5f; }
+    };
+
+    struct BuildContext
+    {
+        Primitive* m_Primitives;
+        size_t m_MaxLeafSize;
+    };
+
+    struct Bin
+    {
+        glm::vec3 m_Min = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 m_Max = glm::vec3(-std::numeric_limits<float>::max());
+        size_t m_Count = 0;
+    };
+}
+
+float BvhBuilder::GetHalfArea(const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    const glm::vec3 size = glm::max(boxMax - boxMin, glm::vec3(0.0f));
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+// Sets the box of a node to enclose its primitives and returns the box around their centroids
+static void FitNode(const BuildContext& context, BvhBuilder::Node& node, glm::vec3& centroidMin, glm::vec3& centroidMax)
+{
+    node.m_Min = centroidMin = glm::vec3(std::numeric_limits<float>::max());
+    node.m_Max = centroidMax = glm::vec3(-std::numeric_limits<float>::max());
+    for (size_t i = node.m_First; i < node.m_First + node.m_Count; ++i)
+    {
+        const Primitive& primitive = context.m_Primitives[i];
+        node.m_Min = glm::min(node.m_Min, primitive.m_Min);
+        node.m_Max = glm::max(node.m_Max, primitive.m_Max);
+        centroidMin = glm::min(centroidMin, primitive.GetCentroid());
+        centroidMax = glm::max(centroidMax, primitive.GetCentroid());
+    }
+}
+
+// Partitions the primitives of a node at its cheapest SAH split and returns how many went to the left half.
+// Nodes that fit a leaf are never split: the caller picks the leaf size its primitive test handles at once.
+static size_t SplitNode(const BuildContext& context, const BvhBuilder::Node& node, const glm::vec3& centroidMin, const glm::vec3& centroidMax)
+{
+    const size_t first = node.m_First, count = node.m_Count;
+    if (count <= context.m_MaxLeafSize)
+        return 0;
+
+    // Bin along all three axes in one pass over the primitives; an axis without extent keeps everything in bin 0.
+    // Small nodes use fewer bins, since most would stay empty.
+    const unsigned int binCount = static_cast<unsigned int>(std::min<size_t>(BvhBuilder::BIN_COUNT, std::max<size_t>(count, 4)));
+    Bin bins[3][BvhBuilder::BIN_COUNT];
+    glm::vec3 scale;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float extent = centroidMax[axis] - centroidMin[axis];
+        scale[axis] = extent > 0.0f ? binCount / extent : 0.0f;
+    }
+    auto getBin = [&](const glm::vec3& centroid, int axis)
+    {
+        return std::min(static_cast<unsigned int>((centroid[axis] - centroidMin[axis]) * scale[axis]), binCount - 1);
+    };
+    for (size_t i = first; i < first + count; ++i)
+    {
+        const Primitive& primitive = context.m_Primitives[i];
+        const glm::vec3 centroid = primitive.GetCentroid();
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            Bin& bin = bins[axis][getBin(centroid, axis)];
+            bin.m_Min = glm::min(bin.m_Min, primitive.m_Min);
+            bin.m_Max = glm::max(bin.m_Max, primitive.m_Max);
+            ++bin.m_Count;
+        }
+    }
+
+    // Costs are in units of one primitive test, with a node visit costing the same
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1;
+    unsigned int bestSplit = 0;
+    const float inverseArea = 1.0f / std::max(BvhBuilder::GetHalfArea(node.m_Min, node.m_Max), std::numeric_limits<float>::min());
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (scale[axis] == 0.0f)
+            continue;
+
+        // Sweep from the right to get the cost of every right half, then from the left
+        float rightCosts[BvhBuilder::BIN_COUNT];
+        Bin right;
+        for (unsigned int b = binCount - 1; b > 0; --b)
+        {
+            right.m_Min = glm::min(right.m_Min, bins[axis][b].m_Min);
+            right.m_Max = glm::max(right.m_Max, bins[axis][b].m_Max);
+            right.m_Count += bins[axis][b].m_Count;
+            rightCosts[b] = right.m_Count > 0 ? BvhBuilder::GetHalfArea(right.m_Min, right.m_Max) * right.m_Count : 0.0f;
+        }
+
+        Bin left;
+        for (unsigned int b = 0; b + 1 < binCount; ++b)
+        {
+            left.m_Min = glm::min(left.m_Min, bins[axis][b].m_Min);
+            left.m_Max = glm::max(left.m_Max, bins[axis][b].m_Max);
+            left.m_Count += bins[axis][b].m_Count;
+            if (left.m_Count == 0 || left.m_Count == count)
+                continue;
+
+            const float cost = 1.0f + (BvhBuilder::GetHalfArea(left.m_Min, left.m_Max) * left.m_Count + rightCosts[b + 1]) * inverseArea;
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b + 1;
+            }
+        }
+    }
+
+    // Coincident centroids cannot be binned apart, so the node is split in the middle of its range
+    if (bestAxis < 0)
+        return count / 2;
+
+    Primitive* middle = std::partition(context.m_Primitives + first, context.m_Primitives + first + count, [&](const Primitive& primitive)
+    {
+        return getBin(primitive.GetCentroid(), bestAxis) < bestSplit;
+    });
+    return static_cast<size_t>(middle - (context.m_Primitives + first));
+}
+
+// Splits the subtree under nodes[root] until every leaf is small enough. With a deferred list, nodes of at most
+// deferCount primitives are fitted but left for a later, separate build and recorded there.
+static void Subdivide(const BuildContext& context, std::vector<BvhBuilder::Node>& nodes, uint32_t root, size_t deferCount, std::vector<uint32_t>* deferred)
+{
+    std::vector<uint32_t> stack(1, root);
+    while (!stack.empty())
+    {
+        const uint32_t index = stack.back();
+        stack.pop_back();
+
+        glm::vec3 centroidMin, centroidMax;
+        FitNode(context, nodes[index], centroidMin, centroidMax);
+        if (deferred && nodes[index].m_Count <= deferCount)
+        {
+            deferred->push_back(index);
+            continue;
+        }
+
+        const size_t leftCount = SplitNode(context, nodes[index], centroidMin, centroidMax);
+        if (leftCount == 0)
+            continue;
+
+        // Siblings are allocated together so the right child is always left + 1
+        const uint32_t first = nodes[index].m_First, count = nodes[index].m_Count;
+        const uint32_t left = static_cast<uint32_t>(nodes.size());
+        nodes.push_back({ glm::vec3(0.0f), first, glm::vec3(0.0f), static_cast<uint32_t>(leftCount) });
+        nodes.push_back({ glm::vec3(0.0f), first + static_cast<uint32_t>(leftCount), glm::vec3(0.0f), count - static_cast<uint32_t>(leftCount) });
+        nodes[index].m_First = left;
+        nodes[index].m_Count = 0;
+
+        stack.push_back(left + 1);
+        stack.push_back(left);
+    }
+}
+
+// Splits the top of the tree serially until there are several subtrees per thread, builds each subtree into its own
+// array on the pool and appends them
+static void BuildParallel(const BuildContext& context, std::vector<BvhBuilder::Node>& nodes, ThreadPool& pool)
+{
+    const size_t deferCount = std::max(PARALLEL_PRIMITIVE_COUNT, nodes[0].m_Count / (size_t(pool.GetThreadCount()) * 8));
+    std::vector<uint32_t> deferred;
+    Subdivide(context, nodes, 0, deferCount, &deferred);
+
+    std::vector<std::vector<BvhBuilder::Node>> subtrees(deferred.size());
+    std::vector<std::future<void>> results;
+    results.reserve(deferred.size());
+    for (size_t d = 0; d < deferred.size(); ++d)
+    {
+        subtrees[d].push_back(nodes[deferred[d]]);
+        results.emplace_back(pool.Submit([&context, &subtrees, d]()
+        {
+            // Each subtree owns a disjoint range of the primitives
+            Subdivide(context, subtrees[d], 0, 0, nullptr);
+        }));
+    }
+    for (auto& result : results)
+        result.get();
+
+    // A subtree's root replaces its placeholder and the rest is appended, shifting its child links
+    for (size_t d = 0; d < deferred.size(); ++d)
+    {
+        std::vector<BvhBuilder::Node>& subtree = subtrees[d];
+        const uint32_t offset = static_cast<uint32_t>(nodes.size()) - 1;
+        for (BvhBuilder::Node& node : subtree)
+        {
+            if (!node.IsLeaf())
+                node.m_First += offset;
+        }
+        nodes[deferred[d]] = subtree[0];
+        nodes.insert(nodes.end(), subtree.begin() + 1, subtree.end());
+    }
+}
+
+void BvhBuilder::Build(const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax, size_t maxLeafSize, ThreadPool* pool,
+    std::vector<Node>& nodes, std::vector<uint32_t>& order)
+{
+    nodes.clear();
+    const size_t count = std::min(boxMin.size(), boxMax.size());
+    order.resize(count);
+    if (count == 0)
+        return;
+
+    std::vector<Primitive> primitives(count);
+    for (size_t i = 0; i < count; ++i)
+        primitives[i] = { boxMin[i], static_cast<uint32_t>(i), boxMax[i], 0.0f };
+
+    const BuildContext context = { primitives.data(), std::max<size_t>(maxLeafSize, 1) };
+    nodes.reserve(count * 2 / context.m_MaxLeafSize + 1);
+    nodes.push_back({ glm::vec3(0.0f), 0, glm::vec3(0.0f), static_cast<uint32_t>(count) });
+
+    if (!pool || pool->GetThreadCount() <= 1 || count <= PARALLEL_PRIMITIVE_COUNT)
+    {
+        Subdivide(context, nodes, 0, 0, nullptr);
+    }
+    else
+    {
+        BuildParallel(context, nodes, *pool);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        order[i] = primitives[i].m_Index;
+}
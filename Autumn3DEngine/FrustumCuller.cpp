@@ -0,0 +1,161 @@
+#include "FrustumCuller.h"
+#include "Simd.h"
+
+
+void FrustumCuller::ExtractPlanes(const glm::mat4& clip, glm::vec4 planes[6])
+{
+    const glm::vec4 row0(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+    const glm::vec4 row1(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+    const glm::vec4 row2(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+    const glm::vec4 row3(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+    planes[0] = row3 + row0; // left
+    planes[1] = row3 - row0; // right
+    planes[2] = row3 + row1; // bottom
+    planes[3] = row3 - row1; // top
+    planes[4] = row3 + row2; // near
+    planes[5] = row3 - row2; // far
+    for (int i = 0; i < 6; ++i)
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+size_t FrustumCuller::AddBox(const Bounds& bounds)
+{
+    // Grow by a whole batch so the kernels never read past the end; padding boxes are never reported
+    if (m_Count == m_CenterX.size())
+    {
+        const size_t size = m_Count + BATCH_SIZE;
+        m_CenterX.resize(size);
+        m_CenterY.resize(size);
+        m_CenterZ.resize(size);
+        m_ExtentX.resize(size);
+        m_ExtentY.resize(size);
+        m_ExtentZ.resize(size);
+    }
+
+    const glm::vec3 center = bounds.GetCenter(), extents = bounds.GetExtents();
+    m_CenterX[m_Count] = center.x;
+    m_CenterY[m_Count] = center.y;
+    m_CenterZ[m_Count] = center.z;
+    m_ExtentX[m_Count] = extents.x;
+    m_ExtentY[m_Count] = extents.y;
+    m_ExtentZ[m_Count] = extents.z;
+    return m_Count++;
+}
+
+void FrustumCuller::Cull(std::vector<uint32_t>& visible) const
+{
+    // A box is outside when it lies entirely behind one plane: dot(normal, centre) + w + dot(|normal|, extents) < 0
+    // Room for every box plus a batch of padding; the result is trimmed at the end
+    const size_t firstVisible = visible.size();
+    size_t visibleCount = firstVisible;
+    visible.resize(visibleCount + m_Count + BATCH_SIZE);
+    uint32_t* output = visible.data();
+
+    // Appends the boxes of a batch whose bit is clear in outsideMask. Every lane is written and the count only advances
+    // past visible ones, which avoids a branch per box when visibility is unpredictable.
+    auto emitBatch = [output, &visibleCount](size_t first, unsigned int outsideMask, size_t width)
+    {
+        if (outsideMask == (1u << width) - 1)
+            return;
+        for (size_t lane = 0; lane < width; ++lane)
+        {
+            output[visibleCount] = static_cast<uint32_t>(first + lane);
+            visibleCount += ((outsideMask >> lane) & 1u) ^ 1u;
+        }
+    };
+
+    // The plane normals' absolute values project the extents onto each normal
+    glm::vec4 absPlanes[6];
+    for (int i = 0; i < 6; ++i)
+        absPlanes[i] = glm::abs(m_Planes[i]);
+
+#if defined(AUTUMN3D_SIMD_AVX)
+
+    for (size_t first = 0; first < m_Count; first += 8)
+    {
+        const __m256 centerX = _mm256_loadu_ps(&m_CenterX[first]), centerY = _mm256_loadu_ps(&m_CenterY[first]), centerZ = _mm256_loadu_ps(&m_CenterZ[first]);
+        const __m256 extentX = _mm256_loadu_ps(&m_ExtentX[first]), extentY = _mm256_loadu_ps(&m_ExtentY[first]), extentZ = _mm256_loadu_ps(&m_ExtentZ[first]);
+
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < 6; ++p)
+        {
+            const glm::vec4& plane = m_Planes[p];
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(centerX, _mm256_set1_ps(plane.x)), _mm256_set1_ps(plane.w));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(centerY, _mm256_set1_ps(plane.y)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(centerZ, _mm256_set1_ps(plane.z)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(extentX, _mm256_set1_ps(absPlanes[p].x)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(extentY, _mm256_set1_ps(absPlanes[p].y)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(extentZ, _mm256_set1_ps(absPlanes[p].z)));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+        emitBatch(first, static_cast<unsigned int>(_mm256_movemask_ps(outside)), 8);
+    }
+
+#elif defined(AUTUMN3D_SIMD_SSE2)
+
+    for (size_t first = 0; first < m_Count; first += 4)
+    {
+        const __m128 centerX = _mm_loadu_ps(&m_CenterX[first]), centerY = _mm_loadu_ps(&m_CenterY[first]), centerZ = _mm_loadu_ps(&m_CenterZ[first]);
+        const __m128 extentX = _mm_loadu_ps(&m_ExtentX[first]), extentY = _mm_loadu_ps(&m_ExtentY[first]), extentZ = _mm_loadu_ps(&m_ExtentZ[first]);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p)
+        {
+            const glm::vec4& plane = m_Planes[p];
+            __m128 distance = _mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+            distance = _mm_add_ps(distance, _mm_mul_ps(centerY, _mm_set1_ps(plane.y)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(centerZ, _mm_set1_ps(plane.z)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(extentX, _mm_set1_ps(absPlanes[p].x)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(extentY, _mm_set1_ps(absPlanes[p].y)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(extentZ, _mm_set1_ps(absPlanes[p].z)));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+        }
+        emitBatch(first, static_cast<unsigned int>(_mm_movemask_ps(outside)), 4);
+    }
+
+#elif defined(AUTUMN3D_SIMD_NEON)
+
+    for (size_t first = 0; first < m_Count; first += 4)
+    {
+        const float32x4_t centerX = vld1q_f32(&m_CenterX[first]), centerY = vld1q_f32(&m_CenterY[first]), centerZ = vld1q_f32(&m_CenterZ[first]);
+        const float32x4_t extentX = vld1q_f32(&m_ExtentX[first]), extentY = vld1q_f32(&m_ExtentY[first]), extentZ = vld1q_f32(&m_ExtentZ[first]);
+
+        uint32x4_t outside = vdupq_n_u32(0);
+        for (int p = 0; p < 6; ++p)
+        {
+            const glm::vec4& plane = m_Planes[p];
+            float32x4_t distance = vmlaq_n_f32(vdupq_n_f32(plane.w), centerX, plane.x);
+            distance = vmlaq_n_f32(distance, centerY, plane.y);
+            distance = vmlaq_n_f32(distance, centerZ, plane.z);
+            distance = vmlaq_n_f32(distance, extentX, absPlanes[p].x);
+            distance = vmlaq_n_f32(distance, extentY, absPlanes[p].y);
+            distance = vmlaq_n_f32(distance, extentZ, absPlanes[p].z);
+            outside = vorrq_u32(outside, vcltq_f32(distance, vdupq_n_f32(0.0f)));
+        }
+        const unsigned int mask = (vgetq_lane_u32(outside, 0) & 1u) | (vgetq_lane_u32(outside, 1) & 2u)
+            | (vgetq_lane_u32(outside, 2) & 4u) | (vgetq_lane_u32(outside, 3) & 8u);
+        emitBatch(first, mask, 4);
+    }
+
+#else
+
+    for (size_t i = 0; i < m_Count; ++i)
+    {
+        bool outside = false;
+        for (int p = 0; p < 6; ++p)
+        {
+            const glm::vec4& plane = m_Planes[p];
+            const float distance = m_CenterX[i] * plane.x + m_CenterY[i] * plane.y + m_CenterZ[i] * plane.z + plane.w
+                + m_ExtentX[i] * absPlanes[p].x + m_ExtentY[i] * absPlanes[p].y + m_ExtentZ[i] * absPlanes[p].z;
+            outside = outside || distance < 0.0f;
+        }
+        emitBatch(i, outside ? 1u : 0u, 1);
+    }
+
+#endif
+
+    // Padding lanes of the last batch may have been counted as visible
+    while (visibleCount > firstVisible && output[visibleCount - 1] >= m_Count)
+        --visibleCount;
+    visible.resize(visibleCount);
+}
@@ -0,0 +1,148 @@
+#include "GLStateCache.h"
+
+#include <algorithm>
+
+void GLStateCache::Invalidate()
+{
+    m_Program = UNKNOWN;
+    m_VertexArray = UNKNOWN;
+    std::fill(std::begin(m_Buffers), std::end(m_Buffers), UNKNOWN);
+    std::fill(std::begin(m_StorageBindings), std::end(m_StorageBindings), UNKNOWN);
+    m_ActiveTexture = UNKNOWN;
+    std::fill(std::begin(m_Textures), std::end(m_Textures), UNKNOWN);
+    std::fill(std::begin(m_Samplers), std::end(m_Samplers), UNKNOWN);
+    m_Capabilities.clear();
+}
+
+bool GLStateCache::Update(GLuint& shadow, GLuint value)
+{
+    if (shadow == value)
+    {
+        ++m_Stats.m_Skipped;
+        return false;
+    }
+    shadow = value;
+    ++m_Stats.m_Issued;
+    return true;
+}
+
+void GLStateCache::UseProgram(GLuint program)
+{
+    if (Update(m_Program, program))
+        glUseProgram(program);
+}
+
+void GLStateCache::BindVertexArray(GLuint vertexArray)
+{
+    if (Update(m_VertexArray, vertexArray))
+    {
+        glBindVertexArray(vertexArray);
+        m_Buffers[ElementArrayBufferSlot] = UNKNOWN;
+    }
+}
+
+void GLStateCache::BindBuffer(GLenum target, GLuint buffer)
+{
+    const int slot = GetBufferSlot(target);
+    if (slot == BufferSlotCount)
+    {
+        ++m_Stats.m_Issued;
+        glBindBuffer(target, buffer);
+    }
+    else if (Update(m_Buffers[slot], buffer))
+    {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void GLStateCache::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    const int slot = GetBufferSlot(target);
+    if (target == GL_SHADER_STORAGE_BUFFER && index < MAX_STORAGE_BINDINGS)
+    {
+        if (!Update(m_StorageBindings[index], buffer))
+            return;
+    }
+    else
+    {
+        ++m_Stats.m_Issued;
+    }
+
+    glBindBufferBase(target, index, buffer);
+    if (slot != BufferSlotCount)
+        m_Buffers[slot] = buffer;
+}
+
+void GLStateCache::ActiveTexture(GLuint unit)
+{
+    if (Update(m_ActiveTexture, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GLStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    if (target == GL_TEXTURE_2D && unit < MAX_TEXTURE_UNITS)
+    {
+        if (m_Textures[unit] == texture)
+        {
+            ++m_Stats.m_Skipped;
+            return;
+        }
+        m_Textures[unit] = texture;
+    }
+
+    ActiveTexture(unit);
+    ++m_Stats.m_Issued;
+    glBindTexture(target, texture);
+}
+
+void GLStateCache::BindSampler(GLuint unit, GLuint sampler)
+{
+    if (unit >= MAX_TEXTURE_UNITS)
+    {
+        ++m_Stats.m_Issued;
+        glBindSampler(unit, sampler);
+    }
+    else if (Update(m_Samplers[unit], sampler))
+    {
+        glBindSampler(unit, sampler);
+    }
+}
+
+void GLStateCache::SetEnabled(GLenum capability, bool enabled)
+{
+    auto known = std::find_if(m_Capabilities.begin(), m_Capabilities.end(),
+        [capability](const std::pair<GLenum, bool>& entry) { return entry.first == capability; });
+    if (known != m_Capabilities.end() && known->second == enabled)
+    {
+        ++m_Stats.m_Skipped;
+        return;
+    }
+
+    if (known != m_Capabilities.end())
+        known->second = enabled;
+    else
+        m_Capabilities.emplace_back(capability, enabled);
+
+    ++m_Stats.m_Issued;
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+int GLStateCache::GetBufferSlot(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER: return ArrayBufferSlot;
+    case GL_ELEMENT_ARRAY_BUFFER: return ElementArrayBufferSlot;
+    case GL_COPY_READ_BUFFER: return CopyReadBufferSlot;
+    case GL_COPY_WRITE_BUFFER: return CopyWriteBufferSlot;
+    case GL_DRAW_INDIRECT_BUFFER: return DrawIndirectBufferSlot;
+    case GL_PARAMETER_BUFFER: return ParameterBufferSlot;
+    case GL_SHADER_STORAGE_BUFFER: return ShaderStorageBufferSlot;
+    case GL_UNIFORM_BUFFER: return UniformBufferSlot;
+    default: return BufferSlotCount;
+    }
+}
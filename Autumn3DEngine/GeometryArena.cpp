@@ -0,0 +1,224 @@
+#include "GeometryArena.h"
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <glad.h>
+#include <GLFW/glfw3.h>
+
+void GeometryArena::Upload(Model::Mesh& mesh, const void* vertices, uint64_t vertexSize, const void* indices, uint64_t indexSize)
+{
+    // A mesh without geometry keeps m_VAO at 0 and is never drawn
+    if (vertexSize == 0 || indexSize == 0)
+        return;
+
+    // Vertex ranges start at a multiple of the stride so the mesh can be addressed with a base vertex,
+    // index ranges at a multiple of 4 so both index types stay aligned
+    const uint64_t stride = VertexFormat::GetStride(mesh.m_VertexLayout);
+    const uint64_t indexAlignment = sizeof(unsigned int);
+
+    size_t pageIndex = m_Pages.size();
+    uint64_t vertexOffset = RangeAllocator::INVALID_OFFSET, indexOffset = RangeAllocator::INVALID_OFFSET;
+    for (size_t p = 0; p < m_Pages.size(); ++p)
+    {
+        Page& page = m_Pages[p];
+        if (page.m_Layout != mesh.m_VertexLayout)
+            continue;
+
+        vertexOffset = AllocateRange(page, true, vertexSize, stride);
+        if (vertexOffset == RangeAllocator::INVALID_OFFSET)
+            continue;
+        indexOffset = AllocateRange(page, false, indexSize, indexAlignment);
+        if (indexOffset != RangeAllocator::INVALID_OFFSET)
+        {
+            pageIndex = p;
+            break;
+        }
+        page.m_Vertices.Free(vertexOffset, vertexSize);
+        vertexOffset = RangeAllocator::INVALID_OFFSET;
+    }
+
+    if (pageIndex == m_Pages.size())
+    {
+        // No page of this layout has room; a mesh larger than a full page gets a page of exactly its size
+        m_Pages.emplace_back();
+        Page& page = m_Pages.back();
+        page.m_Layout = mesh.m_VertexLayout;
+        glGenVertexArrays(1, &page.m_VertexArray);
+        if (!page.m_VertexArray)
+            throw std::runtime_error("Failed to generate a geometry arena VAO.");
+
+        GrowBuffer(page, true, std::max(INITIAL_PAGE_SIZE / stride * stride, vertexSize));
+        GrowBuffer(page, false, std::max(INITIAL_PAGE_SIZE, indexSize));
+
+        vertexOffset = page.m_Vertices.Allocate(vertexSize, stride);
+        indexOffset = page.m_Indices.Allocate(indexSize, indexAlignment);
+        if (vertexOffset == RangeAllocator::INVALID_OFFSET || indexOffset == RangeAllocator::INVALID_OFFSET)
+            throw std::runtime_error("Failed to allocate mesh geometry in a new arena page.");
+    }
+
+    const Page& page = m_Pages[pageIndex];
+
+    // Uploads go through the copy targets so neither GL_ARRAY_BUFFER nor the bound VAO's index buffer changes
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page.m_VertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(vertexOffset), static_cast<GLsizeiptr>(vertexSize), vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page.m_IndexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(indexOffset), static_cast<GLsizeiptr>(indexSize), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    Model::Mesh::GpuGeometry& geometry = mesh.m_GpuGeometry;
+    geometry.m_VAO = page.m_VertexArray;
+    geometry.m_Page = static_cast<uint32_t>(pageIndex);
+    geometry.m_VertexOffset = vertexOffset;
+    geometry.m_VertexSize = vertexSize;
+    geometry.m_IndexOffset = indexOffset;
+    geometry.m_IndexSize = indexSize;
+    geometry.m_BaseVertex = static_cast<size_t>(vertexOffset / stride);
+}
+
+void GeometryArena::Free(Model::Mesh& mesh)
+{
+    Model::Mesh::GpuGeometry& geometry = mesh.m_GpuGeometry;
+    if (!geometry.m_VAO || geometry.m_Page >= m_Pages.size())
+        return;
+
+    Page& page = m_Pages[geometry.m_Page];
+    page.m_Vertices.Free(geometry.m_VertexOffset, geometry.m_VertexSize);
+    page.m_Indices.Free(geometry.m_IndexOffset, geometry.m_IndexSize);
+    geometry = Model::Mesh::GpuGeometry();
+}
+
+void GeometryArena::Clear()
+{
+    for (Page& page : m_Pages)
+    {
+        glDeleteVertexArrays(1, &page.m_VertexArray);
+        glDeleteBuffers(1, &page.m_VertexBuffer);
+        glDeleteBuffers(1, &page.m_IndexBuffer);
+    }
+    m_Pages.clear();
+}
+
+uint64_t GeometryArena::GetCapacity() const
+{
+    uint64_t capacity = 0;
+    for (const Page& page : m_Pages)
+        capacity += page.m_Vertices.GetCapacity() + page.m_Indices.GetCapacity();
+    return capacity;
+}
+
+uint64_t GeometryArena::GetUsed() const
+{
+    uint64_t used = 0;
+    for (const Page& page : m_Pages)
+        used += page.m_Vertices.GetUsed() + page.m_Indices.GetUsed();
+    return used;
+}
+
+uint64_t GeometryArena::AllocateRange(Page& page, bool vertexRange, uint64_t size, uint64_t alignment)
+{
+    RangeAllocator& allocator = vertexRange ? page.m_Vertices : page.m_Indices;
+    uint64_t offset = allocator.Allocate(size, alignment);
+    while (offset == RangeAllocator::INVALID_OFFSET && allocator.GetCapacity() < MAX_PAGE_SIZE)
+    {
+        // Vertex buffers stay a multiple of the stride so a freed tail merges into whole vertices
+        uint64_t capacity = std::min(allocator.GetCapacity() * 2, MAX_PAGE_SIZE);
+        if (vertexRange)
+            capacity = std::max(capacity / alignment * alignment, allocator.GetCapacity());
+        if (capacity == allocator.GetCapacity())
+            break;
+        GrowBuffer(page, vertexRange, capacity);
+        offset = allocator.Allocate(size, alignment);
+    }
+    return offset;
+}
+
+void GeometryArena::GrowBuffer(Page& page, bool vertexBuffer, uint64_t capacity)
+{
+    unsigned int& buffer = vertexBuffer ? page.m_VertexBuffer : page.m_IndexBuffer;
+    RangeAllocator& allocator = vertexBuffer ? page.m_Vertices : page.m_Indices;
+
+    unsigned int grown = 0;
+    glGenBuffers(1, &grown);
+    if (!grown)
+        throw std::runtime_error("Failed to generate a geometry arena buffer.");
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, GL_STATIC_DRAW);
+    if (buffer)
+    {
+        // Live ranges keep their offsets, so the old contents move over in one GPU-side copy
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(allocator.GetCapacity()));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    buffer = grown;
+    allocator.Grow(capacity);
+    if (page.m_VertexBuffer && page.m_IndexBuffer)
+        SetupVertexArray(page);
+}
+
+void GeometryArena::SetupVertexArray(const Page& page)
+{
+    glBindVertexArray(page.m_VertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, page.m_VertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.m_IndexBuffer);
+
+    if (page.m_Layout == VertexLayout::Full)
+    {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Model::Mesh::Vertex), (void*)0); // m_Position
+
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Model::Mesh::Vertex), (void*)offsetof(Model::Mesh::Vertex, m_Normal)); // m_Normal
+
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Model::Mesh::Vertex), (void*)offsetof(Model::Mesh::Vertex, m_TexCoords)); // Texture coords
+
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Model::Mesh::Vertex), (void*)offsetof(Model::Mesh::Vertex, m_Tangent)); // m_Tangent
+
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Model::Mesh::Vertex), (void*)offsetof(Model::Mesh::Vertex, m_Bitangent)); // m_Bitangent
+
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 4, GL_INT, sizeof(Model::Mesh::Vertex), (void*)offsetof(Model::Mesh::Vertex, m_BoneIDs)); // Bone IDs
+
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Model::Mesh::Vertex), (void*)offsetof(Model::Mesh::Vertex, m_Weights)); // Weights
+    }
+    else
+    {
+        // Compact layouts: the bitangent is rebuilt in the vertex shader from the normal, tangent and the sign in position.w
+        using Packed = VertexFormat::PackedSkinnedVertex;
+        const GLsizei stride = static_cast<GLsizei>(VertexFormat::GetStride(page.m_Layout));
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(VertexFormat::PackedStaticVertex, m_Position)); // unorm16 position
+
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(VertexFormat::PackedStaticVertex, m_Normal)); // octahedral normal
+
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(VertexFormat::PackedStaticVertex, m_TexCoords)); // half float UV
+
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(VertexFormat::PackedStaticVertex, m_Tangent)); // octahedral tangent
+
+        if (page.m_Layout == VertexLayout::Skinned)
+        {
+            glEnableVertexAttribArray(5);
+            glVertexAttribIPointer(5, 4, GL_UNSIGNED_BYTE, stride, (void*)offsetof(Packed, m_BoneIDs)); // u8 bone IDs
+
+            glEnableVertexAttribArray(6);
+            glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(Packed, m_Weights)); // unorm8 weights
+        }
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,270 @@
+#include "GpuCuller.h"
+#include "FrustumCuller.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <glad.h>
+#include <GLFW/glfw3.h>
+
+// Shader storage bindings of CullComputeShader.glsl. Binding 0 is the draw shader's DrawData while drawing.
+enum CullBinding : GLuint
+{
+    InputCommandsBinding = 0,
+    InputDataBinding,
+    CallFirstsBinding,
+    InstanceBoundsBinding,
+    PreviousVisibilityBinding,
+    CurrentVisibilityBinding,
+    OutputCommandsBinding,
+    OutputDataBinding,
+    CountersBinding
+};
+
+// Respecifies a shader storage buffer with the given contents, or uninitialized storage without data
+static void UploadBuffer(GLStateCache& state, unsigned int& buffer, size_t size, const void* data)
+{
+    if (!buffer)
+        glGenBuffers(1, &buffer);
+    if (!buffer)
+        throw std::runtime_error("Failed to generate a GPU culling buffer.");
+    state.BindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(size), data, GL_STREAM_DRAW);
+}
+
+static void ClearBuffer(GLStateCache& state, unsigned int buffer)
+{
+    state.BindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+}
+
+void GpuCuller::Initialize(const char* cullShaderPath, const char* hiZShaderPath, DrawIndirectCountProc drawIndirectCount, GLStateCache& state)
+{
+    m_CullShader = std::make_shared<Shader>(cullShaderPath);
+    m_HiZShader = std::make_shared<Shader>(hiZShaderPath);
+    m_ViewProjectionUniform = m_CullShader->GetUniform<glm::mat4>("viewProjection");
+    m_FrustumPlanesUniform = m_CullShader->GetUniform<glm::vec4>("frustumPlanes");
+    m_CommandCountUniform = m_CullShader->GetUniform<int>("commandCount");
+    m_CallCountUniform = m_CullShader->GetUniform<int>("callCount");
+    m_ScreenSizeUniform = m_CullShader->GetUniform<glm::vec2>("screenSize");
+    m_HiZLevelsUniform = m_CullShader->GetUniform<int>("hiZLevels");
+    m_PhaseUniform = m_CullShader->GetUniform<int>("phase");
+    m_CopyDepthUniform = m_HiZShader->GetUniform<bool>("copyDepth");
+    m_DrawIndirectCount = drawIndirectCount;
+
+    // The Hi-Z pyramid is sampled from unit 1 and built from the depth texture on unit 0
+    state.UseProgram(m_CullShader->ID);
+    m_CullShader->SetInt("hiZ", 1);
+    state.UseProgram(m_HiZShader->ID);
+    m_HiZShader->SetInt("depthTexture", 0);
+}
+
+void GpuCuller::BeginFrame(int width, int height, GLStateCache& state)
+{
+    if (width <= 0 || height <= 0)
+        throw std::runtime_error("GpuCuller::BeginFrame: empty framebuffer");
+
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_TargetFramebuffer);
+
+    if (width != m_Width || height != m_Height)
+    {
+        glDeleteFramebuffers(1, &m_Framebuffer);
+        glDeleteRenderbuffers(1, &m_ColorBuffer);
+        glDeleteTextures(1, &m_DepthTexture);
+        glDeleteTextures(1, &m_HiZTexture);
+        m_Width = width;
+        m_Height = height;
+
+        glGenFramebuffers(1, &m_Framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+
+        glGenRenderbuffers(1, &m_ColorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_ColorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_ColorBuffer);
+
+        // The depth texture has a single level, so it must not expect mipmaps to be complete
+        glGenTextures(1, &m_DepthTexture);
+        glBindTexture(GL_TEXTURE_2D, m_DepthTexture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_DepthTexture, 0);
+
+        // Full mip chain down to 1x1; level 0 matches the depth texture
+        m_HiZLevels = 1;
+        while ((std::max(width, height) >> m_HiZLevels) > 0)
+            ++m_HiZLevels;
+        glGenTextures(1, &m_HiZTexture);
+        glBindTexture(GL_TEXTURE_2D, m_HiZTexture);
+        glTexStorage2D(GL_TEXTURE_2D, m_HiZLevels, GL_R32F, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // Deleted names unbind themselves and may come back from glGenTextures
+        state.Invalidate();
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            throw std::runtime_error("The GPU culling framebuffer is incomplete.");
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+    glViewport(0, 0, width, height);
+}
+
+void GpuCuller::AddInstance(const Bounds& bounds, uint32_t id)
+{
+    // Empty bounds are stored inverted, which the frustum test rejects. The shader reads the ID back with floatBitsToUint.
+    float idBits;
+    std::memcpy(&idBits, &id, sizeof(idBits));
+    m_Bounds.emplace_back(bounds.m_Min, idBits);
+    m_Bounds.emplace_back(bounds.m_Max, 0.0f);
+    m_IdCount = std::max(m_IdCount, static_cast<size_t>(id) + 1);
+}
+
+void GpuCuller::Draw(IndirectDrawList& draws, const glm::mat4& viewProjection, const Shader& drawShader, UniformHandle<int> drawOffset,
+    GLStateCache& state)
+{
+    if (!IsInitialized())
+        throw std::runtime_error("GpuCuller::Draw: not initialized");
+
+    draws.Build();
+    const std::vector<IndirectDrawList::Command>& commands = draws.GetCommands();
+    const std::vector<IndirectDrawList::Call>& calls = draws.GetCalls();
+    const size_t instanceCount = m_Bounds.size() / 2;
+    if (draws.GetInstanceCount() != instanceCount)
+        throw std::runtime_error("GpuCuller::Draw: " + std::to_string(instanceCount) + " instance bounds for " +
+            std::to_string(draws.GetInstanceCount()) + " draw list instances");
+    if (commands.empty())
+        return;
+
+    std::vector<uint32_t> callFirsts;
+    callFirsts.reserve(calls.size());
+    for (const IndirectDrawList::Call& call : calls)
+        callFirsts.push_back(call.m_First);
+
+    UploadBuffer(state, m_InputCommands, commands.size() * sizeof(IndirectDrawList::Command), commands.data());
+    UploadBuffer(state, m_InputData, draws.GetDrawData().size() * sizeof(IndirectDrawList::DrawData), draws.GetDrawData().data());
+    UploadBuffer(state, m_CallFirsts, callFirsts.size() * sizeof(uint32_t), callFirsts.data());
+    UploadBuffer(state, m_InstanceBounds, m_Bounds.size() * sizeof(glm::vec4), m_Bounds.data());
+
+    // New IDs beyond the visibility buffers reallocate them and drop last frame's visibility; phase 2 then finds every
+    // visible instance
+    if (m_IdCount > m_VisibilityCount)
+    {
+        const std::vector<uint32_t> hidden(m_IdCount, 0u);
+        UploadBuffer(state, m_Visibility[0], hidden.size() * sizeof(uint32_t), hidden.data());
+        UploadBuffer(state, m_Visibility[1], hidden.size() * sizeof(uint32_t), hidden.data());
+        m_VisibilityCount = m_IdCount;
+    }
+    m_CurrentVisibility ^= 1;
+    ClearBuffer(state, m_Visibility[m_CurrentVisibility]);
+
+    // Without a count from the GPU every command slot is drawn, so the unused ones must have no indices
+    UploadBuffer(state, m_OutputCommands, 2 * commands.size() * sizeof(IndirectDrawList::Command), nullptr);
+    if (!m_DrawIndirectCount)
+        ClearBuffer(state, m_OutputCommands);
+    UploadBuffer(state, m_OutputData, 2 * commands.size() * sizeof(IndirectDrawList::DrawData), nullptr);
+    UploadBuffer(state, m_Counters, 2 * calls.size() * sizeof(uint32_t), nullptr);
+    ClearBuffer(state, m_Counters);
+
+    glm::vec4 planes[6];
+    FrustumCuller::ExtractPlanes(viewProjection, planes);
+    state.UseProgram(m_CullShader->ID);
+    m_CullShader->Set(m_ViewProjectionUniform, viewProjection);
+    m_CullShader->Set(m_FrustumPlanesUniform, planes, 6);
+    m_CullShader->Set(m_CommandCountUniform, static_cast<int>(commands.size()));
+    m_CullShader->Set(m_CallCountUniform, static_cast<int>(calls.size()));
+    m_CullShader->Set(m_ScreenSizeUniform, glm::vec2(static_cast<float>(m_Width), static_cast<float>(m_Height)));
+    m_CullShader->Set(m_HiZLevelsUniform, m_HiZLevels);
+
+    CullAndDraw(0, draws, drawShader, drawOffset, state);
+    BuildHiZ(state);
+    CullAndDraw(1, draws, drawShader, drawOffset, state);
+}
+
+void GpuCuller::CullAndDraw(int phase, const IndirectDrawList& draws, const Shader& drawShader, UniformHandle<int> drawOffset,
+    GLStateCache& state)
+{
+    const std::vector<IndirectDrawList::Call>& calls = draws.GetCalls();
+    const size_t commandCount = draws.GetCommands().size();
+
+    state.UseProgram(m_CullShader->ID);
+    m_CullShader->Set(m_PhaseUniform, phase);
+    state.BindTexture(1, GL_TEXTURE_2D, m_HiZTexture);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, InputCommandsBinding, m_InputCommands);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, InputDataBinding, m_InputData);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, CallFirstsBinding, m_CallFirsts);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, InstanceBoundsBinding, m_InstanceBounds);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, PreviousVisibilityBinding, m_Visibility[m_CurrentVisibility ^ 1]);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, CurrentVisibilityBinding, m_Visibility[m_CurrentVisibility]);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, OutputCommandsBinding, m_OutputCommands);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, OutputDataBinding, m_OutputData);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, CountersBinding, m_Counters);
+    glDispatchCompute(static_cast<GLuint>((commandCount + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE), 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Phase p writes the commands of call c from p * commandCount + first, and its count to counter p * callCount + c
+    state.UseProgram(drawShader.ID);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_OutputData);
+    state.BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_OutputCommands);
+    if (m_DrawIndirectCount)
+        state.BindBuffer(GL_PARAMETER_BUFFER, m_Counters);
+    for (size_t c = 0; c < calls.size(); ++c)
+    {
+        const IndirectDrawList::Call& call = calls[c];
+        const size_t first = phase * commandCount + call.m_First;
+        drawShader.Set(drawOffset, static_cast<int>(first));
+        state.BindVertexArray(call.m_VertexArray);
+        state.BindTexture(0, GL_TEXTURE_2D, call.m_Texture);
+        const void* indirect = reinterpret_cast<const void*>(first * sizeof(IndirectDrawList::Command));
+        if (m_DrawIndirectCount)
+            m_DrawIndirectCount(GL_TRIANGLES, call.m_IndexType, indirect, static_cast<GLintptr>((phase * calls.size() + c) * sizeof(uint32_t)),
+                static_cast<GLsizei>(call.m_Count), 0);
+        else
+            glMultiDrawElementsIndirect(GL_TRIANGLES, call.m_IndexType, indirect, static_cast<GLsizei>(call.m_Count), 0);
+    }
+}
+
+void GpuCuller::BuildHiZ(GLStateCache& state)
+{
+    state.UseProgram(m_HiZShader->ID);
+    state.BindTexture(0, GL_TEXTURE_2D, m_DepthTexture);
+
+    // Level 0 copies the depth texture, every further level keeps the maximum of the texels it covers
+    for (int level = 0; level < m_HiZLevels; ++level)
+    {
+        const int width = std::max(m_Width >> level, 1), height = std::max(m_Height >> level, 1);
+        m_HiZShader->Set(m_CopyDepthUniform, level == 0);
+        glBindImageTexture(0, m_HiZTexture, std::max(level - 1, 0), GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, m_HiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((width + HIZ_WORK_GROUP_SIZE - 1) / HIZ_WORK_GROUP_SIZE, (height + HIZ_WORK_GROUP_SIZE - 1) / HIZ_WORK_GROUP_SIZE, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+    glBindImageTexture(1, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    state.BindTexture(0, GL_TEXTURE_2D, 0);
+}
+
+void GpuCuller::EndFrame()
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_Framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_TargetFramebuffer);
+    glBlitFramebuffer(0, 0, m_Width, m_Height, 0, 0, m_Width, m_Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_TargetFramebuffer);
+}
+
+void GpuCuller::Release()
+{
+    glDeleteFramebuffers(1, &m_Framebuffer);
+    glDeleteRenderbuffers(1, &m_ColorBuffer);
+    glDeleteTextures(1, &m_DepthTexture);
+    glDeleteTextures(1, &m_HiZTexture);
+    unsigned int buffers[] = { m_InputCommands, m_InputData, m_CallFirsts, m_InstanceBounds, m_Visibility[0], m_Visibility[1],
+        m_OutputCommands, m_OutputData, m_Counters };
+    glDeleteBuffers(static_cast<GLsizei>(sizeof(buffers) / sizeof(buffers[0])), buffers);
+    *this = GpuCuller();
+}
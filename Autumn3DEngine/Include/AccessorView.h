@@ -0,0 +1,176 @@
+#ifndef ACCESSORVIEW_H
+#define ACCESSORVIEW_H
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "GltfBuffers.h"
+#include "tiny_gltf.h"
+
+// Converts a single glTF component to the destination scalar type. Normalized integers map to [0, 1] or [-1, 1] as the glTF spec requires.
+template <typename Destination, typename Source, bool Normalized>
+struct ComponentConverter
+{
+    static Destination Convert(Source value) { return static_cast<Destination>(value); }
+};
+
+template <typename Source>
+struct ComponentConverter<float, Source, true>
+{
+    static float Convert(Source value)
+    {
+        constexpr float maxValue = static_cast<float>((std::numeric_limits<Source>::max)());
+        return (std::max)(static_cast<float>(value) / maxValue, -1.0f);
+    }
+};
+
+// A typed, strided view over a glTF accessor. Reads Components values of type T per element, whatever the source component type is.
+// The conversion loop is chosen once per view from compile-time specializations, so the per-element work has no type dispatch.
+template <typename T, int Components>
+class AccessorView
+{
+public:
+    AccessorView(const tinygltf::Model& gltfModel, const GltfBuffers& buffers, int accessorIndex)
+    {
+        const auto& accessor = gltfModel.accessors.at(accessorIndex);
+        if (accessor.bufferView < 0)
+            throw std::runtime_error("Accessor " + std::to_string(accessorIndex) + " has no buffer view.");
+
+        const auto& bufferView = gltfModel.bufferViews[accessor.bufferView];
+        const GltfBuffers::Span& buffer = buffers[bufferView.buffer];
+
+        const int stride = accessor.ByteStride(bufferView);
+        if (stride <= 0)
+            throw std::runtime_error("Accessor " + std::to_string(accessorIndex) + " has an invalid byte stride.");
+
+        m_Data = buffer.m_Data + bufferView.byteOffset + accessor.byteOffset;
+        m_Stride = static_cast<size_t>(stride);
+        m_Count = accessor.count;
+        m_ComponentType = accessor.componentType;
+        m_SourceComponents = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+        m_Normalized = accessor.normalized;
+
+        // A view may read fewer components than the source has (e.g. the xyz of a vec4 tangent), but never more
+        if (m_SourceComponents < Components)
+            throw std::runtime_error("Accessor " + std::to_string(accessorIndex) + " has fewer components than requested.");
+
+        const size_t end = accessor.byteOffset + (m_Count > 0 ? (m_Count - 1) * m_Stride + ElementSize() : 0);
+        if (bufferView.byteOffset + end > buffer.m_Size)
+            throw std::runtime_error("Accessor " + std::to_string(accessorIndex) + " reads past the end of its buffer.");
+
+        m_CopyFunction = SelectCopyFunction();
+    }
+
+    size_t Count() const { return m_Count; }
+    int ComponentType() const { return m_ComponentType; }
+    const unsigned char* Data() const { return m_Data; }
+    size_t Stride() const { return m_Stride; }
+
+    // True when the source already stores tightly packed T[Components], i.e. it can be used without conversion
+    bool IsPacked() const
+    {
+        return m_ComponentType == ComponentTypeOf<T>() && !m_Normalized && m_SourceComponents == Components && m_Stride == sizeof(T) * Components;
+    }
+
+    // Reads one element into out
+    void Read(size_t index, T* out) const
+    {
+        m_CopyFunction(m_Data + index * m_Stride, m_Stride, 1, out, sizeof(T) * Components);
+    }
+
+    // Copies every element to destination, advancing destinationStride bytes per element.
+    // Packed sources copied into packed destinations are a single memcpy.
+    void CopyTo(T* destination, size_t destinationStride = sizeof(T) * Components) const
+    {
+        if (IsPacked() && destinationStride == m_Stride)
+        {
+            std::memcpy(destination, m_Data, m_Count * m_Stride);
+            return;
+        }
+
+        m_CopyFunction(m_Data, m_Stride, m_Count, destination, destinationStride);
+    }
+
+    // The glTF component type that stores T without conversion
+    template <typename Type>
+    static constexpr int ComponentTypeOf()
+    {
+        if constexpr (std::is_same_v<Type, float>) return TINYGLTF_COMPONENT_TYPE_FLOAT;
+        else if constexpr (std::is_same_v<Type, uint32_t>) return TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
+        else if constexpr (std::is_same_v<Type, uint16_t>) return TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+        else if constexpr (std::is_same_v<Type, int16_t>) return TINYGLTF_COMPONENT_TYPE_SHORT;
+        else if constexpr (std::is_same_v<Type, uint8_t>) return TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+        else if constexpr (std::is_same_v<Type, int8_t>) return TINYGLTF_COMPONENT_TYPE_BYTE;
+        else return -1;
+    }
+
+private:
+    using CopyFunction = void (*)(const unsigned char* source, size_t sourceStride, size_t count, T* destination, size_t destinationStride);
+
+    const unsigned char* m_Data;
+    size_t m_Stride;
+    size_t m_Count;
+    int m_ComponentType;
+    int m_SourceComponents;
+    bool m_Normalized;
+    CopyFunction m_CopyFunction;
+
+    size_t ElementSize() const
+    {
+        return static_cast<size_t>(tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(m_ComponentType)) * m_SourceComponents);
+    }
+
+    // The conversion loop for one source component type
+    template <typename Source, bool Normalized>
+    static void Copy(const unsigned char* source, size_t sourceStride, size_t count, T* destination, size_t destinationStride)
+    {
+        unsigned char* output = reinterpret_cast<unsigned char*>(destination);
+        for (size_t i = 0; i < count; ++i)
+        {
+            Source values[Components];
+            std::memcpy(values, source + i * sourceStride, sizeof(values));
+
+            T converted[Components];
+            for (int c = 0; c < Components; ++c)
+                converted[c] = ComponentConverter<T, Source, Normalized>::Convert(values[c]);
+
+            std::memcpy(output + i * destinationStride, converted, sizeof(converted));
+        }
+    }
+
+    template <typename Source>
+    CopyFunction SelectForSource() const
+    {
+        // Normalization only applies to integer components read as floats
+        if constexpr (std::is_floating_point_v<T> && std::is_integral_v<Source>)
+        {
+            if (m_Normalized)
+                return &AccessorView::Copy<Source, true>;
+        }
+        return &AccessorView::Copy<Source, false>;
+    }
+
+    CopyFunction SelectCopyFunction() const
+    {
+        switch (m_ComponentType)
+        {
+        case TINYGLTF_COMPONENT_TYPE_FLOAT: return SelectForSource<float>();
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: return SelectForSource<uint32_t>();
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return SelectForSource<uint16_t>();
+        case TINYGLTF_COMPONENT_TYPE_SHORT: return SelectForSource<int16_t>();
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return SelectForSource<uint8_t>();
+        case TINYGLTF_COMPONENT_TYPE_BYTE: return SelectForSource<int8_t>();
+        default:
+            throw std::runtime_error("Unsupported accessor component type " + std::to_string(m_ComponentType));
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+
+#include "glm/glm.hpp"
+
+// An axis-aligned bounding box and a bounding sphere around the centre of the box.
+// The sphere is often much tighter than the one through the box corners, so it is kept separately for culling and LOD selection.
+struct Bounds
+{
+    glm::vec3 m_Min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 m_Max = glm::vec3(-std::numeric_limits<float>::max());
+    float m_Radius = 0.0f; // bounding sphere centred at GetCenter()
+
+    bool IsEmpty() const { return m_Min.x > m_Max.x; }
+    glm::vec3 GetCenter() const { return (m_Min + m_Max) * 0.5f; }
+    glm::vec3 GetExtents() const { return (m_Max - m_Min) * 0.5f; }
+
+    // Grows the bounds to enclose other
+    void Merge(const Bounds& other);
+
+    // Bounds of the transformed volume: the box around the transformed box and the sphere scaled by the largest axis scale
+    Bounds Transform(const glm::mat4& matrix) const;
+
+    // Box from known extremes, e.g. glTF accessor min/max. The sphere is the one through the box corners.
+    static Bounds FromBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    // Scans count positions, stride bytes apart, with a SIMD min/max reduction and a second pass for the sphere radius
+    static Bounds FromPositions(const void* positions, size_t count, size_t stride);
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef BVHBUILDER_H
+#define BVHBUILDER_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+class ThreadPool;
+
+// Top-down construction of binary bounding volume hierarchies with the binned surface area heuristic (SAH).
+// Every split sorts the primitive centroids into BIN_COUNT bins per axis and takes the bin boundary with the lowest
+// expected ray traversal cost. Once the top of the tree has split the primitives into enough subtrees, those are
+// built in parallel. Used for the per-mesh triangle hierarchies (MeshBvh) and the scene hierarchy over mesh instances (SceneBvh).
+class BvhBuilder
+{
+public:
+    static const unsigned int BIN_COUNT = 16;
+
+    struct Node
+    {
+        glm::vec3 m_Min;
+        uint32_t m_First; // leaf: first entry of the primitive order; interior: left child, the right child follows it
+        glm::vec3 m_Max;
+        uint32_t m_Count; // primitives in a leaf, 0 for interior nodes
+
+        bool IsLeaf() const { return m_Count > 0; }
+    };
+
+    // Builds a hierarchy over the primitives boxMin[i]..boxMax[i]. nodes[0] is the root and children always follow their parent.
+    // order receives the primitive indices, grouped so every leaf references a contiguous range of it. Leaves hold at
+    // most maxLeafSize primitives. Large subtrees are built on pool when it is not null.
+    static void Build(const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax, size_t maxLeafSize, ThreadPool* pool,
+        std::vector<Node>& nodes, std::vector<uint32_t>& order);
+
+    // Half the surface area of a box, which is all the SAH needs
+    static float GetHalfArea(const glm::vec3& boxMin, const glm::vec3& boxMax);
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef FRUSTUMCULLER_H
+#define FRUSTUMCULLER_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "Bounds.h"
+
+// Culls world-space bounding boxes against the view frustum in batches.
+// The boxes are kept as structure of arrays of centres and half extents, padded to BATCH_SIZE, so each frustum plane is
+// tested against 8 boxes at once with AVX and 4 with SSE2 or NEON.
+class FrustumCuller
+{
+public:
+    static const size_t BATCH_SIZE = 8; // boxes are padded to a multiple of the widest batch
+
+    // Without a frustum nothing is culled
+    FrustumCuller() { for (glm::vec4& plane : m_Planes) plane = glm::vec4(0.0f); }
+
+    // Extracts the six normalized frustum planes (Gribb & Hartmann) of a clip matrix. Points inside have a non-negative
+    // distance to every plane. With clip = projection * view * model the planes are in model space.
+    static void ExtractPlanes(const glm::mat4& clip, glm::vec4 planes[6]);
+
+    // Sets the frustum the boxes are culled against
+    void SetViewProjection(const glm::mat4& viewProjection) { ExtractPlanes(viewProjection, m_Planes); }
+
+    // Removes every box, keeping the memory for the next frame
+    void Clear() { m_Count = 0; }
+
+    // Appends a box and returns its index
+    size_t AddBox(const Bounds& bounds);
+
+    size_t Size() const { return m_Count; }
+
+    // Appends the indices of the boxes that intersect or lie inside the frustum to visible, in increasing order
+    void Cull(std::vector<uint32_t>& visible) const;
+
+private:
+    glm::vec4 m_Planes[6];
+    size_t m_Count = 0;
+    std::vector<float> m_CenterX, m_CenterY, m_CenterZ;
+    std::vector<float> m_ExtentX, m_ExtentY, m_ExtentZ;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef GLSTATECACHE_H
+#define GLSTATECACHE_H
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <glad.h>
+
+// Shadow copy of the GL bindings the draw path changes: program, vertex array, buffer targets and shader storage
+// bindings, texture and sampler units, and enable/disable capabilities. Calls that would not change the state are
+// dropped. State is unknown until first set and after Invalidate(), which code that calls GL directly must follow.
+class GLStateCache
+{
+public:
+    static const int MAX_TEXTURE_UNITS = 32;
+    static const int MAX_STORAGE_BINDINGS = 16;
+
+    // GL calls passed on to the driver and dropped as redundant
+    struct Stats
+    {
+        size_t m_Issued = 0;
+        size_t m_Skipped = 0;
+    };
+
+    GLStateCache() { Invalidate(); }
+    virtual ~GLStateCache() {}
+
+    // Forgets every binding, so the next call of each kind reaches the driver
+    void Invalidate();
+
+    void UseProgram(GLuint program);
+    void BindVertexArray(GLuint vertexArray);
+
+    // Element array bindings belong to the bound vertex array and are tracked only until it changes
+    void BindBuffer(GLenum target, GLuint buffer);
+
+    // Also binds the generic target, as GL does
+    void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+
+    // Selects the texture unit itself; only GL_TEXTURE_2D bindings are tracked
+    void BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+    void BindSampler(GLuint unit, GLuint sampler);
+
+    void SetEnabled(GLenum capability, bool enabled);
+    void Enable(GLenum capability) { SetEnabled(capability, true); }
+    void Disable(GLenum capability) { SetEnabled(capability, false); }
+
+    const Stats& GetStats() const { return m_Stats; }
+    void ResetStats() { m_Stats = Stats(); }
+
+private:
+    // Buffer targets with a shadow binding
+    enum BufferSlot
+    {
+        ArrayBufferSlot,
+        ElementArrayBufferSlot,
+        CopyReadBufferSlot,
+        CopyWriteBufferSlot,
+        DrawIndirectBufferSlot,
+        ParameterBufferSlot,
+        ShaderStorageBufferSlot,
+        UniformBufferSlot,
+        BufferSlotCount
+    };
+
+    static const GLuint UNKNOWN = ~0u;
+
+    GLuint m_Program;
+    GLuint m_VertexArray;
+    GLuint m_Buffers[BufferSlotCount];
+    GLuint m_StorageBindings[MAX_STORAGE_BINDINGS];
+    GLuint m_ActiveTexture;
+    GLuint m_Textures[MAX_TEXTURE_UNITS];
+    GLuint m_Samplers[MAX_TEXTURE_UNITS];
+    std::vector<std::pair<GLenum, bool>> m_Capabilities; // known enable states
+    Stats m_Stats;
+
+    // Records a call: true when it changes the shadow value and must be issued
+    bool Update(GLuint& shadow, GLuint value);
+
+    void ActiveTexture(GLuint unit);
+
+    // Index into m_Buffers, or BufferSlotCount for untracked targets
+    static int GetBufferSlot(GLenum target);
+};
+
+#endif
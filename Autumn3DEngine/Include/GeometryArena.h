@@ -0,0 +1,65 @@
+#ifndef GEOMETRYARENA_H
+#define GEOMETRYARENA_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Model.h"
+#include "RangeAllocator.h"
+
+// Shared GPU storage for mesh geometry. Every vertex layout has pages made of one large vertex buffer and one large
+// index buffer behind a single VAO, and each mesh is a pair of ranges sub-allocated from a page (see RangeAllocator).
+// All meshes of a page draw from the same VAO, so consecutive draws need no rebinding. A page doubles its buffers
+// when it runs out of space until they reach MAX_PAGE_SIZE, after which a new page is started.
+class GeometryArena
+{
+public:
+    static const uint64_t INITIAL_PAGE_SIZE = 4ull << 20; // bytes of a new page's vertex and index buffers
+    static const uint64_t MAX_PAGE_SIZE = 256ull << 20;   // pages stop growing here; a larger mesh gets a page of its own
+
+    GeometryArena() {}
+    virtual ~GeometryArena() {}
+
+    // Uploads a mesh's vertices, packed in mesh.m_VertexLayout, and its indices, in mesh.m_IndexType, and fills
+    // mesh.m_GpuGeometry. Must be called on the GL thread.
+    void Upload(Model::Mesh& mesh, const void* vertices, uint64_t vertexSize, const void* indices, uint64_t indexSize);
+
+    // Returns the mesh's ranges to their page
+    void Free(Model::Mesh& mesh);
+
+    // Deletes every buffer and VAO. Meshes uploaded before must not be drawn afterwards.
+    void Clear();
+
+    size_t GetPageCount() const { return m_Pages.size(); }
+
+    // Bytes of GL buffer storage and the part of it handed out to meshes
+    uint64_t GetCapacity() const;
+    uint64_t GetUsed() const;
+
+private:
+    struct Page
+    {
+        VertexLayout m_Layout;
+        unsigned int m_VertexArray = 0;
+        unsigned int m_VertexBuffer = 0;
+        unsigned int m_IndexBuffer = 0;
+        RangeAllocator m_Vertices; // bytes of m_VertexBuffer
+        RangeAllocator m_Indices;  // bytes of m_IndexBuffer
+    };
+
+    std::vector<Page> m_Pages;
+
+    // Allocates a range of a page's vertex or index buffer, doubling the buffer while it stays under MAX_PAGE_SIZE
+    uint64_t AllocateRange(Page& page, bool vertexRange, uint64_t size, uint64_t alignment);
+
+    // Moves a page's vertex or index buffer into a new buffer of the given capacity. The VAO keeps its name.
+    void GrowBuffer(Page& page, bool vertexBuffer, uint64_t capacity);
+
+    // Points the page's VAO at its buffers with the attribute layout of page.m_Layout
+    void SetupVertexArray(const Page& page);
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef GLTFBUFFERS_H
+#define GLTFBUFFERS_H
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "tiny_gltf.h"
+
+// The bytes of every buffer of a glTF model.
+// Buffers loaded by tinygltf are referenced in place; a memory-mapped GLB binds its BIN chunk instead,
+// so the binary payload is read straight from the mapping and never copied.
+class GltfBuffers
+{
+public:
+    struct Span
+    {
+        const unsigned char* m_Data;
+        size_t m_Size;
+    };
+
+    GltfBuffers() {}
+
+    // References the buffers owned by a tinygltf model
+    explicit GltfBuffers(const tinygltf::Model& gltfModel) { Reset(gltfModel); }
+
+    void Reset(const tinygltf::Model& gltfModel)
+    {
+        m_Buffers.clear();
+        m_Buffers.reserve(gltfModel.buffers.size());
+        for (const auto& buffer : gltfModel.buffers)
+            m_Buffers.push_back({ buffer.data.data(), buffer.data.size() });
+    }
+
+    // Points a buffer at external memory, e.g. the BIN chunk of a mapped GLB
+    void Bind(size_t bufferIndex, const unsigned char* data, size_t size) { m_Buffers.at(bufferIndex) = { data, size }; }
+
+    const Span& operator[](size_t bufferIndex) const
+    {
+        if (bufferIndex >= m_Buffers.size())
+            throw std::runtime_error("Buffer " + std::to_string(bufferIndex) + " does not exist.");
+        return m_Buffers[bufferIndex];
+    }
+
+private:
+    std::vector<Span> m_Buffers;
+};
+
+#endif
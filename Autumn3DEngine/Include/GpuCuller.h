@@ -0,0 +1,111 @@
+#ifndef GPUCULLER_H
+#define GPUCULLER_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "Bounds.h"
+#include "GLStateCache.h"
+#include "IndirectDrawList.h"
+#include "Shader.h"
+
+// Instance visibility on the GPU. A compute pass tests the world bounds of every instance of an IndirectDrawList
+// against the view frustum and a Hi-Z depth pyramid and compacts the commands of the survivors, per call, into an
+// indirect buffer with atomic counters, so the CPU never reads per-object visibility.
+//
+// Culling runs in two phases to avoid popping when the camera turns quickly (Haar & Aaltonen):
+//   1. draw the instances visible last frame that are still in the frustum,
+//   2. build the Hi-Z pyramid from that depth, test every instance against it and draw the ones phase 1 missed.
+// The visibility written by phase 2 is next frame's phase 1 set.
+class GpuCuller
+{
+public:
+    static const int WORK_GROUP_SIZE = 64;      // CullComputeShader.glsl local_size_x
+    static const int HIZ_WORK_GROUP_SIZE = 8;   // HiZComputeShader.glsl local_size_x and local_size_y
+
+    // Signature of glMultiDrawElementsIndirectCount and glMultiDrawElementsIndirectCountARB
+    typedef void (APIENTRYP DrawIndirectCountProc)(GLenum mode, GLenum type, const void* indirect, GLintptr drawCount,
+        GLsizei maxDrawCount, GLsizei stride);
+
+    GpuCuller() {}
+    virtual ~GpuCuller() {}
+
+    // Loads the compute programs. Without drawIndirectCount (GL 4.6 or ARB_indirect_parameters) the culled commands
+    // are drawn at their full count, with the rejected ones zeroed.
+    void Initialize(const char* cullShaderPath, const char* hiZShaderPath, DrawIndirectCountProc drawIndirectCount, GLStateCache& state);
+
+    bool IsInitialized() const { return m_CullShader != nullptr; }
+
+    // Binds the offscreen framebuffer the frame is rendered into, since the Hi-Z pyramid is built from its depth texture.
+    // Remembers the draw framebuffer bound before as the frame's target. Invalidates the state cache when the framebuffer is recreated.
+    void BeginFrame(int width, int height, GLStateCache& state);
+
+    // Starts collecting the instances of a frame
+    void Clear() { m_Bounds.clear(); m_IdCount = 0; }
+
+    // Appends the world bounds of the next IndirectDrawList instance. The ID names the instance from frame to frame and
+    // keys its visibility; IDs should be dense, since the visibility buffers hold one entry per ID up to the largest.
+    void AddInstance(const Bounds& bounds, uint32_t id);
+
+    // Culls and draws the draws of the list in both phases, with drawOffset the draw shader's drawOffset uniform.
+    // Leaves the draw shader in use.
+    void Draw(IndirectDrawList& draws, const glm::mat4& viewProjection, const Shader& drawShader, UniformHandle<int> drawOffset,
+        GLStateCache& state);
+
+    // Copies the frame to the framebuffer that was bound at BeginFrame() and binds it again
+    void EndFrame();
+
+    // Deletes the GL objects; Initialize() must be called again before the next frame
+    void Release();
+
+private:
+    std::shared_ptr<Shader> m_CullShader;
+    std::shared_ptr<Shader> m_HiZShader;
+    UniformHandle<glm::mat4> m_ViewProjectionUniform;
+    UniformHandle<glm::vec4> m_FrustumPlanesUniform;
+    UniformHandle<int> m_CommandCountUniform;
+    UniformHandle<int> m_CallCountUniform;
+    UniformHandle<glm::vec2> m_ScreenSizeUniform;
+    UniformHandle<int> m_HiZLevelsUniform;
+    UniformHandle<int> m_PhaseUniform;
+    UniformHandle<bool> m_CopyDepthUniform;
+    DrawIndirectCountProc m_DrawIndirectCount = nullptr;
+
+    std::vector<glm::vec4> m_Bounds; // minimum and maximum corner of every instance, the ID in the minimum's w
+    size_t m_IdCount = 0;            // largest instance ID of the frame + 1
+
+    int m_Width = 0;
+    int m_Height = 0;
+    int m_HiZLevels = 0;
+    unsigned int m_Framebuffer = 0;
+    int m_TargetFramebuffer = 0; // draw framebuffer bound when the frame began
+    unsigned int m_ColorBuffer = 0;
+    unsigned int m_DepthTexture = 0;
+    unsigned int m_HiZTexture = 0;
+
+    // Shader storage buffers, see CullComputeShader.glsl
+    unsigned int m_InputCommands = 0;
+    unsigned int m_InputData = 0;
+    unsigned int m_CallFirsts = 0;
+    unsigned int m_InstanceBounds = 0;
+    unsigned int m_Visibility[2] = { 0, 0 }; // last frame's and this frame's, swapped every frame
+    unsigned int m_OutputCommands = 0;        // both phases, each laid out like the input
+    unsigned int m_OutputData = 0;
+    unsigned int m_Counters = 0;              // surviving commands per phase and call
+    size_t m_VisibilityCount = 0;             // entries of m_Visibility, indexed by instance ID
+    int m_CurrentVisibility = 0;
+
+    // Runs the cull pass of a phase and draws its survivors
+    void CullAndDraw(int phase, const IndirectDrawList& draws, const Shader& drawShader, UniformHandle<int> drawOffset,
+        GLStateCache& state);
+
+    // Reduces the depth texture into m_HiZTexture, keeping the farthest depth of every texel
+    void BuildHiZ(GLStateCache& state);
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef INDIRECTDRAWLIST_H
+#define INDIRECTDRAWLIST_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "GLStateCache.h"
+#include "Shader.h"
+
+// Collects a frame's draws as glMultiDrawElementsIndirect commands instead of issuing them one mesh at a time.
+// Per-draw data lives in a shader storage buffer that the indirect vertex shader reads at drawOffset + gl_DrawID.
+// Draws that share a VAO, an index type and a texture go out in one call, so a frame costs a handful of calls
+// regardless of how many meshes are visible. Needs GL 4.3 and ARB_shader_draw_parameters.
+class IndirectDrawList
+{
+public:
+    // Matches the std430 DrawData struct of IndirectVertexShader.glsl
+    struct DrawData
+    {
+        glm::mat4 m_ModelMatrix;
+        glm::vec4 m_PositionOffset; // compact layouts store positions relative to the mesh bounds
+        glm::vec4 m_PositionScale;
+        uint32_t m_Material;        // texture sampled by the draw, which also selects its call
+        uint32_t m_PackedVertex;    // 1 for compact vertex layouts
+        uint32_t m_Instance;        // AddInstance() index, which GPU culling tests
+        uint32_t m_Call;            // index into GetCalls()
+    };
+
+    // The GL DrawElementsIndirectCommand layout
+    struct Command
+    {
+        uint32_t m_Count;
+        uint32_t m_InstanceCount;
+        uint32_t m_FirstIndex;
+        int32_t m_BaseVertex;
+        uint32_t m_BaseInstance;
+    };
+
+    // A run of commands issued with one glMultiDrawElementsIndirect
+    struct Call
+    {
+        unsigned int m_VertexArray;
+        unsigned int m_IndexType;
+        unsigned int m_Texture;
+        uint32_t m_First; // first command
+        uint32_t m_Count;
+    };
+
+    IndirectDrawList() {}
+    virtual ~IndirectDrawList() {}
+
+    // Starts a new frame
+    void Clear();
+
+    // Adds the data shared by the draws of one mesh instance and returns its index for AddDraw()
+    uint32_t AddInstance(const glm::mat4& modelMatrix, const glm::vec3& positionOffset, const glm::vec3& positionScale, bool packedVertex);
+
+    // Adds an index range of a mesh instance. The offset is in bytes into the VAO's index buffer.
+    void AddDraw(unsigned int vertexArray, unsigned int indexType, unsigned int texture, uint32_t instance,
+        uint32_t indexCount, size_t indexOffset, int32_t baseVertex);
+
+    // Sorts the draws into calls, one per VAO, index type and texture, and fills GetCommands(), GetDrawData() and GetCalls()
+    void Build();
+
+    // Builds the calls, uploads the commands and per-draw data and issues every call.
+    // The shader must be in use; drawOffset is its drawOffset uniform and the texture is bound to unit 0.
+    void Submit(const Shader& shader, UniformHandle<int> drawOffset, GLStateCache& state);
+
+    // Deletes the GL buffers
+    void Release();
+
+    // Draws and glMultiDrawElementsIndirect calls of the last Submit()
+    size_t GetDrawCount() const { return m_DrawCount; }
+    size_t GetCallCount() const { return m_CallCount; }
+
+    size_t GetInstanceCount() const { return m_Instances.size(); }
+
+    // Results of the last Build()
+    const std::vector<Command>& GetCommands() const { return m_Commands; }
+    const std::vector<DrawData>& GetDrawData() const { return m_DrawData; }
+    const std::vector<Call>& GetCalls() const { return m_Calls; }
+
+private:
+    struct Draw
+    {
+        unsigned int m_VertexArray;
+        unsigned int m_IndexType;
+        unsigned int m_Texture;
+        uint32_t m_Instance;
+        Command m_Command;
+    };
+
+    std::vector<DrawData> m_Instances;
+    std::vector<Draw> m_Draws;
+    std::vector<Command> m_Commands;  // m_Draws sorted into calls, rebuilt by Build()
+    std::vector<DrawData> m_DrawData; // one per command
+    std::vector<Call> m_Calls;
+    unsigned int m_CommandBuffer = 0;
+    unsigned int m_DataBuffer = 0;
+    size_t m_DrawCount = 0;
+    size_t m_CallCount = 0;
+};
+
+#endif
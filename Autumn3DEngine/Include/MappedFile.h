@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// A read-only memory mapping of a whole file. The bytes stay valid for the lifetime of the object.
+class MappedFile
+{
+public:
+    // Maps the file. Throws if it cannot be opened or mapped.
+    explicit MappedFile(const std::string& path);
+
+    // Unmaps the file
+    virtual ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* Data() const { return m_Data; }
+    size_t Size() const { return m_Size; }
+    const std::string& Path() const { return m_Path; }
+
+private:
+    std::string m_Path;
+    const unsigned char* m_Data;
+    size_t m_Size;
+
+#ifdef _WIN32
+    void* m_FileHandle;
+    void* m_MappingHandle;
+#else
+    int m_FileDescriptor;
+#endif
+};
+
+#endif
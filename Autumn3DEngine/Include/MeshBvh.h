@@ -0,0 +1,28 @@
+#ifndef MESHBVH_H
+#define MESHBVH_H
+
+#pragma once
+
+#include <cstdint>
+
+#include "glm/glm.hpp"
+#include "Model.h"
+
+// Builds and traverses the per-mesh ray query hierarchies (Model::Mesh::Bvh), the bottom level under SceneBvh.
+// The binary SAH hierarchy from BvhBuilder is collapsed into 4-wide nodes, so a ray is tested against four child boxes,
+// and then against the up to four triangles of a leaf, at once with SSE2 or NEON.
+class MeshBvh
+{
+public:
+    static const size_t LEAF_SIZE = 4; // triangles per leaf, one SIMD test
+
+    // Fills mesh.m_Bvh from LOD 0 of the mesh's CPU or cooked data. threadCount threads share the build of a large mesh.
+    static void Build(Model::Mesh& mesh, unsigned int threadCount);
+
+    // Finds the nearest triangle hit by origin + t * direction for t in (0, maxDistance). direction need not be normalized;
+    // distance is returned in units of its length. triangle is the Model::Mesh::Bvh::m_TriangleIds entry of the hit.
+    static bool Intersect(const Model::Mesh::Bvh& bvh, const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+        float& distance, uint32_t& triangle);
+};
+
+#endif
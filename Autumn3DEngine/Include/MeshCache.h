@@ -0,0 +1,128 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "Model.h"
+
+// The engine-native cooked mesh cache (.a3dmesh).
+// A cache file holds the GPU-ready vertex, index and texture blobs of every mesh of a model behind a small table of contents,
+// keyed by a hash of the source file and the import options that shape the mesh data. It is loaded with a memory mapping, so a cache hit does no parsing and the mapped
+// bytes are handed straight to glBufferData / glTexImage2D.
+//
+// Layout: Header | MeshEntry[meshCount] | SubmeshEntry[submeshCount] | TextureEntry[textureCount] | LodEntry[lodCount] | NodeEntry[nodeCount] | blobs (each aligned to BLOB_ALIGNMENT)
+// The vertex blob of a mesh holds its records in the mesh's VertexLayout, with positions of the compact layouts quantized to the entry's bounds.
+// An image shared by several meshes is stored once; their texture entries point at the same pixel blob.
+// The meshlet blob of a mesh holds its Model::Mesh::Meshlets bounds streams followed by the first-triangle and triangle-count arrays.
+// The BVH blob of a mesh holds its Model::Mesh::Bvh nodes, triangles, triangle ids and positions in that order.
+// The node table is the model's TransformHierarchy in depth-first order, with the mesh each node instances.
+class MeshCache
+{
+public:
+    static const uint32_t MAGIC = 0x4D443341; // "A3DM"
+    static const uint32_t VERSION = 11;
+    static const uint64_t BLOB_ALIGNMENT = 16;
+
+    struct Header
+    {
+        uint32_t m_Magic;
+        uint32_t m_Version;
+        uint64_t m_SourceHash;
+        uint64_t m_ImportOptions; // Model::GetCacheOptions() of the import that wrote the cache
+        uint32_t m_MeshCount;
+        uint32_t m_TextureCount;
+        uint32_t m_LodCount;
+        uint32_t m_SubmeshCount;
+        uint32_t m_NodeCount;
+        uint32_t m_Reserved;
+    };
+
+    struct MeshEntry
+    {
+        uint64_t m_VertexOffset;
+        uint64_t m_VertexCount;
+        uint64_t m_IndexOffset;
+        uint64_t m_IndexCount;
+        uint32_t m_IndexType;    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT; the blob is stored in this type
+        uint32_t m_FirstTexture; // index of the mesh's first TextureEntry
+        uint32_t m_TextureCount;
+        uint32_t m_VertexLayout; // VertexLayout of the vertex blob
+        uint32_t m_FirstSubmesh; // index of the mesh's first SubmeshEntry
+        uint32_t m_SubmeshCount;
+        uint64_t m_MeshletOffset;
+        uint32_t m_MeshletCount;
+        uint32_t m_BvhNodeCount;
+        uint64_t m_BvhOffset;
+        uint32_t m_BvhTriangleCount;
+        uint32_t m_BvhPositionCount;
+        float m_QuantizeMin[3];  // bounds the packed positions are quantized to, the merged bounds of the submeshes
+        float m_QuantizeMax[3];
+    };
+
+    struct SubmeshEntry
+    {
+        uint64_t m_BaseVertex;   // relative to the mesh's vertices
+        uint64_t m_VertexCount;
+        int32_t m_Material;
+        int32_t m_Texture;       // relative to the mesh's first TextureEntry, -1 if none
+        uint32_t m_FirstLod;     // index of the submesh's first LodEntry
+        uint32_t m_LodCount;
+        uint32_t m_FirstMeshlet; // relative to the mesh's meshlets
+        uint32_t m_MeshletCount;
+        float m_BoundsMin[3];    // object-space bounds, so a cache hit never scans the vertices
+        float m_BoundsMax[3];
+        float m_BoundsRadius;
+        uint32_t m_Reserved;
+    };
+
+    struct TextureEntry
+    {
+        uint64_t m_PixelOffset;
+        uint64_t m_PixelSize;
+        uint64_t m_ContentHash;
+        int32_t m_Width;
+        int32_t m_Height;
+        int32_t m_Components;
+        int32_t m_Reserved;
+    };
+
+    struct LodEntry
+    {
+        uint64_t m_FirstIndex;
+        uint64_t m_IndexCount;
+        float m_Error;
+        uint32_t m_Reserved;
+    };
+
+    struct NodeEntry
+    {
+        uint32_t m_Parent;  // index of an earlier NodeEntry, TransformHierarchy::NO_PARENT for the root
+        int32_t m_Mesh;     // mesh instanced at the node, -1 if none
+        float m_Local[16];  // column-major local transform
+    };
+
+    // Returns the cache path used for a source model
+    static std::string GetCachePath(const std::string& modelPath);
+
+    // Hashes the contents of a file. Used as the cache key.
+    static uint64_t HashFile(const MappedFile& file);
+
+    // Hashes a block of memory with the same function as HashFile
+    static uint64_t HashBytes(const unsigned char* data, size_t size);
+
+    // Maps the cache, fills meshes with views into it and restores the node hierarchy. Returns null if the cache is missing, stale or malformed.
+    static std::shared_ptr<MappedFile> Load(const std::string& cachePath, uint64_t sourceHash, uint64_t importOptions, std::vector<std::shared_ptr<Model::Mesh>>& meshes,
+        TransformHierarchy& transforms, std::vector<Model::MeshInstance>& instances);
+
+    // Writes the meshes of an imported model to a cache file. The file is written to a temporary path and renamed, so readers never see a partial cache.
+    static void Write(const std::string& cachePath, uint64_t sourceHash, uint64_t importOptions, const std::vector<std::shared_ptr<Model::Mesh>>& meshes,
+        const TransformHierarchy& transforms, const std::vector<Model::MeshInstance>& instances);
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Model.h"
+
+// Import-time index and vertex reordering for GPU efficiency.
+// Triangles are first ordered for the post-transform vertex cache (Tipsify, Sander et al. 2007), then the clusters that
+// Tipsify produces are sorted for overdraw, and finally vertices are renumbered in first-use order for fetch locality.
+class MeshOptimizer
+{
+public:
+    static const unsigned int CACHE_SIZE = 16;
+
+    struct CacheStatistics
+    {
+        float m_ACMR = 0.0f; // average cache miss ratio: transformed vertices per triangle (0.5 - 3, lower is better)
+        float m_ATVR = 0.0f; // average transform to vertex ratio: transformed vertices per unique vertex (1 is optimal)
+    };
+
+    // Simulates a FIFO post-transform cache over an index buffer
+    static CacheStatistics AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = CACHE_SIZE);
+
+    // Reorders triangles for vertex cache locality. clusters receives the first triangle of every run Tipsify started
+    // after a dead end; these runs can be reordered freely without hurting cache efficiency much.
+    static void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount, std::vector<size_t>& clusters, unsigned int cacheSize = CACHE_SIZE);
+
+    // Sorts clusters so outward-facing ones on the far side of the mesh centre are drawn first, which reduces overdraw
+    static void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Model::Mesh::Vertex* vertices, size_t vertexCount, const std::vector<size_t>& clusters);
+
+    // Renumbers vertices in the order the index buffer first uses them. Unreferenced vertices are moved to the end.
+    static void OptimizeVertexFetch(std::vector<Model::Mesh::Vertex>& vertices, unsigned int* indices, size_t indexCount);
+
+    // Runs all three passes on an indexed triangle list, e.g. one submesh, and reports the cache statistics before and after
+    static void Optimize(std::vector<Model::Mesh::Vertex>& vertices, std::vector<unsigned int>& indices, CacheStatistics& before, CacheStatistics& after);
+};
+
+#endif
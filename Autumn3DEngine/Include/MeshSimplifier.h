@@ -0,0 +1,28 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Model.h"
+
+// Quadric error metric simplification (Garland & Heckbert) and level-of-detail chains.
+// Edges are collapsed onto one of their endpoints, so every LOD indexes the mesh's original vertex array and all LODs
+// share one vertex buffer. Vertices on open borders, on non-manifold edges and on attribute seams (several vertices at
+// one position with different normals or UVs) never move, which keeps silhouettes and texture seams intact.
+class MeshSimplifier
+{
+public:
+    // Simplifies an indexed triangle list towards targetIndexCount, stopping early rather than exceeding maxError.
+    // Returns the object-space error of the result.
+    static float Simplify(const Model::Mesh::Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+        size_t targetIndexCount, float maxError, std::vector<unsigned int>& result);
+
+    // Appends up to lodCount levels per submesh, each about half the triangles of the previous one, to mesh.m_Indices and
+    // describes every level in the submesh's m_Lods. Stops early once a level no longer shrinks.
+    static void BuildLods(Model::Mesh& mesh, unsigned int lodCount);
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef MESHLETBUILDER_H
+#define MESHLETBUILDER_H
+
+#pragma once
+
+#include <cstddef>
+
+#include "Model.h"
+
+// Splits LOD 0 of a mesh into meshlets: small clusters of triangles that are culled individually.
+// Meshlets are grown greedily from a seed triangle, preferring neighbours that add no new vertices and then the ones
+// closest to the cluster centre, which keeps clusters compact and their bounds tight. Every meshlet gets a bounding
+// sphere for frustum culling and a normal cone (Shirman & Abi-Ezzi) for rejecting clusters that face away from the camera.
+class MeshletBuilder
+{
+public:
+    static const unsigned int MAX_VERTICES = 64;
+    static const unsigned int MAX_TRIANGLES = 124;
+
+    // Splits LOD 0 of every submesh, reorders its triangles so every meshlet is a contiguous run of m_Indices and fills
+    // mesh.m_Meshlets. Submeshes that fit in a single meshlet are left without meshlets.
+    static void Build(Model::Mesh& mesh);
+
+private:
+    // Appends the meshlets of one submesh to mesh.m_Meshlets, without their bounds
+    static void BuildSubmesh(Model::Mesh& mesh, Model::Mesh::Submesh& submesh);
+};
+
+#endif
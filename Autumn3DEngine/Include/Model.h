@@ -3,18 +3,59 @@
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 #include <map>
 
 #include "tiny_gltf.h"
 #include "glm/glm.hpp"
+#include "Bounds.h"
+#include "TransformHierarchy.h"
 
 #define MAX_BONE_INFLUENCE 4
 
 using namespace std;
 
+// What happens to the CPU copy of a mesh once it is uploaded to the GPU.
+enum class MeshResidency
+{
+    KeepCpuCopy,       // keep vertices, indices and pixels in memory
+    ReleaseAfterUpload // free them after upload; Model::RestoreCpuData() re-fetches them from the cache or the source
+};
+
+// GPU vertex layout of a mesh. See VertexFormat.
+enum class VertexLayout : uint32_t
+{
+    Full,    // Model::Mesh::Vertex as-is, 88 bytes
+    Static,  // quantized position, octahedral normal and tangent, half float UV, 20 bytes
+    Skinned  // Static plus u8 joints and unorm8 weights, 28 bytes
+};
+
+// Options that control how a model is imported.
+struct ModelImportSettings
+{
+    unsigned int m_ThreadCount = 0; // worker threads used to process meshes (0 = all hardware threads, 1 = serial)
+    bool m_UseMeshCache = true;     // load from / write to the cooked mesh cache (<model>.a3dmesh) next to the source file
+    bool m_MapSourceFile = true;    // parse .glb files in place from a memory mapping instead of reading and copying them
+    MeshResidency m_Residency = MeshResidency::ReleaseAfterUpload;
+    bool m_CompactVertices = true;  // upload meshes in the compact Static/Skinned layouts instead of the full 88 byte vertex
+    bool m_WeldVertices = true;     // merge duplicate vertices at import
+    float m_WeldEpsilon = 0.0f;     // grid size for merging nearly equal vertices; 0 merges bit-identical vertices only
+    bool m_OptimizeMeshes = true;   // reorder triangles and vertices for the vertex cache, overdraw and vertex fetch (stored in the mesh cache)
+    unsigned int m_LodCount = 4;    // simplified levels of detail generated per mesh, each about half the previous one (0 = none)
+    bool m_BuildMeshlets = true;    // split LOD 0 of every mesh into meshlets that are frustum and backface culled individually
+    bool m_BuildOccluders = true;   // keep a coarse copy of every mesh that the CPU occlusion culler rasterizes
+    bool m_BuildBvh = false;        // build a ray query hierarchy over LOD 0 of every mesh for picking (stored in the mesh cache);
+                                    // it keeps its own copy of the positions and triangles, so only models that are picked should enable it
+};
+
+class GltfBuffers;
+class MappedFile;
+
 class Model
 {
 public:
@@ -38,34 +79,232 @@ public:
             string m_TextureType;
         };
 
+        // A decoded glTF image. One copy exists per image of a model and is shared by every mesh that samples it.
+        struct TextureImage
+        {
+            int m_ImageIndex;       // glTF image index
+            uint64_t m_ContentHash; // hash of the pixels, identifies the image across models
+            int m_Width;
+            int m_Height;
+            int m_Components;
+            vector<unsigned char> m_Pixels;
+        };
+
+        // A level of detail: a range of m_Indices drawn instead of the full submesh. All levels share the vertex buffer.
+        struct Lod
+        {
+            size_t m_FirstIndex;
+            size_t m_IndexCount;
+            float m_Error; // object-space geometric error against LOD 0
+        };
+
+        // A glTF primitive. Every submesh has its own index ranges, base vertex and material inside the mesh's shared
+        // vertex and index buffers. Its indices are relative to m_BaseVertex, so 16-bit indices reach 65536 vertices per submesh.
+        struct Submesh
+        {
+            size_t m_BaseVertex = 0;
+            size_t m_VertexCount = 0;
+            int m_Material = -1;       // glTF material index, -1 if none
+            int m_Texture = -1;        // base colour texture: index into m_TextureImages / m_TexturesLoaded, -1 if none
+            vector<Lod> m_Lods;        // finest first; LOD 0 is the whole primitive
+            Bounds m_Bounds;           // object-space bounds of the primitive's vertices
+            size_t m_FirstMeshlet = 0; // meshlets of LOD 0 in m_Meshlets
+            size_t m_MeshletCount = 0;
+        };
+
+        // The clusters LOD 0 of every submesh is split into for culling at a finer grain than the whole mesh (see MeshletBuilder).
+        // Meshlet i covers m_TriangleCount[i] triangles of m_Indices from m_FirstTriangle[i] on. The culling data is a
+        // structure of arrays in one buffer: m_Bounds holds StreamCount arrays of m_Count floats back to back.
+        struct Meshlets
+        {
+            enum Stream { CenterX, CenterY, CenterZ, Radius, ConeAxisX, ConeAxisY, ConeAxisZ, ConeCutoff, StreamCount };
+
+            size_t m_Count = 0;
+            vector<float> m_Bounds; // object-space bounding spheres and normal cones
+            vector<uint32_t> m_FirstTriangle;
+            vector<uint32_t> m_TriangleCount;
+
+            const float* GetStream(Stream stream) const { return m_Bounds.data() + stream * m_Count; }
+            float* GetStream(Stream stream) { return m_Bounds.data() + stream * m_Count; }
+        };
+
+        // A coarse copy of the mesh's triangles rasterized by the CPU occlusion culler (see OcclusionCuller::BuildOccluder).
+        // Positions are object-space and indices refer to m_Positions, with every submesh merged.
+        struct Occluder
+        {
+            vector<glm::vec3> m_Positions;
+            vector<uint32_t> m_Indices;
+        };
+
+        // A 4-wide bounding volume hierarchy over the triangles of LOD 0 for ray queries (see MeshBvh). Each node holds
+        // the boxes of its up to four children as a structure of arrays, so a ray is tested against all of them at once.
+        // Leaves reference up to four consecutive triangles of m_Triangles, which lists three indices into m_Positions per triangle.
+        struct Bvh
+        {
+            static const uint32_t EMPTY_CHILD = ~0u;
+
+            struct Node
+            {
+                float m_MinX[4], m_MinY[4], m_MinZ[4];
+                float m_MaxX[4], m_MaxY[4], m_MaxZ[4];
+                uint32_t m_Child[4];         // interior: node index; leaf: first triangle; EMPTY_CHILD for unused slots
+                uint32_t m_TriangleCount[4]; // 0 for interior children
+            };
+
+            vector<Node> m_Nodes; // m_Nodes[0] is the root, empty for a mesh without triangles
+            vector<glm::vec3> m_Positions;
+            vector<uint32_t> m_Triangles;
+            vector<uint32_t> m_TriangleIds; // triangle of m_Indices (first index / 3) of each triangle
+        };
+
+        // GPU-ready data mapped from a cooked mesh cache (.a3dmesh). Empty for meshes imported from the source file.
+        struct CookedData
+        {
+            struct CookedTexture
+            {
+                const unsigned char* m_Pixels;
+                int m_Width;
+                int m_Height;
+                int m_Components;
+                uint64_t m_ContentHash;
+            };
+
+            const void* m_Vertices = nullptr; // records of m_VertexLayout, positions quantized to m_Bounds when packed
+            size_t m_VertexCount = 0;
+            const void* m_Indices = nullptr;  // indices of type m_IndexType
+            size_t m_IndexCount = 0;
+            vector<CookedTexture> m_Textures;
+        };
+
+        // Where the mesh lives in the renderer's GeometryArena; m_VAO is shared by every mesh of the same arena page
+        struct GpuGeometry
+        {
+            unsigned int m_VAO = 0; // 0 until the mesh is uploaded
+            uint32_t m_Page = 0;
+            uint64_t m_VertexOffset = 0; // bytes into the page's vertex buffer
+            uint64_t m_VertexSize = 0;
+            uint64_t m_IndexOffset = 0;  // bytes into the page's index buffer
+            uint64_t m_IndexSize = 0;
+            size_t m_BaseVertex = 0;     // m_VertexOffset in vertices, added to every submesh's base vertex
+        };
+
         // Mesh data
         vector<Vertex> m_Vertices;
         vector<unsigned int> m_Indices;
-        vector<tinygltf::Image> m_TextureImages;
+        vector<std::shared_ptr<TextureImage>> m_TextureImages; // base colour images of the submeshes, each once
         vector<std::shared_ptr<Texture>> m_TexturesLoaded; // stores all the textures loaded so far
-        unsigned int m_VAO, m_VBO, m_EBO;
+        vector<Submesh> m_Submeshes; // ordered by texture, so submeshes sharing one draw with a single call
+        Meshlets m_Meshlets; // kept when the CPU copy is released, culling needs it every frame
+        Occluder m_Occluder; // kept when the CPU copy is released, empty if the mesh is no occluder
+        Bvh m_Bvh; // empty unless ModelImportSettings::m_BuildBvh; kept when the CPU copy is released, picking needs it at any time
+        CookedData m_Cooked;
+        VertexLayout m_VertexLayout; // layout the vertices are packed into on upload; cooked vertices are stored in it
+        unsigned int m_IndexType; // GPU index type, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT or _INT (same values as GL_UNSIGNED_SHORT / GL_UNSIGNED_INT)
+        GpuGeometry m_GpuGeometry; // ranges in the renderer's GeometryArena
+        Bounds m_Bounds; // object-space bounds of all submeshes, kept when the CPU copy is released
 
-        Mesh(const vector<Vertex>& vertices, const vector<unsigned int>& indices, const vector<tinygltf::Image>& textureImages);
+        Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<std::shared_ptr<TextureImage>> textureImages);
         virtual ~Mesh() {}
+
+        // True if the mesh data is mapped from a cooked mesh cache instead of held in m_Vertices/m_Indices
+        bool IsCooked() const { return m_Cooked.m_Vertices != nullptr; }
+
+        // False once ReleaseCpuData() has freed the vertices, indices and pixels
+        bool HasCpuData() const { return !m_Released; }
+
+        size_t GetVertexCount() const { return IsCooked() ? m_Cooked.m_VertexCount : m_Released ? m_ReleasedVertexCount : m_Vertices.size(); }
+        size_t GetIndexCount() const { return IsCooked() ? m_Cooked.m_IndexCount : m_Released ? m_ReleasedIndexCount : m_Indices.size(); }
+
+        // Object-space position of a vertex; the mesh must have CPU data. Cooked packed vertices are dequantized.
+        glm::vec3 GetPosition(size_t vertex) const;
+
+        // Scans the vertex positions of submeshes that have no bounds yet and merges all submesh bounds into m_Bounds
+        void ComputeBounds();
+
+        // Frees the CPU copy of the geometry and pixels. Counts, bounds and GPU handles stay valid.
+        void ReleaseCpuData();
+
+        // Takes over the CPU data of a freshly imported copy of this mesh
+        void RestoreCpuData(Mesh&& source);
+
+    private:
+        bool m_Released;
+        size_t m_ReleasedVertexCount;
+        size_t m_ReleasedIndexCount;
     };
 
+    // A placement of a mesh in the node hierarchy. A mesh used by several glTF nodes is imported once and instanced.
+    struct MeshInstance
+    {
+        uint32_t m_Node; // node in m_Transforms
+        uint32_t m_Mesh; // index into m_Meshes
+    };
+
+    // Called for every mesh as soon as it is imported, in m_Meshes order on a serial import and in completion order on a parallel one.
+    // It runs on the importing thread, so it must be thread-safe.
+    using MeshLoadedCallback = std::function<void(size_t meshIndex, const std::shared_ptr<Mesh>& mesh)>;
+
+    // Called once the node hierarchy and the mesh instances are known, before the first mesh is handed out. Runs on the
+    // importing thread.
+    using NodesLoadedCallback = std::function<void(const TransformHierarchy& transforms, const std::vector<MeshInstance>& instances)>;
+
     // Model data
-    vector<std::shared_ptr<Mesh>> m_Meshes;
+    vector<std::shared_ptr<Mesh>> m_Meshes; // one per glTF mesh, in the order the node hierarchy first uses them
+    TransformHierarchy m_Transforms; // node 0 places the whole model, the glTF nodes of the scene follow depth first
+    vector<MeshInstance> m_Instances;
+    vector<std::shared_ptr<Mesh::TextureImage>> m_Images; // decoded glTF images by image index, shared by the meshes that use them
+    string m_Path;
     string m_Directory;
     bool m_GammaCorrection;
+    ModelImportSettings m_ImportSettings;
+    std::shared_ptr<MappedFile> m_CookedFile; // keeps the cooked mesh cache mapped while meshes point into it
 
-    Model(string const& modelPath, bool gamma = false);
+    Model(string const& modelPath, bool gamma = false, const ModelImportSettings& settings = ModelImportSettings(), MeshLoadedCallback onMeshLoaded = nullptr,
+        NodesLoadedCallback onNodesLoaded = nullptr);
     virtual ~Model() {}
 
+    // Frees the CPU copy of every mesh, the decoded images and the cache mapping. Call once every mesh is uploaded.
+    void ReleaseCpuData();
+
+    // Re-fetches the CPU data of released meshes, from the mesh cache when it is valid and from the source file otherwise
+    void RestoreCpuData();
+
+    // Places the whole model in the world. Takes effect on the next m_Transforms.Update().
+    void SetRootTransform(const glm::mat4& transform) { m_Transforms.SetLocal(0, transform); }
+
+    // World-space bounds of every mesh instance as of the last m_Transforms.Update()
+    const Bounds& GetBounds() { return m_Transforms.GetBounds(); }
+
 private:
+    MeshLoadedCallback m_OnMeshLoaded;
+    NodesLoadedCallback m_OnNodesLoaded;
+
     // Loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void LoadModel(string const& modelPath);
 
-    // Processes a node in a recursive fashion. Processes each mesh located at the node and repeats this process on its children nodes.
-    void ProcessNode(const tinygltf::Model& gltfModel);
+    // Parses a memory-mapped .glb in place. The BIN chunk is bound to buffers without being copied and embedded images are decoded straight from the mapping.
+    // Returns false if the file needs the regular loader (e.g. images stored outside the BIN chunk).
+    bool LoadMappedBinary(const MappedFile& file, tinygltf::Model& gltfModel, GltfBuffers& buffers);
+
+    // Identifies the settings that change imported mesh data, so a mesh cache written with other settings is not reused
+    uint64_t GetCacheOptions() const;
+
+    // Moves the decoded images out of the glTF model into m_Images and hashes their pixels
+    void LoadImages(tinygltf::Model& gltfModel);
+
+    // Processes a node in a recursive fashion. Adds the node to m_Transforms, instances its mesh and repeats this process on its children nodes.
+    // meshSlots maps glTF mesh indices to m_Meshes slots; meshes seen for the first time are appended to meshIndices.
+    void ProcessNode(const tinygltf::Model& gltfModel, int nodeIndex, uint32_t parent, vector<int>& meshSlots, vector<int>& meshIndices, vector<bool>& visited);
+
+    // Gives every node the bounds of the mesh it instances, so world bounds follow the node transforms
+    void AssignNodeBounds();
+
+    // Imports the given glTF meshes into m_Meshes. Meshes are processed on a worker pool when more than one import thread
+    // is configured; m_Meshes keeps the order of meshIndices either way.
+    void ProcessMeshes(const tinygltf::Model& gltfModel, const GltfBuffers& buffers, const vector<int>& meshIndices);
 
     // Processes a mesh and returns a Mesh object.
-    std::shared_ptr<Mesh> ProcessMesh(const tinygltf::Mesh& gltfMesh, const tinygltf::Model& gltfModel);    
+    std::shared_ptr<Mesh> ProcessMesh(const tinygltf::Mesh& gltfMesh, const tinygltf::Model& gltfModel, const GltfBuffers& buffers);    
 };
 
 #endif
@@ -0,0 +1,94 @@
+#ifndef MODELSTREAM_H
+#define MODELSTREAM_H
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "Model.h"
+#include "TransformHierarchy.h"
+
+// A model that is imported on a background thread and handed to the renderer mesh by mesh.
+// The node hierarchy is published before the first mesh, so uploaded meshes are drawn at their nodes and instanced
+// right away. Meshes are queued as soon as they are decoded; the GL thread pops them and uploads a few per frame.
+class ModelStream
+{
+public:
+    // Starts importing the model in the background, placed in the world by rootTransform. Returns immediately.
+    ModelStream(const std::string& modelPath, const ModelImportSettings& settings = ModelImportSettings(), const glm::mat4& rootTransform = glm::mat4(1.0f));
+
+    // Waits for the background import to finish
+    virtual ~ModelStream();
+
+    ModelStream(const ModelStream&) = delete;
+    ModelStream& operator=(const ModelStream&) = delete;
+
+    const std::string& GetPath() const { return m_Path; }
+    const ModelImportSettings& GetSettings() const { return m_Settings; }
+    const glm::mat4& GetRootTransform() const { return m_RootTransform; }
+
+    // True once every mesh has been imported and uploaded. GetModel() then returns the finished model.
+    bool IsReady() const { return m_Imported && !m_Failed && m_UploadedCount == m_DecodedCount; }
+
+    // True if the import threw. GetError() returns the reason.
+    bool HasFailed() const { return m_Failed; }
+    std::string GetError() const;
+
+    // Meshes imported so far and meshes uploaded so far
+    size_t GetDecodedMeshCount() const { return m_DecodedCount; }
+    size_t GetUploadedMeshCount() const { return m_UploadedCount; }
+
+    // The imported model, or null while the import is still running or if it failed
+    std::shared_ptr<Model> GetModel() const;
+
+    // True once the background import has finished, successfully or not
+    bool IsImported() const { return m_Imported; }
+
+    // Pops the next decoded mesh that still needs to be uploaded, with its index into Model::m_Meshes. Returns false if none is waiting.
+    bool PopDecodedMesh(size_t& meshIndex, std::shared_ptr<Model::Mesh>& mesh);
+
+    // Records a mesh the GL thread has uploaded so it can be drawn before the whole model is ready
+    void AddUploadedMesh(size_t meshIndex, const std::shared_ptr<Model::Mesh>& mesh);
+
+    // Counts a mesh that failed to upload so the stream can still finish
+    void SkipMesh() { ++m_UploadedCount; }
+
+    // Uploaded meshes by Model::m_Meshes index, null where a mesh is not uploaded yet. Only touched by the GL thread.
+    const std::vector<std::shared_ptr<Model::Mesh>>& GetUploadedMeshes() const { return m_UploadedMeshes; }
+
+    // True once the node hierarchy is known. The import thread no longer touches GetTransforms() and GetInstances()
+    // then; they belong to the GL thread, which updates the transforms.
+    bool HasNodes() const { return m_NodesLoaded; }
+    TransformHierarchy& GetTransforms() { return m_Transforms; }
+    const std::vector<Model::MeshInstance>& GetInstances() const { return m_Instances; }
+
+private:
+    std::string m_Path;
+    ModelImportSettings m_Settings;
+    mutable std::mutex m_Mutex;
+    glm::mat4 m_RootTransform;
+    std::deque<std::pair<size_t, std::shared_ptr<Model::Mesh>>> m_DecodedMeshes; // decoded, waiting for upload
+    std::vector<std::shared_ptr<Model::Mesh>> m_UploadedMeshes;
+    TransformHierarchy m_Transforms; // a copy of the model's, with the root transform applied
+    std::vector<Model::MeshInstance> m_Instances;
+    std::shared_ptr<Model> m_Model;
+    std::string m_Error;
+    std::atomic<size_t> m_DecodedCount;
+    std::atomic<size_t> m_UploadedCount;
+    std::atomic<bool> m_Imported;
+    std::atomic<bool> m_Failed;
+    std::atomic<bool> m_NodesLoaded;
+    std::future<void> m_Import;
+
+    // Runs on the background thread
+    void Import();
+};
+
+#endif
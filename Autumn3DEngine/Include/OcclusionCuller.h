@@ -0,0 +1,101 @@
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "Bounds.h"
+#include "Model.h"
+
+class ThreadPool;
+
+// Software occlusion culling. Occluder triangles are rasterized on the CPU into a small depth buffer, which is reduced to a
+// hierarchical-Z pyramid of farthest depths. A box is hidden when its nearest depth lies behind the farthest depth of every
+// pyramid texel its screen rectangle touches. Triangles are binned into TILE_WIDTH x TILE_HEIGHT tiles that worker threads
+// fill independently, four pixels at a time with SSE2 or NEON. Nothing here needs a GL context.
+class OcclusionCuller
+{
+public:
+    static const int TILE_WIDTH = 64;
+    static const int TILE_HEIGHT = 16;
+
+    // Occluders use the coarsest LOD whose error stays under this fraction of the submesh's bounding radius
+    static constexpr float OCCLUDER_LOD_ERROR = 0.01f;
+
+    // A thread count of 0 uses every hardware thread, 1 rasterizes on the calling thread
+    explicit OcclusionCuller(unsigned int threadCount = 0);
+    virtual ~OcclusionCuller();
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    // Fills mesh.m_Occluder from a coarse LOD of the mesh's CPU or cooked data
+    static void BuildOccluder(Model::Mesh& mesh);
+
+    // Sets the size of the depth buffer in pixels
+    void SetResolution(int width, int height);
+    int GetWidth() const { return m_Width; }
+    int GetHeight() const { return m_Height; }
+
+    // Clears the depth buffer and the binned triangles for a new view
+    void BeginFrame(const glm::mat4& viewProjection);
+
+    // Projects the triangles of an occluder and bins them into tiles. Triangles crossing the near plane are dropped,
+    // which only makes the occluder smaller.
+    void AddOccluder(const glm::vec3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount, const glm::mat4& worldMatrix);
+
+    // Rasterizes the binned triangles on the worker threads and builds the depth pyramid
+    void Rasterize();
+
+    // False if the world-space box is certainly hidden behind the rasterized occluders
+    bool IsVisible(const Bounds& worldBounds) const;
+
+    size_t GetTriangleCount() const { return m_Triangles.size(); }
+
+    // Depths of a pyramid level in [0, 1], 1 where no occluder was drawn. Rows are GetLevelStride(level) floats apart.
+    size_t GetLevelCount() const { return m_Levels.size(); }
+    int GetLevelWidth(size_t level) const { return m_Levels[level].m_Width; }
+    int GetLevelHeight(size_t level) const { return m_Levels[level].m_Height; }
+    int GetLevelStride(size_t level) const { return m_Levels[level].m_Stride; }
+    const float* GetDepth(size_t level) const { return m_Levels[level].m_Depth.data(); }
+
+private:
+    // A triangle in pixel coordinates with its depth plane z = m_Z + m_DzDx * x + m_DzDy * y.
+    // The edge functions are oriented so covered pixel centres have all three non-negative.
+    struct Triangle
+    {
+        float m_EdgeA[3], m_EdgeB[3], m_EdgeC[3]; // edge i: m_EdgeA[i] * x + m_EdgeB[i] * y + m_EdgeC[i]
+        float m_Z, m_DzDx, m_DzDy;
+        int m_MinX, m_MinY, m_MaxX, m_MaxY;       // pixel bounds, inclusive
+    };
+
+    struct Level
+    {
+        int m_Width = 0;
+        int m_Height = 0;
+        int m_Stride = 0;
+        std::vector<float> m_Depth;
+    };
+
+    int m_Width, m_Height;
+    int m_TilesX, m_TilesY;
+    glm::mat4 m_ViewProjection;
+    std::vector<Level> m_Levels;                // level 0 is the rasterized depth buffer, padded to whole tiles
+    std::vector<Triangle> m_Triangles;
+    std::vector<std::vector<uint32_t>> m_Bins;  // triangles overlapping each tile
+    std::vector<glm::vec4> m_Projected;         // scratch for the vertices of the occluder being added
+    std::unique_ptr<ThreadPool> m_Pool;
+
+    // Rasterizes the triangles binned to one tile
+    void RasterizeTile(size_t tile);
+
+    // Rebuilds levels 1 and up from level 0
+    void BuildPyramid();
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef RANGEALLOCATOR_H
+#define RANGEALLOCATOR_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+
+// Hands out ranges of a linear address space, such as a GPU buffer, without touching the memory itself.
+// Free ranges are indexed by offset, to merge a freed range with its neighbours, and by size, so an allocation takes
+// the smallest free range it fits in (best fit) in logarithmic time.
+class RangeAllocator
+{
+public:
+    static const uint64_t INVALID_OFFSET = ~0ull;
+
+    explicit RangeAllocator(uint64_t capacity = 0);
+    virtual ~RangeAllocator() {}
+
+    // Returns the offset of size free units aligned to a multiple of alignment (any positive value), or INVALID_OFFSET
+    uint64_t Allocate(uint64_t size, uint64_t alignment = 1);
+
+    // Returns a range from Allocate() with the same size
+    void Free(uint64_t offset, uint64_t size);
+
+    // Extends the address space to capacity; the new tail is free
+    void Grow(uint64_t capacity);
+
+    uint64_t GetCapacity() const { return m_Capacity; }
+    uint64_t GetUsed() const { return m_Used; }
+
+    // Number of separate free ranges, a measure of fragmentation
+    size_t GetFreeRangeCount() const { return m_FreeByOffset.size(); }
+
+    // Size of the largest free range
+    uint64_t GetLargestFreeRange() const { return m_FreeBySize.empty() ? 0 : m_FreeBySize.rbegin()->first; }
+
+private:
+    uint64_t m_Capacity;
+    uint64_t m_Used;
+    std::map<uint64_t, uint64_t> m_FreeByOffset;           // offset -> size
+    std::set<std::pair<uint64_t, uint64_t>> m_FreeBySize;  // (size, offset)
+
+    void AddFreeRange(uint64_t offset, uint64_t size);
+    void RemoveFreeRange(std::map<uint64_t, uint64_t>::iterator range);
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+
+// Orders a frame's draw items by 64-bit keys so draws sharing GL state are submitted together. From the most significant
+// bits down a key holds the pass, the shader, the material, the geometry buffer and the quantized view depth, so items
+// within one state bucket still draw front to back. Keys are sorted with an LSD radix sort, one byte per pass, whose
+// histogram and scatter steps are split across worker threads for large queues.
+class RenderQueue
+{
+public:
+    static const int PASS_BITS = 4;
+    static const int SHADER_BITS = 4;
+    static const int MATERIAL_BITS = 20;
+    static const int GEOMETRY_BITS = 12;
+    static const int DEPTH_BITS = 24;
+
+    // Queues smaller than this are sorted on the calling thread
+    static const size_t PARALLEL_THRESHOLD = 8192;
+
+    // Consecutive items whose key fields differ, counting the first item as a change of every field
+    struct StateChanges
+    {
+        size_t m_Pass = 0;
+        size_t m_Shader = 0;
+        size_t m_Material = 0;
+        size_t m_Geometry = 0;
+    };
+
+    // A thread count of 0 uses every hardware thread, 1 sorts on the calling thread
+    explicit RenderQueue(unsigned int threadCount = 0);
+    virtual ~RenderQueue();
+
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    // Packs a sort key. Ids wider than their field are truncated, which only merges buckets. Depth is a view-space
+    // distance; negative distances sort first.
+    static uint64_t MakeKey(uint32_t pass, uint32_t shader, uint32_t material, uint32_t geometry, float depth);
+
+    // Starts a new frame
+    void Clear() { m_Entries.clear(); }
+
+    // Queues an item with its key
+    void Add(uint64_t key, uint32_t item) { m_Entries.push_back({ key, item }); }
+
+    // Sorts the queued items by key. Items with equal keys keep their queued order.
+    void Sort();
+
+    size_t GetSize() const { return m_Entries.size(); }
+    uint32_t GetItem(size_t index) const { return m_Entries[index].m_Item; }
+    uint64_t GetKey(size_t index) const { return m_Entries[index].m_Key; }
+
+    // State changes of submitting the items in their current order
+    StateChanges CountStateChanges() const;
+
+private:
+    struct Entry
+    {
+        uint64_t m_Key;
+        uint32_t m_Item;
+    };
+
+    std::vector<Entry> m_Entries;
+    std::vector<Entry> m_Scratch;                // the other buffer of every radix pass
+    std::vector<std::vector<size_t>> m_Offsets;  // per chunk: 256 digit counts, then scatter positions
+    std::unique_ptr<ThreadPool> m_Pool;
+};
+
+#endif
@@ -11,31 +11,215 @@
 
 #include "Shader.h"
 #include "Camera.h"
+#include "FrustumCuller.h"
+#include "GeometryArena.h"
+#include "GLStateCache.h"
+#include "GpuCuller.h"
+#include "IndirectDrawList.h"
 #include "Model.h"
+#include "ModelStream.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+#include "SceneBvh.h"
+#include "TextureCache.h"
 
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <unordered_map>
 
 class Renderer
 {
 public:
+    // Meshlets rejected by cluster culling during one frame
+    struct ClusterCullStats
+    {
+        size_t m_ClustersTested = 0;
+        size_t m_ClustersFrustumCulled = 0;  // bounding sphere outside the view frustum
+        size_t m_ClustersBackfaceCulled = 0; // every triangle faces away from the camera
+        size_t m_TrianglesTested = 0;
+        size_t m_TrianglesCulled = 0;
+    };
+
+    // Mesh instances rejected before submission during one frame
+    struct InstanceCullStats
+    {
+        size_t m_InstancesTested = 0;
+        size_t m_InstancesFrustumCulled = 0; // world-space bounding box outside the view frustum
+        size_t m_InstancesOcclusionCulled = 0; // bounding box behind the CPU-rasterized occluders
+        size_t m_Occluders = 0;
+        size_t m_OccluderTriangles = 0;
+    };
+
+    // GL state changes between consecutive draw items of one frame
+    struct DrawOrderStats
+    {
+        size_t m_Items = 0;
+        RenderQueue::StateChanges m_Unsorted; // in the order the items were gathered and culled
+        RenderQueue::StateChanges m_Sorted;   // in submission order
+    };
+
+    // The nearest triangle under a picking ray
+    struct PickResult
+    {
+        std::shared_ptr<Model> m_Model;
+        size_t m_Mesh = 0;       // index into m_Model->m_Meshes
+        size_t m_Instance = 0;   // index into m_Model->m_Instances
+        uint32_t m_Triangle = 0; // triangle of the mesh's index buffer (first index / 3)
+        glm::vec3 m_Position = glm::vec3(0.0f); // world space
+        float m_Distance = 0.0f; // world units from the ray origin
+    };
+
     AUTUMN3D_API Renderer();
     AUTUMN3D_API virtual ~Renderer() {}
 
-    AUTUMN3D_API void CreateGLFWWindow(int width, int height);
+    // Creates the window and its GL context. A hidden window still provides the context, e.g. for offscreen tests.
+    AUTUMN3D_API void CreateGLFWWindow(int width, int height, bool visible = true);
     AUTUMN3D_API void InitializeOpenGL();
-    AUTUMN3D_API void Load3DModel(const std::string& modelPath);
+
+    // Sets the directory InitializeOpenGL() loads the GLSL sources from, with a trailing separator. Defaults to the
+    // Shaders folder as seen from the WPF host's output directory.
+    AUTUMN3D_API void SetShaderDirectory(const std::string& directory) { m_ShaderDirectory = directory; }
+    AUTUMN3D_API void Load3DModel(const std::string& modelPath, const ModelImportSettings& settings = ModelImportSettings());
+
+    // Starts loading a model in the background and returns right away. Its meshes are uploaded and drawn progressively by Render().
+    AUTUMN3D_API std::shared_ptr<ModelStream> Load3DModelAsync(const std::string& modelPath, const ModelImportSettings& settings = ModelImportSettings());
+
+    // Drops every loaded and streaming model and returns their geometry to the arena. Waits for imports still running.
+    AUTUMN3D_API void UnloadModels();
+
+    // Sets how long Render() may spend uploading streamed meshes per frame
+    AUTUMN3D_API void SetUploadBudget(double milliseconds) { m_UploadBudgetMs = milliseconds; }
+
+    // Sets how many pixels of geometric error a mesh LOD may show on screen before a finer level is drawn
+    AUTUMN3D_API void SetLodErrorThreshold(float pixels) { m_LodErrorThreshold = pixels; }
+
+    // Enables culling of individual meshlets when a submesh is drawn at full detail
+    AUTUMN3D_API void SetClusterCulling(bool enabled) { m_ClusterCulling = enabled; }
+
+    // Enables culling of whole mesh instances against the view frustum before they are submitted
+    AUTUMN3D_API void SetFrustumCulling(bool enabled) { m_FrustumCulling = enabled; }
+
+    // Enables culling of mesh instances hidden behind the largest visible meshes, which are rasterized on the CPU
+    AUTUMN3D_API void SetOcclusionCulling(bool enabled) { m_OcclusionCulling = enabled; }
+
+    // Limits how many occluder triangles are rasterized per frame
+    AUTUMN3D_API void SetOccluderTriangleBudget(size_t triangles) { m_OccluderTriangleBudget = triangles; }
+
+    // Issues the visible scene as a few glMultiDrawElementsIndirect calls when the context supports it (GL 4.3 and
+    // ARB_shader_draw_parameters); otherwise, or when disabled, every mesh is drawn with its own multi-draw
+    AUTUMN3D_API void SetIndirectDrawing(bool enabled) { m_IndirectDrawing = enabled; }
+    AUTUMN3D_API bool IsIndirectDrawingActive() const { return m_IndirectDrawing && m_IndirectSupported; }
+
+    // Moves instance frustum and occlusion culling to compute shaders that test against a Hi-Z pyramid and write the
+    // indirect commands themselves (GL 4.3). Replaces the CPU instance culling while indirect drawing is active.
+    AUTUMN3D_API void SetGpuCulling(bool enabled) { m_GpuCulling = enabled; }
+    AUTUMN3D_API bool IsGpuCullingActive() const { return m_GpuCulling && m_GpuCuller.IsInitialized() && IsIndirectDrawingActive(); }
+
+    // Sorts the visible items by shader, texture, arena page and depth before they are drawn
+    AUTUMN3D_API void SetDrawSorting(bool enabled) { m_DrawSorting = enabled; }
+
+    // Finds the nearest loaded triangle along a world-space ray. Returns false if the ray hits nothing. Only models imported
+    // with ModelImportSettings::m_BuildBvh can be hit.
+    AUTUMN3D_API bool Pick(const glm::vec3& origin, const glm::vec3& direction, PickResult& result);
+
+    // Picks along the ray through a window position in pixels, from the top left, as seen by the last rendered frame
+    AUTUMN3D_API bool PickScreen(double x, double y, PickResult& result);
+
+    // Instance culling results of the last completed frame
+    AUTUMN3D_API const InstanceCullStats& GetInstanceCullStats() const { return m_LastInstanceStats; }
+
+    // Cluster culling results of the last completed frame
+    AUTUMN3D_API const ClusterCullStats& GetClusterCullStats() const { return m_LastClusterStats; }
+
+    // Draw order results of the last completed frame
+    AUTUMN3D_API const DrawOrderStats& GetDrawOrderStats() const { return m_LastDrawOrderStats; }
+
+    // GL binding calls issued and dropped as redundant during the last completed frame
+    AUTUMN3D_API const GLStateCache::Stats& GetGLStateStats() const { return m_LastStateStats; }
+
+    // Runs the window's render loop until it is closed
     AUTUMN3D_API void Render();
 
+    // Uploads models loaded since the last frame and draws one frame with the current camera into the bound draw
+    // framebuffer. Render() calls it every frame; it also drives a context without a render loop, e.g. an offscreen test.
+    AUTUMN3D_API void RenderFrame();
+
 private:
+    // A mesh placed in the world, gathered every frame for culling
+    struct DrawItem
+    {
+        const std::shared_ptr<Model::Mesh>* m_Mesh;
+        const glm::mat4* m_World;
+        Bounds m_Bounds; // world space
+        uint32_t m_Id;   // stable across frames, unlike the item's position in the frame
+    };
+
+    // Stable IDs handed to the instances of one model or stream
+    struct InstanceIdRange
+    {
+        uint32_t m_First = 0;
+        size_t m_Count = 0;
+    };
+
     int m_ScreenWidth, m_ScreenHeight;
     float m_DeltaTime, m_LastFrame;
     float m_LastX, m_LastY;
     bool m_FirstMouse;
     GLFWwindow* m_GlfwWindow;
+    std::string m_ShaderDirectory;
     std::shared_ptr<Camera> m_Camera;
     std::shared_ptr<Shader> m_Shader;
+    UniformHandle<glm::mat4> m_ModelMatrixUniform; // m_Shader uniforms set for every mesh
+    UniformHandle<bool> m_PackedVertexUniform;
+    UniformHandle<glm::vec3> m_PositionOffsetUniform;
+    UniformHandle<glm::vec3> m_PositionScaleUniform;
+    UniformHandle<glm::mat4> m_ProjectionMatrixUniform; // set every frame, m_Shader and m_IndirectShader
+    UniformHandle<glm::mat4> m_ViewMatrixUniform;
+    UniformHandle<glm::mat4> m_IndirectProjectionMatrixUniform;
+    UniformHandle<glm::mat4> m_IndirectViewMatrixUniform;
+    UniformHandle<int> m_IndirectDrawOffsetUniform;
     std::vector<std::shared_ptr<Model>> m_Models;
+    size_t m_SetupModelCount;               // leading m_Models whose meshes are uploaded
+    std::vector<std::shared_ptr<ModelStream>> m_Streams; // models still loading in the background
+    double m_UploadBudgetMs;
+    TextureCache m_TextureCache; // one GL texture per unique image, shared by all meshes and models
+    GeometryArena m_GeometryArena; // shared vertex and index buffers that every mesh is sub-allocated from
+    float m_LodErrorThreshold;   // pixels
+    float m_LodScale;            // screen height / (2 tan(fov / 2)), updated every frame
+    glm::mat4 m_ViewProjection;  // updated every frame
+    bool m_FrustumCulling;
+    FrustumCuller m_FrustumCuller;          // world-space boxes of m_DrawItems
+    std::vector<DrawItem> m_DrawItems;      // every uploaded mesh instance of the frame
+    std::vector<uint32_t> m_VisibleItems;   // indices into m_DrawItems that pass culling
+    std::unordered_map<const void*, InstanceIdRange> m_InstanceIds; // keyed by the Model or ModelStream drawing the instances
+    uint32_t m_NextInstanceId;
+    InstanceCullStats m_InstanceStats, m_LastInstanceStats;
+    bool m_OcclusionCulling;
+    OcclusionCuller m_OcclusionCuller;
+    size_t m_OccluderTriangleBudget;
+    float m_OccluderMinRadius;              // pixels on screen a mesh needs to cover to be an occluder
+    std::vector<std::pair<float, uint32_t>> m_OccluderCandidates; // screen radius and m_DrawItems index
+    std::vector<uint8_t> m_IsOccluder;      // per draw item
+    SceneBvh m_SceneBvh;                    // instances of m_Models for picking
+    bool m_SceneBvhDirty;                   // m_Models changed since m_SceneBvh was built
+    bool m_ClusterCulling;
+    ClusterCullStats m_ClusterStats, m_LastClusterStats;
+    glm::vec4 m_CullPlanes[6];              // object-space frustum planes of the mesh being drawn
+    glm::vec3 m_CullCamera;                 // object-space camera position of the mesh being drawn
+    std::vector<GLsizei> m_DrawCounts;      // ranges of the multi-draw being assembled
+    std::vector<const void*> m_DrawOffsets;
+    std::vector<GLint> m_DrawBaseVertices;
+    GLStateCache m_StateCache;              // every binding the frame changes goes through it
+    GLStateCache::Stats m_LastStateStats;
+    bool m_IndirectDrawing;
+    bool m_IndirectSupported;               // detected by InitializeOpenGL()
+    std::shared_ptr<Shader> m_IndirectShader;
+    IndirectDrawList m_IndirectDrawList;    // the frame's draws when indirect drawing is active
+    bool m_GpuCulling;
+    GpuCuller m_GpuCuller;                  // initialized by InitializeOpenGL() when compute shaders are available
+    bool m_DrawSorting;
+    RenderQueue m_RenderQueue;              // m_VisibleItems in submission order
+    DrawOrderStats m_DrawOrderStats, m_LastDrawOrderStats;
 
     // GLFW callback functions
     static void FrameBufferSizeCallback(GLFWwindow* m_GlfwWindow, int width, int height);
@@ -44,10 +228,45 @@ private:
     void ProcessInput();
 
     // Model, Mesh and Texture functions
+    void SetupModels(); // uploads the meshes and textures of the models added since the last frame
     void SetupMesh(const std::shared_ptr<Model::Mesh>& mesh);
-    void DrawMesh(const std::shared_ptr<Model::Mesh>& mesh);
+    void FreeMeshes(const std::vector<std::shared_ptr<Model::Mesh>>& meshes); // returns the arena ranges of the uploaded ones
+    void DrawMesh(const std::shared_ptr<Model::Mesh>& mesh, const glm::mat4& modelMatrix);
     void LoadTextures(const shared_ptr<Model::Mesh>& mesh);
-    void DrawModel(const std::shared_ptr<Model>& model);
+
+    // Adds a mesh drawn at a world transform to m_DrawItems and its bounds to the frustum culler. Meshes not uploaded yet are skipped.
+    void AddDrawItem(const std::shared_ptr<Model::Mesh>& mesh, const glm::mat4& worldMatrix, uint32_t id);
+
+    // First stable ID of the instances of a model or stream. A new range is handed out when the owner is first drawn
+    // or has more instances than its range holds.
+    uint32_t GetInstanceIdBase(const void* owner, size_t count);
+
+    // Culls m_DrawItems against the view frustum and draws the visible ones
+    void DrawVisibleItems();
+
+    // Sort key of a visible item drawn with the given shader program
+    uint64_t MakeSortKey(const DrawItem& item, unsigned int shader) const;
+
+    // Rasterizes the largest items of m_VisibleItems as occluders and removes the items hidden behind them
+    void CullOccluded();
+
+    // Pixels on screen per object-space unit of LOD error for a mesh at its distance from the camera
+    float GetLodPixelsPerUnit(const Model::Mesh& mesh, const glm::mat4& modelMatrix) const;
+
+    // Picks the coarsest LOD of a submesh whose projected error stays under m_LodErrorThreshold
+    size_t SelectLod(const Model::Mesh::Submesh& submesh, float pixelsPerUnit) const;
+
+    // Appends an index range of a mesh to the multi-draw being assembled, extending the previous range when they are contiguous
+    void AddDrawRange(const Model::Mesh& mesh, size_t firstIndex, size_t indexCount, size_t baseVertex);
+
+    // Computes m_CullPlanes and m_CullCamera for a mesh drawn with the given model matrix
+    void PrepareClusterCulling(const glm::mat4& modelMatrix);
+
+    // Culls the meshlets of a submesh against the view frustum and their normal cones and adds the visible ones to the multi-draw
+    void CullMeshlets(const Model::Mesh& mesh, const Model::Mesh::Submesh& submesh);
+
+    // Uploads streamed meshes until the per-frame budget runs out and moves finished streams to m_Models
+    void UploadStreamedMeshes();
 };
 
 #endif
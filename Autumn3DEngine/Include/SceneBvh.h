@@ -0,0 +1,56 @@
+#ifndef SCENEBVH_H
+#define SCENEBVH_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "BvhBuilder.h"
+#include "Model.h"
+
+// The top level of the two-level ray query hierarchy: a binary SAH hierarchy over the world bounds of every mesh instance
+// of a set of models. Its leaves lead into the per-mesh hierarchies (MeshBvh), which the ray enters in object space, so
+// moving an instance only needs Refit() to grow and shrink the boxes instead of a rebuild.
+class SceneBvh
+{
+public:
+    struct Hit
+    {
+        size_t m_Model = 0;      // index into the models passed to Build()
+        size_t m_Instance = 0;   // index into the model's m_Instances
+        size_t m_Mesh = 0;       // index into the model's m_Meshes
+        uint32_t m_Triangle = 0; // triangle of the mesh's m_Indices (first index / 3)
+        float m_Distance = 0.0f; // world units along the ray
+        glm::vec3 m_Position = glm::vec3(0.0f); // world space
+    };
+
+    // Rebuilds the hierarchy over the instances of models whose meshes have a Model::Mesh::Bvh
+    void Build(const std::vector<std::shared_ptr<Model>>& models);
+
+    // Fits the boxes to the world bounds of the instances as of each model's last m_Transforms.Update()
+    void Refit();
+
+    void Clear();
+
+    size_t GetInstanceCount() const { return m_Instances.size(); }
+
+    // Finds the nearest triangle hit by the ray origin + t * direction, t > 0
+    bool Intersect(const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const;
+
+private:
+    struct Instance
+    {
+        uint32_t m_Model;    // index into m_Models
+        uint32_t m_Instance; // index into the model's m_Instances
+    };
+
+    std::vector<std::shared_ptr<Model>> m_Models;
+    std::vector<Instance> m_Instances; // in leaf order
+    std::vector<BvhBuilder::Node> m_Nodes;
+};
+
+#endif
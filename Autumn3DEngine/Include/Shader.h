@@ -4,13 +4,27 @@
 #pragma once
 
 #include <glad.h>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
 
 #include "glm/glm.hpp"
 
+// The location of a uniform whose GLSL type was checked against T when it was resolved with Shader::GetUniform().
+// Handles of uniforms the program does not use have location -1, which glUniform* ignores.
+template <typename T>
+struct UniformHandle
+{
+    GLint m_Location = -1;
+
+    bool IsActive() const { return m_Location != -1; }
+};
+
 class Shader
 {
 public:
@@ -19,29 +33,95 @@ public:
     // Constructor generates the shader on the fly
     Shader(const char* vertexPath, const char* fragmentPath);
 
+    // Builds a compute program (GL 4.3)
+    explicit Shader(const char* computePath);
+
     // Destructor
     virtual ~Shader() {};
 
     // Activate the shader
     void UseProgram() const { glUseProgram(ID); }
 
-    // Utility uniform functions
-    void SetBool(const std::string& name, bool value) const;
-    void SetInt(const std::string& name, int value) const;
-    void SetFloat(const std::string& name, float value) const;
-    void SetVec2(const std::string& name, const glm::vec2& value) const;
-    void SetVec2(const std::string& name, float x, float y) const;
-    void SetVec3(const std::string& name, const glm::vec3& value) const;
-    void SetVec3(const std::string& name, float x, float y, float z) const;
-    void SetVec4(const std::string& name, const glm::vec4& value) const;
-    void SetVec4(const std::string& name, float x, float y, float z, float w) const;
-    void SetMat2(const std::string& name, const glm::mat2& mat) const;
-    void SetMat3(const std::string& name, const glm::mat3& mat) const;
-    void SetMat4(const std::string& name, const glm::mat4& mat) const;
+    // Location of an active uniform from the table built at link time, or -1. Array elements are found as "name[i]",
+    // the first also as "name".
+    GLint GetUniformLocation(std::string_view name) const;
+
+    // Resolves a typed handle once, for uniforms set on hot paths. Throws if the uniform's GLSL type does not take T.
+    template <typename T>
+    UniformHandle<T> GetUniform(std::string_view name) const
+    {
+        UniformHandle<T> handle;
+        const Uniform* uniform = FindUniform(name);
+        if (!uniform)
+            return handle;
+        if (!AcceptsType(uniform->m_Type, GetValueType(static_cast<const T*>(nullptr))))
+            throw std::runtime_error("Shader uniform " + std::string(name) + " does not match the requested type.");
+        handle.m_Location = uniform->m_Location;
+        return handle;
+    }
+
+    // Uniform updates through handles; the shader must be in use
+    void Set(UniformHandle<bool> uniform, bool value) const { glUniform1i(uniform.m_Location, static_cast<int>(value)); }
+    void Set(UniformHandle<int> uniform, int value) const { glUniform1i(uniform.m_Location, value); }
+    void Set(UniformHandle<float> uniform, float value) const { glUniform1f(uniform.m_Location, value); }
+    void Set(UniformHandle<glm::vec2> uniform, const glm::vec2& value) const { glUniform2fv(uniform.m_Location, 1, &value[0]); }
+    void Set(UniformHandle<glm::vec3> uniform, const glm::vec3& value) const { glUniform3fv(uniform.m_Location, 1, &value[0]); }
+    void Set(UniformHandle<glm::vec4> uniform, const glm::vec4& value) const { glUniform4fv(uniform.m_Location, 1, &value[0]); }
+    void Set(UniformHandle<glm::vec4> uniform, const glm::vec4* values, GLsizei count) const { glUniform4fv(uniform.m_Location, count, &values[0][0]); }
+    void Set(UniformHandle<glm::mat2> uniform, const glm::mat2& mat) const { glUniformMatrix2fv(uniform.m_Location, 1, GL_FALSE, &mat[0][0]); }
+    void Set(UniformHandle<glm::mat3> uniform, const glm::mat3& mat) const { glUniformMatrix3fv(uniform.m_Location, 1, GL_FALSE, &mat[0][0]); }
+    void Set(UniformHandle<glm::mat4> uniform, const glm::mat4& mat) const { glUniformMatrix4fv(uniform.m_Location, 1, GL_FALSE, &mat[0][0]); }
+
+    // Utility uniform functions, looked up by name in the uniform table
+    void SetBool(std::string_view name, bool value) const;
+    void SetInt(std::string_view name, int value) const;
+    void SetFloat(std::string_view name, float value) const;
+    void SetVec2(std::string_view name, const glm::vec2& value) const;
+    void SetVec2(std::string_view name, float x, float y) const;
+    void SetVec3(std::string_view name, const glm::vec3& value) const;
+    void SetVec3(std::string_view name, float x, float y, float z) const;
+    void SetVec4(std::string_view name, const glm::vec4& value) const;
+    void SetVec4(std::string_view name, float x, float y, float z, float w) const;
+    void SetMat2(std::string_view name, const glm::mat2& mat) const;
+    void SetMat3(std::string_view name, const glm::mat3& mat) const;
+    void SetMat4(std::string_view name, const glm::mat4& mat) const;
 
 private:
+    // An active uniform, or one element of an active uniform array
+    struct Uniform
+    {
+        std::string m_Name;
+        uint32_t m_Hash;
+        GLint m_Location;
+        GLenum m_Type;
+    };
+
+    std::vector<Uniform> m_Uniforms;
+    std::vector<int32_t> m_UniformTable; // open addressing into m_Uniforms by name hash, -1 where empty
+
     // Utility function for checking shader compilation/linking errors
     void CheckCompileErrors(GLuint shader, std::string shaderType);
+
+    // Fills the uniform table from the linked program
+    void ReflectUniforms();
+    void AddActiveUniform(const std::string& name, GLenum type, GLint arraySize, GLint location);
+    void AddUniform(std::string name, GLint location, GLenum type);
+
+    const Uniform* FindUniform(std::string_view name) const;
+
+    static uint32_t HashName(std::string_view name);
+
+    // GLSL types a value type can be set on; ints also set sampler and image units
+    static bool AcceptsType(GLenum uniformType, GLenum valueType);
+    static GLenum GetValueType(const bool*) { return GL_BOOL; }
+    static GLenum GetValueType(const int*) { return GL_INT; }
+    static GLenum GetValueType(const float*) { return GL_FLOAT; }
+    static GLenum GetValueType(const glm::vec2*) { return GL_FLOAT_VEC2; }
+    static GLenum GetValueType(const glm::vec3*) { return GL_FLOAT_VEC3; }
+    static GLenum GetValueType(const glm::vec4*) { return GL_FLOAT_VEC4; }
+    static GLenum GetValueType(const glm::mat2*) { return GL_FLOAT_MAT2; }
+    static GLenum GetValueType(const glm::mat3*) { return GL_FLOAT_MAT3; }
+    static GLenum GetValueType(const glm::mat4*) { return GL_FLOAT_MAT4; }
 };
 
 #endif
@@ -0,0 +1,23 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#pragma once
+
+// Compile-time selection of the SIMD instruction set used by the engine's hot loops.
+// glm's own intrinsics path (GLM_FORCE_INTRINSICS) stays disabled because it changes the alignment of the glm types
+// stored in Model::Mesh::Vertex, so the engine uses the platform intrinsics directly behind these macros.
+
+#if defined(__AVX__)
+#define AUTUMN3D_SIMD_AVX 1
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUTUMN3D_SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define AUTUMN3D_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "Model.h"
+
+// GL textures shared across meshes and models.
+// Images are keyed by their content hash and size, so an atlas used by many meshes - or by several models - is uploaded once.
+// Meshes hold the returned handles; the GL texture is deleted when the last handle is released.
+class TextureCache
+{
+public:
+    using TextureSource = Model::Mesh::CookedData::CookedTexture;
+
+    TextureCache() : m_UploadCount(0), m_HitCount(0) {}
+    virtual ~TextureCache() {}
+
+    // Returns the texture for an image, uploading it on first use. Must be called on the GL thread.
+    std::shared_ptr<Model::Mesh::Texture> Acquire(const TextureSource& source, const std::string& textureType);
+
+    // Textures still referenced by at least one mesh
+    size_t GetTextureCount() const;
+
+    size_t GetUploadCount() const { return m_UploadCount; }
+    size_t GetHitCount() const { return m_HitCount; }
+
+private:
+    struct Key
+    {
+        uint64_t m_ContentHash;
+        int m_Width;
+        int m_Height;
+        int m_Components;
+
+        bool operator==(const Key& other) const
+        {
+            return m_ContentHash == other.m_ContentHash && m_Width == other.m_Width && m_Height == other.m_Height && m_Components == other.m_Components;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const { return static_cast<size_t>(key.m_ContentHash ^ (uint64_t(key.m_Width) << 32 | uint32_t(key.m_Height))); }
+    };
+
+    std::unordered_map<Key, std::weak_ptr<Model::Mesh::Texture>, KeyHash> m_Textures;
+    size_t m_UploadCount;
+    size_t m_HitCount;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// A fixed set of worker threads that execute queued tasks in submission order.
+class ThreadPool
+{
+public:
+    // Starts the workers. A thread count of 0 uses every hardware thread.
+    explicit ThreadPool(unsigned int threadCount = 0);
+
+    // Finishes the queued tasks and joins the workers.
+    virtual ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queues a task and returns a future for its result. Exceptions thrown by the task are rethrown by future::get().
+    template <typename Task>
+    std::future<std::invoke_result_t<Task>> Submit(Task&& task)
+    {
+        using Result = std::invoke_result_t<Task>;
+
+        auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+        std::future<Result> result = packagedTask->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_Stopping)
+                throw std::runtime_error("Cannot submit a task to a stopped thread pool.");
+
+            m_Tasks.emplace([packagedTask]() { (*packagedTask)(); });
+        }
+        m_Condition.notify_one();
+        return result;
+    }
+
+    unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_Workers.size()); }
+
+    // Resolves a requested thread count, where 0 means every hardware thread.
+    static unsigned int ResolveThreadCount(unsigned int threadCount);
+
+private:
+    std::vector<std::thread> m_Workers;
+    std::queue<std::function<void()>> m_Tasks;
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_Stopping;
+
+    // Runs queued tasks until the pool is stopped and drained.
+    void WorkerLoop();
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef TRANSFORMHIERARCHY_H
+#define TRANSFORMHIERARCHY_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "Bounds.h"
+
+// Local and world transforms of a node tree, stored as structure of arrays in depth-first order.
+// Every node comes after its parent and the subtree of node i is the contiguous range [i, subtree end), so Update()
+// recomputes each dirty subtree in one forward pass in which every parent is already up to date, and never visits clean nodes.
+// Nodes can carry object-space bounds; their world-space bounds are recomputed along with their world transforms.
+class TransformHierarchy
+{
+public:
+    static const uint32_t NO_PARENT = ~0u;
+
+    void Clear();
+    void Reserve(size_t nodeCount);
+
+    // Appends a node and returns its index. Nodes are added depth first: the parent must be the last added node or one of
+    // its ancestors, which keeps every subtree contiguous. Throws otherwise.
+    size_t AddNode(uint32_t parent, const glm::mat4& local);
+
+    // Replaces the local transform of a node and marks its subtree for the next Update()
+    void SetLocal(size_t node, const glm::mat4& local);
+
+    // Sets the object-space bounds of the content placed at a node and marks the node for the next Update()
+    void SetBounds(size_t node, const Bounds& bounds);
+
+    // Recomputes the world transforms of every dirty subtree with SIMD 4x4 multiplies. Returns the number of nodes updated.
+    size_t Update();
+
+    size_t Size() const { return m_Parents.size(); }
+    uint32_t GetParent(size_t node) const { return m_Parents[node]; }
+    const glm::mat4& GetLocal(size_t node) const { return m_Local[node]; }
+    const glm::mat4& GetWorld(size_t node) const { return m_World[node]; } // as of the last Update()
+    const Bounds& GetWorldBounds(size_t node) const { return m_WorldBounds[node]; } // as of the last Update(), empty without bounds
+
+    // Union of the world bounds of all nodes as of the last Update(). Merged again only after nodes changed.
+    const Bounds& GetBounds();
+
+private:
+    // Queues a node for the next Update()
+    void MarkDirty(size_t node);
+
+    std::vector<uint32_t> m_Parents;
+    std::vector<uint32_t> m_SubtreeEnds; // one past the last node of each node's subtree
+    std::vector<glm::mat4> m_Local;
+    std::vector<glm::mat4> m_World;
+    std::vector<Bounds> m_LocalBounds;
+    std::vector<Bounds> m_WorldBounds;
+    std::vector<uint8_t> m_Dirty;
+    std::vector<uint32_t> m_DirtyNodes;  // nodes whose local transform or bounds changed since the last Update()
+    Bounds m_Bounds;
+    bool m_BoundsStale = true;
+};
+
+#endif
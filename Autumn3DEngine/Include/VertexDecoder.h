@@ -0,0 +1,65 @@
+#ifndef VERTEXDECODER_H
+#define VERTEXDECODER_H
+
+#pragma once
+
+#include <cstddef>
+
+#include "GltfBuffers.h"
+#include "Model.h"
+
+// Decodes the vertex attribute streams of a glTF primitive into Model::Mesh::Vertex records.
+// Every accessor is resolved once per primitive; the per-vertex loop then only walks raw pointers.
+// Attributes already stored as the engine's component types take the SIMD path, any other layout
+// (normalized integers, byte joints, quantized positions) is converted afterwards through AccessorView.
+class VertexDecoder
+{
+public:
+    // A source attribute stream. Missing attributes read a zeroed element with a stride of 0.
+    struct Stream
+    {
+        const unsigned char* m_Data;
+        size_t m_Stride; // bytes between consecutive elements
+    };
+
+    // The attribute streams of one primitive, in Model::Mesh::Vertex order
+    struct Streams
+    {
+        Stream m_Positions;  // float3
+        Stream m_Normals;    // float3
+        Stream m_TexCoords;  // float2
+        Stream m_Tangents;   // float3 (the xyz of the glTF float4 tangent)
+        Stream m_Bitangents; // float3
+        Stream m_Joints;     // ushort4
+        Stream m_Weights;    // float4
+        size_t m_Count;      // number of vertices
+
+        Streams();
+    };
+
+    // Decodes every vertex of a primitive into out, which must have room for them. Returns the vertex count.
+    static size_t DecodePrimitive(const tinygltf::Primitive& primitive, const tinygltf::Model& gltfModel, const GltfBuffers& buffers, Model::Mesh::Vertex* out);
+
+    // Resolves the attribute accessors of a primitive that can be decoded without conversion. Throws if the primitive has no
+    // positions or an attribute whose element count differs from the vertex count.
+    static Streams ResolveStreams(const tinygltf::Primitive& primitive, const tinygltf::Model& gltfModel, const GltfBuffers& buffers);
+
+    // Decodes streams.m_Count vertices into out, which must have room for them. Uses the SSE2 or NEON path when the build has one.
+    static void Decode(const Streams& streams, Model::Mesh::Vertex* out);
+
+    // The portable per-field path Decode() falls back to without SIMD. Kept in every build so the benchmark can compare the two.
+    static void DecodeScalar(const Streams& streams, Model::Mesh::Vertex* out);
+
+    // Returns a stream that yields zeros for every vertex.
+    static Stream Absent();
+
+private:
+    // Returns the stream of a named attribute, or Absent() if the primitive does not have it or stores it as another component type.
+    static Stream FindStream(const tinygltf::Primitive& primitive, const tinygltf::Model& gltfModel, const GltfBuffers& buffers, const char* attribute, int componentType);
+
+    // Converts a named attribute the SIMD path skipped into the matching field of every vertex.
+    template <typename T, int Components>
+    static void ConvertAttribute(const tinygltf::Primitive& primitive, const tinygltf::Model& gltfModel, const GltfBuffers& buffers, const char* attribute, int componentType, T* firstField);
+};
+
+#endif
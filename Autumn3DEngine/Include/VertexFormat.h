@@ -0,0 +1,57 @@
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Model.h"
+
+// Compact GPU vertex layouts.
+// Meshes are imported into the 88 byte Model::Mesh::Vertex and packed into one of these layouts on upload, or when the mesh cache is written:
+//  - positions are unorm16 relative to the mesh bounds; w holds the bitangent sign
+//  - normals and tangents are octahedral-encoded snorm16x2, the bitangent is rebuilt in the vertex shader
+//  - texture coordinates are half floats
+//  - joints are u8 and weights unorm8, only for skinned meshes
+class VertexFormat
+{
+public:
+    struct PackedStaticVertex
+    {
+        uint16_t m_Position[4];  // unorm16 xyz in the mesh bounds, w = bitangent sign (0 = -1, 65535 = +1)
+        int16_t m_Normal[2];     // octahedral snorm16
+        int16_t m_Tangent[2];    // octahedral snorm16
+        uint16_t m_TexCoords[2]; // half floats
+    };
+
+    struct PackedSkinnedVertex
+    {
+        PackedStaticVertex m_Static;
+        uint8_t m_BoneIDs[MAX_BONE_INFLUENCE];
+        uint8_t m_Weights[MAX_BONE_INFLUENCE]; // unorm8, summing to 255
+    };
+
+    static_assert(sizeof(PackedStaticVertex) == 20, "PackedStaticVertex must stay tightly packed");
+    static_assert(sizeof(PackedSkinnedVertex) == 28, "PackedSkinnedVertex must stay tightly packed");
+
+    // Picks the most compact layout that can represent the vertices: Static without skinning data, Skinned when every
+    // bone ID fits in a byte, Full otherwise.
+    static VertexLayout SelectLayout(const Model::Mesh::Vertex* vertices, size_t vertexCount);
+
+    // Bytes per vertex of a layout
+    static size_t GetStride(VertexLayout layout);
+
+    // Packs vertices into a compact layout. Positions are quantized to [boundsMin, boundsMax].
+    static void Pack(const Model::Mesh::Vertex* vertices, size_t vertexCount, VertexLayout layout,
+        const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<unsigned char>& packed);
+
+    // Object-space position of a packed Static or Skinned record, the inverse of the quantization Pack() applies
+    static glm::vec3 UnpackPosition(const unsigned char* record, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    // Octahedral encoding of a unit vector into two snorm16 values
+    static void EncodeOctahedral(const glm::vec3& direction, int16_t encoded[2]);
+};
+
+#endif
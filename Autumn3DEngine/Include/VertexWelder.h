@@ -0,0 +1,41 @@
+#ifndef VERTEXWELDER_H
+#define VERTEXWELDER_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Model.h"
+
+class ThreadPool;
+
+// Merges duplicate vertices of a mesh and rewrites its indices.
+// Vertices are inserted into a lock-free open-addressing hash table from several threads; each slot keeps the lowest
+// vertex index of its duplicates, so the result does not depend on thread timing. Surviving vertices keep their order.
+class VertexWelder
+{
+public:
+    // Welds vertices in place. An epsilon of 0 merges bit-identical vertices only; a positive epsilon merges vertices
+    // whose float attributes fall into the same epsilon-sized grid cell (values straddling a cell boundary stay apart).
+    // Large meshes are split across the pool, which may be shared by concurrent calls; without one they are welded on the
+    // calling thread. Returns the new vertex count.
+    static size_t Weld(std::vector<Model::Mesh::Vertex>& vertices, std::vector<unsigned int>& indices, float epsilon, ThreadPool* pool);
+
+private:
+    // Quantized key of a vertex: every float attribute snapped to the epsilon grid, bone IDs as-is
+    static const int KEY_WORDS = sizeof(Model::Mesh::Vertex) / sizeof(float);
+    struct Key
+    {
+        int64_t m_Words[KEY_WORDS];
+    };
+
+    static Key MakeKey(const Model::Mesh::Vertex& vertex, float inverseEpsilon);
+    static uint64_t HashKey(const Key& key);
+
+    // Hash of the raw vertex record, for bit-identical welding
+    static uint64_t HashBytes(const Model::Mesh::Vertex& vertex);
+};
+
+#endif
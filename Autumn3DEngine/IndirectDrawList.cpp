@@ -0,0 +1,114 @@
+#include "IndirectDrawList.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <glad.h>
+#include <GLFW/glfw3.h>
+
+void IndirectDrawList::Clear()
+{
+    m_Instances.clear();
+    m_Draws.clear();
+}
+
+uint32_t IndirectDrawList::AddInstance(const glm::mat4& modelMatrix, const glm::vec3& positionOffset, const glm::vec3& positionScale, bool packedVertex)
+{
+    DrawData data = {};
+    data.m_ModelMatrix = modelMatrix;
+    data.m_PositionOffset = glm::vec4(positionOffset, 0.0f);
+    data.m_PositionScale = glm::vec4(positionScale, 0.0f);
+    data.m_PackedVertex = packedVertex ? 1u : 0u;
+    data.m_Instance = static_cast<uint32_t>(m_Instances.size());
+    m_Instances.push_back(data);
+    return static_cast<uint32_t>(m_Instances.size() - 1);
+}
+
+void IndirectDrawList::AddDraw(unsigned int vertexArray, unsigned int indexType, unsigned int texture, uint32_t instance,
+    uint32_t indexCount, size_t indexOffset, int32_t baseVertex)
+{
+    // Indirect commands address indices by element rather than by byte
+    const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+
+    Draw draw;
+    draw.m_VertexArray = vertexArray;
+    draw.m_IndexType = indexType;
+    draw.m_Texture = texture;
+    draw.m_Instance = instance;
+    draw.m_Command = { indexCount, 1u, static_cast<uint32_t>(indexOffset / indexSize), baseVertex, 0u };
+    m_Draws.push_back(draw);
+}
+
+void IndirectDrawList::Build()
+{
+    // Draws sharing a call become neighbours; the stable sort keeps the submission order within a call
+    std::stable_sort(m_Draws.begin(), m_Draws.end(), [](const Draw& a, const Draw& b)
+    {
+        if (a.m_VertexArray != b.m_VertexArray)
+            return a.m_VertexArray < b.m_VertexArray;
+        if (a.m_IndexType != b.m_IndexType)
+            return a.m_IndexType < b.m_IndexType;
+        return a.m_Texture < b.m_Texture;
+    });
+
+    m_Commands.clear();
+    m_DrawData.clear();
+    m_Calls.clear();
+    for (const Draw& draw : m_Draws)
+    {
+        if (m_Calls.empty() || m_Calls.back().m_VertexArray != draw.m_VertexArray || m_Calls.back().m_IndexType != draw.m_IndexType ||
+            m_Calls.back().m_Texture != draw.m_Texture)
+        {
+            m_Calls.push_back({ draw.m_VertexArray, draw.m_IndexType, draw.m_Texture, static_cast<uint32_t>(m_Commands.size()), 0u });
+        }
+        ++m_Calls.back().m_Count;
+
+        m_Commands.push_back(draw.m_Command);
+        m_DrawData.push_back(m_Instances[draw.m_Instance]);
+        m_DrawData.back().m_Material = draw.m_Texture;
+        m_DrawData.back().m_Call = static_cast<uint32_t>(m_Calls.size() - 1);
+    }
+}
+
+void IndirectDrawList::Submit(const Shader& shader, UniformHandle<int> drawOffset, GLStateCache& state)
+{
+    m_DrawCount = m_Draws.size();
+    m_CallCount = 0;
+    if (m_Draws.empty())
+        return;
+
+    if (!m_CommandBuffer)
+        glGenBuffers(1, &m_CommandBuffer);
+    if (!m_DataBuffer)
+        glGenBuffers(1, &m_DataBuffer);
+    if (!m_CommandBuffer || !m_DataBuffer)
+        throw std::runtime_error("Failed to generate the indirect draw buffers.");
+
+    Build();
+
+    // The whole buffers are respecified every frame, which lets the driver orphan the storage still in use by the GPU
+    state.BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(m_Commands.size() * sizeof(Command)), m_Commands.data(), GL_STREAM_DRAW);
+    state.BindBuffer(GL_SHADER_STORAGE_BUFFER, m_DataBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(m_DrawData.size() * sizeof(DrawData)), m_DrawData.data(), GL_STREAM_DRAW);
+    state.BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_DataBuffer);
+
+    for (const Call& call : m_Calls)
+    {
+        // gl_DrawID restarts at 0 in every call
+        shader.Set(drawOffset, static_cast<int>(call.m_First));
+        state.BindVertexArray(call.m_VertexArray);
+        state.BindTexture(0, GL_TEXTURE_2D, call.m_Texture);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, call.m_IndexType, reinterpret_cast<const void*>(call.m_First * sizeof(Command)),
+            static_cast<GLsizei>(call.m_Count), 0);
+    }
+    m_CallCount = m_Calls.size();
+}
+
+void IndirectDrawList::Release()
+{
+    glDeleteBuffers(1, &m_CommandBuffer);
+    glDeleteBuffers(1, &m_DataBuffer);
+    m_CommandBuffer = 0;
+    m_DataBuffer = 0;
+}
@@ -0,0 +1,101 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) :
+    m_Path(path), m_Data(nullptr), m_Size(0), m_FileHandle(INVALID_HANDLE_VALUE), m_MappingHandle(nullptr)
+{
+    m_FileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_FileHandle == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Failed to open file for mapping: " + path);
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_FileHandle, &fileSize))
+    {
+        CloseHandle(m_FileHandle);
+        throw std::runtime_error("Failed to query the size of: " + path);
+    }
+    m_Size = static_cast<size_t>(fileSize.QuadPart);
+
+    // Empty files cannot be mapped, they are exposed as a null pointer with a size of 0
+    if (m_Size == 0)
+        return;
+
+    m_MappingHandle = CreateFileMappingA(m_FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_MappingHandle)
+    {
+        CloseHandle(m_FileHandle);
+        throw std::runtime_error("Failed to create a file mapping for: " + path);
+    }
+
+    m_Data = static_cast<const unsigned char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!m_Data)
+    {
+        CloseHandle(m_MappingHandle);
+        CloseHandle(m_FileHandle);
+        throw std::runtime_error("Failed to map a view of: " + path);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_Data)
+        UnmapViewOfFile(m_Data);
+    if (m_MappingHandle)
+        CloseHandle(m_MappingHandle);
+    if (m_FileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(m_FileHandle);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) :
+    m_Path(path), m_Data(nullptr), m_Size(0), m_FileDescriptor(-1)
+{
+    m_FileDescriptor = open(path.c_str(), O_RDONLY);
+    if (m_FileDescriptor < 0)
+        throw std::runtime_error("Failed to open file for mapping: " + path);
+
+    struct stat fileStat;
+    if (fstat(m_FileDescriptor, &fileStat) != 0)
+    {
+        close(m_FileDescriptor);
+        throw std::runtime_error("Failed to query the size of: " + path);
+    }
+    m_Size = static_cast<size_t>(fileStat.st_size);
+
+    // Empty files cannot be mapped, they are exposed as a null pointer with a size of 0
+    if (m_Size == 0)
+        return;
+
+    void* mapping = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0);
+    if (mapping == MAP_FAILED)
+    {
+        close(m_FileDescriptor);
+        throw std::runtime_error("Failed to map: " + path);
+    }
+    m_Data = static_cast<const unsigned char*>(mapping);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_Data)
+        munmap(const_cast<unsigned char*>(m_Data), m_Size);
+    if (m_FileDescriptor >= 0)
+        close(m_FileDescriptor);
+}
+
+#endif
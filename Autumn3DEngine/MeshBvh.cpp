@@ -0,0 +1,418 @@
+#include "MeshBvh.h"
+#include "BvhBuilder.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+namespace
+{
+    // Four lanes of floats. Comparisons return lane masks that And4() combines and MoveMask4() turns into one bit per lane.
+#if defined(AUTUMN3D_SIMD_SSE2)
+
+    typedef __m128 Float4;
+    inline Float4 Load4(const float* p) { return _mm_loadu_ps(p); }
+    inline void Store4(float* p, Float4 a) { _mm_storeu_ps(p, a); }
+    inline Float4 Splat4(float f) { return _mm_set1_ps(f); }
+    inline Float4 Add4(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+    inline Float4 Sub4(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+    inline Float4 Mul4(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+    inline Float4 Min4(Float4 a, Float4 b) { return _mm_min_ps(a, b); }
+    inline Float4 Max4(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+    inline Float4 Reciprocal4(Float4 a) { return _mm_div_ps(_mm_set1_ps(1.0f), a); }
+    inline Float4 Less4(Float4 a, Float4 b) { return _mm_cmplt_ps(a, b); }
+    inline Float4 LessEqual4(Float4 a, Float4 b) { return _mm_cmple_ps(a, b); }
+    inline Float4 And4(Float4 a, Float4 b) { return _mm_and_ps(a, b); }
+    inline int MoveMask4(Float4 a) { return _mm_movemask_ps(a); }
+
+#elif defined(AUTUMN3D_SIMD_NEON)
+
+    typedef float32x4_t Float4;
+    inline Float4 Load4(const float* p) { return vld1q_f32(p); }
+    inline void Store4(float* p, Float4 a) { vst1q_f32(p, a); }
+    inline Float4 Splat4(float f) { return vdupq_n_f32(f); }
+    inline Float4 Add4(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+    inline Float4 Sub4(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+    inline Float4 Mul4(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+    inline Float4 Min4(Float4 a, Float4 b) { return vminq_f32(a, b); }
+    inline Float4 Max4(Float4 a, Float4 b) { return vmaxq_f32(a, b); }
+    inline Float4 Less4(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+    inline Float4 LessEqual4(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vcleq_f32(a, b)); }
+    inline Float4 And4(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+
+    // The estimate refined by two Newton-Raphson steps; ARMv7 has no vector divide
+    inline Float4 Reciprocal4(Float4 a)
+    {
+        Float4 estimate = vrecpeq_f32(a);
+        estimate = vmulq_f32(estimate, vrecpsq_f32(a, estimate));
+        return vmulq_f32(estimate, vrecpsq_f32(a, estimate));
+    }
+
+    inline int MoveMask4(Float4 a)
+    {
+        const uint32x4_t mask = vreinterpretq_u32_f32(a);
+        return static_cast<int>((vgetq_lane_u32(mask, 0) & 1u) | (vgetq_lane_u32(mask, 1) & 2u) | (vgetq_lane_u32(mask, 2) & 4u) | (vgetq_lane_u32(mask, 3) & 8u));
+    }
+
+#else
+
+    struct Float4 { float m_Lanes[4]; };
+
+    template <typename Operation>
+    inline Float4 Map4(Float4 a, Float4 b, Operation operation)
+    {
+        Float4 result;
+        for (int lane = 0; lane < 4; ++lane)
+            result.m_Lanes[lane] = operation(a.m_Lanes[lane], b.m_Lanes[lane]);
+        return result;
+    }
+
+    inline Float4 Load4(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+    inline void Store4(float* p, Float4 a) { std::copy(a.m_Lanes, a.m_Lanes + 4, p); }
+    inline Float4 Splat4(float f) { return { { f, f, f, f } }; }
+    inline Float4 Add4(Float4 a, Float4 b) { return Map4(a, b, [](float x, float y) { return x + y; }); }
+    inline Float4 Sub4(Float4 a, Float4 b) { return Map4(a, b, [](float x, float y) { return x - y; }); }
+    inline Float4 Mul4(Float4 a, Float4 b) { return Map4(a, b, [](float x, float y) { return x * y; }); }
+    inline Float4 Min4(Float4 a, Float4 b) { return Map4(a, b, [](float x, float y) { return x < y ? x : y; }); }
+    inline Float4 Max4(Float4 a, Float4 b) { return Map4(a, b, [](float x, float y) { return x > y ? x : y; }); }
+    inline Float4 Reciprocal4(Float4 a) { return Map4(Splat4(1.0f), a, [](float x, float y) { return x / y; }); }
+    inline Float4 Less4(Float4 a, Float4 b) { return Map4(a, b, [](float x, float y) { return x < y ? 1.0f : 0.0f; }); }
+    inline Float4 LessEqual4(Float4 a, Float4 b) { return Map4(a, b, [](float x, float y) { return x <= y ? 1.0f : 0.0f; }); }
+    inline Float4 And4(Float4 a, Float4 b) { return Map4(a, b, [](float x, float y) { return x != 0.0f && y != 0.0f ? 1.0f : 0.0f; }); }
+
+    inline int MoveMask4(Float4 a)
+    {
+        int mask = 0;
+        for (int lane = 0; lane < 4; ++lane)
+            mask |= a.m_Lanes[lane] != 0.0f ? 1 << lane : 0;
+        return mask;
+    }
+
+#endif
+
+    // A child still to visit: a node, or a leaf when m_TriangleCount is not 0
+    struct StackEntry
+    {
+        uint32_t m_Child;
+        uint32_t m_TriangleCount;
+        float m_Distance; // where the ray enters the child's box
+    };
+}
+
+// Collapses the binary hierarchy into 4-wide nodes. A wide node starts with the two children of its binary node and
+// opens the interior child with the largest surface area until it has four.
+static void CollapseNodes(const std::vector<BvhBuilder::Node>& binary, std::vector<Model::Mesh::Bvh::Node>& wide)
+{
+    typedef Model::Mesh::Bvh Bvh;
+    struct Pending
+    {
+        uint32_t m_Binary;
+        uint32_t m_Parent; // wide node whose m_Child[m_Slot] gets the new node
+        uint32_t m_Slot;
+    };
+
+    wide.clear();
+    wide.reserve(binary.size() / 3 + 1);
+    std::vector<Pending> stack(1, { 0, Bvh::EMPTY_CHILD, 0 });
+    while (!stack.empty())
+    {
+        const Pending pending = stack.back();
+        stack.pop_back();
+
+        const uint32_t wideIndex = static_cast<uint32_t>(wide.size());
+        wide.emplace_back();
+        if (pending.m_Parent != Bvh::EMPTY_CHILD)
+            wide[pending.m_Parent].m_Child[pending.m_Slot] = wideIndex;
+
+        // Only a root that is a leaf gets a single child
+        uint32_t children[4];
+        size_t childCount = 0;
+        const BvhBuilder::Node& node = binary[pending.m_Binary];
+        if (node.IsLeaf())
+        {
+            children[childCount++] = pending.m_Binary;
+        }
+        else
+        {
+            children[childCount++] = node.m_First;
+            children[childCount++] = node.m_First + 1;
+        }
+
+        while (childCount < 4)
+        {
+            size_t largest = childCount;
+            float largestArea = -1.0f;
+            for (size_t c = 0; c < childCount; ++c)
+            {
+                const BvhBuilder::Node& child = binary[children[c]];
+                const float area = BvhBuilder::GetHalfArea(child.m_Min, child.m_Max);
+                if (!child.IsLeaf() && area > largestArea)
+                {
+                    largest = c;
+                    largestArea = area;
+                }
+            }
+            if (largest == childCount)
+                break;
+
+            const uint32_t opened = binary[children[largest]].m_First;
+            children[largest] = opened;
+            children[childCount++] = opened + 1;
+        }
+
+        // Unused slots get a box at infinity, which no ray reaches
+        Bvh::Node& wideNode = wide[wideIndex];
+        for (size_t slot = 0; slot < 4; ++slot)
+        {
+            if (slot >= childCount)
+            {
+                const float infinity = std::numeric_limits<float>::infinity();
+                wideNode.m_MinX[slot] = wideNode.m_MinY[slot] = wideNode.m_MinZ[slot] = infinity;
+                wideNode.m_MaxX[slot] = wideNode.m_MaxY[slot] = wideNode.m_MaxZ[slot] = infinity;
+                wideNode.m_Child[slot] = Bvh::EMPTY_CHILD;
+                wideNode.m_TriangleCount[slot] = 0;
+                continue;
+            }
+
+            const BvhBuilder::Node& child = binary[children[slot]];
+            wideNode.m_MinX[slot] = child.m_Min.x;
+            wideNode.m_MinY[slot] = child.m_Min.y;
+            wideNode.m_MinZ[slot] = child.m_Min.z;
+            wideNode.m_MaxX[slot] = child.m_Max.x;
+            wideNode.m_MaxY[slot] = child.m_Max.y;
+            wideNode.m_MaxZ[slot] = child.m_Max.z;
+            if (child.IsLeaf())
+            {
+                wideNode.m_Child[slot] = child.m_First;
+                wideNode.m_TriangleCount[slot] = child.m_Count;
+            }
+            else
+            {
+                wideNode.m_Child[slot] = Bvh::EMPTY_CHILD;
+                wideNode.m_TriangleCount[slot] = 0;
+                stack.push_back({ children[slot], wideIndex, static_cast<uint32_t>(slot) });
+            }
+        }
+    }
+}
+
+void MeshBvh::Build(Model::Mesh& mesh, unsigned int threadCount)
+{
+    mesh.m_Bvh = Model::Mesh::Bvh();
+    if (!mesh.HasCpuData())
+        return;
+
+    const size_t vertexCount = mesh.GetVertexCount();
+    auto getIndex = [&mesh](size_t i) -> size_t
+    {
+        if (!mesh.IsCooked())
+            return mesh.m_Indices[i];
+        if (mesh.m_IndexType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+            return static_cast<const uint16_t*>(mesh.m_Cooked.m_Indices)[i];
+        return static_cast<const uint32_t*>(mesh.m_Cooked.m_Indices)[i];
+    };
+
+    Model::Mesh::Bvh& bvh = mesh.m_Bvh;
+    bvh.m_Positions.resize(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        bvh.m_Positions[v] = mesh.GetPosition(v);
+
+    // The triangles of every submesh's LOD 0 with absolute vertex indices, and their boxes for the build
+    std::vector<uint32_t> triangles, triangleIds;
+    std::vector<glm::vec3> boxMin, boxMax;
+    for (const auto& submesh : mesh.m_Submeshes)
+    {
+        if (submesh.m_Lods.empty())
+            continue;
+
+        const Model::Mesh::Lod& lod = submesh.m_Lods[0];
+        for (size_t i = lod.m_FirstIndex; i + 2 < lod.m_FirstIndex + lod.m_IndexCount; i += 3)
+        {
+            size_t corners[3];
+            bool valid = true;
+            for (int c = 0; c < 3; ++c)
+            {
+                corners[c] = submesh.m_BaseVertex + getIndex(i + c);
+                valid = valid && corners[c] < vertexCount;
+            }
+            if (!valid)
+                continue;
+
+            const glm::vec3& a = bvh.m_Positions[corners[0]], & b = bvh.m_Positions[corners[1]], & c = bvh.m_Positions[corners[2]];
+            for (const size_t corner : corners)
+                triangles.push_back(static_cast<uint32_t>(corner));
+            triangleIds.push_back(static_cast<uint32_t>(i / 3));
+            boxMin.push_back(glm::min(a, glm::min(b, c)));
+            boxMax.push_back(glm::max(a, glm::max(b, c)));
+        }
+    }
+
+    // Small meshes are not worth the thread hand-off
+    std::unique_ptr<ThreadPool> pool;
+    if (threadCount > 1 && triangleIds.size() >= 65536)
+        pool = std::make_unique<ThreadPool>(threadCount);
+
+    std::vector<BvhBuilder::Node> nodes;
+    std::vector<uint32_t> order;
+    BvhBuilder::Build(boxMin, boxMax, LEAF_SIZE, pool.get(), nodes, order);
+    if (nodes.empty())
+        return;
+
+    // Store the triangles in leaf order so every leaf is a contiguous range
+    bvh.m_Triangles.resize(triangles.size());
+    bvh.m_TriangleIds.resize(triangleIds.size());
+    for (size_t t = 0; t < order.size(); ++t)
+    {
+        std::copy(&triangles[size_t(order[t]) * 3], &triangles[size_t(order[t]) * 3] + 3, &bvh.m_Triangles[t * 3]);
+        bvh.m_TriangleIds[t] = triangleIds[order[t]];
+    }
+
+    CollapseNodes(nodes, bvh.m_Nodes);
+}
+
+// Tests a ray against the triangles of a leaf at once (Moller-Trumbore), keeping the nearest hit closer than best.
+// A zero determinant divides to infinity, which fails the barycentric tests, so degenerate triangles never hit.
+static bool IntersectLeaf(const Model::Mesh::Bvh& bvh, uint32_t first, uint32_t count, const Float4 origin[3], const Float4 direction[3],
+    float& best, uint32_t& triangle)
+{
+    // Gather the corners into lanes; lanes past the leaf repeat its first triangle
+    float corners[3][3][4];
+    for (uint32_t lane = 0; lane < 4; ++lane)
+    {
+        const uint32_t* indices = &bvh.m_Triangles[size_t(first + (lane < count ? lane : 0)) * 3];
+        for (int c = 0; c < 3; ++c)
+        {
+            const glm::vec3& position = bvh.m_Positions[indices[c]];
+            corners[c][0][lane] = position.x;
+            corners[c][1][lane] = position.y;
+            corners[c][2][lane] = position.z;
+        }
+    }
+
+    Float4 v0[3], edge1[3], edge2[3], offset[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        v0[axis] = Load4(corners[0][axis]);
+        edge1[axis] = Sub4(Load4(corners[1][axis]), v0[axis]);
+        edge2[axis] = Sub4(Load4(corners[2][axis]), v0[axis]);
+        offset[axis] = Sub4(origin[axis], v0[axis]);
+    }
+
+    auto cross = [](const Float4 a[3], const Float4 b[3], Float4 result[3])
+    {
+        result[0] = Sub4(Mul4(a[1], b[2]), Mul4(a[2], b[1]));
+        result[1] = Sub4(Mul4(a[2], b[0]), Mul4(a[0], b[2]));
+        result[2] = Sub4(Mul4(a[0], b[1]), Mul4(a[1], b[0]));
+    };
+    auto dot = [](const Float4 a[3], const Float4 b[3])
+    {
+        return Add4(Add4(Mul4(a[0], b[0]), Mul4(a[1], b[1])), Mul4(a[2], b[2]));
+    };
+
+    Float4 p[3], q[3];
+    cross(direction, edge2, p);
+    cross(offset, edge1, q);
+    const Float4 inverseDeterminant = Reciprocal4(dot(edge1, p));
+    const Float4 u = Mul4(dot(offset, p), inverseDeterminant);
+    const Float4 v = Mul4(dot(direction, q), inverseDeterminant);
+    const Float4 t = Mul4(dot(edge2, q), inverseDeterminant);
+
+    const Float4 zero = Splat4(0.0f);
+    Float4 valid = And4(LessEqual4(zero, u), LessEqual4(zero, v));
+    valid = And4(valid, LessEqual4(Add4(u, v), Splat4(1.0f)));
+    valid = And4(valid, And4(Less4(zero, t), Less4(t, Splat4(best))));
+    const int mask = MoveMask4(valid) & ((1 << count) - 1);
+    if (mask == 0)
+        return false;
+
+    float distances[4];
+    Store4(distances, t);
+    for (uint32_t lane = 0; lane < count; ++lane)
+    {
+        if ((mask & (1 << lane)) && distances[lane] < best)
+        {
+            best = distances[lane];
+            triangle = bvh.m_TriangleIds[first + lane];
+        }
+    }
+    return true;
+}
+
+bool MeshBvh::Intersect(const Model::Mesh::Bvh& bvh, const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+    float& distance, uint32_t& triangle)
+{
+    if (bvh.m_Nodes.empty())
+        return false;
+
+    // A zero direction component would give 0 * infinity in the slab test, so it is nudged off zero
+    glm::vec3 inverseDirection;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float component = std::abs(direction[axis]) < 1e-20f ? std::copysign(1e-20f, direction[axis]) : direction[axis];
+        inverseDirection[axis] = 1.0f / component;
+    }
+
+    const Float4 origin4[3] = { Splat4(origin.x), Splat4(origin.y), Splat4(origin.z) };
+    const Float4 direction4[3] = { Splat4(direction.x), Splat4(direction.y), Splat4(direction.z) };
+    const Float4 inverseX = Splat4(inverseDirection.x), inverseY = Splat4(inverseDirection.y), inverseZ = Splat4(inverseDirection.z);
+    const Float4 zero = Splat4(0.0f);
+
+    float best = maxDistance;
+    bool hit = false;
+    std::vector<StackEntry> stack;
+    stack.reserve(64);
+    stack.push_back({ 0, 0, 0.0f });
+    while (!stack.empty())
+    {
+        const StackEntry entry = stack.back();
+        stack.pop_back();
+        if (entry.m_Distance >= best)
+            continue;
+
+        if (entry.m_TriangleCount > 0)
+        {
+            hit |= IntersectLeaf(bvh, entry.m_Child, entry.m_TriangleCount, origin4, direction4, best, triangle);
+            continue;
+        }
+
+        // Slab test against the four child boxes
+        const Model::Mesh::Bvh::Node& node = bvh.m_Nodes[entry.m_Child];
+        const Float4 x0 = Mul4(Sub4(Load4(node.m_MinX), origin4[0]), inverseX), x1 = Mul4(Sub4(Load4(node.m_MaxX), origin4[0]), inverseX);
+        const Float4 y0 = Mul4(Sub4(Load4(node.m_MinY), origin4[1]), inverseY), y1 = Mul4(Sub4(Load4(node.m_MaxY), origin4[1]), inverseY);
+        const Float4 z0 = Mul4(Sub4(Load4(node.m_MinZ), origin4[2]), inverseZ), z1 = Mul4(Sub4(Load4(node.m_MaxZ), origin4[2]), inverseZ);
+        const Float4 enter = Max4(Max4(Min4(x0, x1), Min4(y0, y1)), Max4(Min4(z0, z1), zero));
+        const Float4 exit = Min4(Min4(Max4(x0, x1), Max4(y0, y1)), Min4(Max4(z0, z1), Splat4(best)));
+        const int mask = MoveMask4(LessEqual4(enter, exit));
+        if (mask == 0)
+            continue;
+
+        float enterDistances[4];
+        Store4(enterDistances, enter);
+
+        // Push the children hit farthest first, so the nearest is visited next
+        StackEntry children[4];
+        int childCount = 0;
+        for (int slot = 0; slot < 4; ++slot)
+        {
+            if (!(mask & (1 << slot)) || node.m_Child[slot] == Model::Mesh::Bvh::EMPTY_CHILD)
+                continue;
+
+            const StackEntry child = { node.m_Child[slot], node.m_TriangleCount[slot], enterDistances[slot] };
+            int position = childCount++;
+            while (position > 0 && children[position - 1].m_Distance < child.m_Distance)
+            {
+                children[position] = children[position - 1];
+                --position;
+            }
+            children[position] = child;
+        }
+        stack.insert(stack.end(), children, children + childCount);
+    }
+
+    if (hit)
+        distance = best;
+    return hit;
+}
@@ -0,0 +1,498 @@
+#include "MeshCache.h"
+#include "MeshBvh.h"
+#include "VertexFormat.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <iostream>
+
+std::string MeshCache::GetCachePath(const std::string& modelPath)
+{
+    return modelPath + ".a3dmesh";
+}
+
+uint64_t MeshCache::HashFile(const MappedFile& file)
+{
+    return HashBytes(file.Data(), file.Size());
+}
+
+uint64_t MeshCache::HashBytes(const unsigned char* data, size_t size)
+{
+    // FNV-1a style mixing over 64-bit words; this runs at memory bandwidth on large files
+    const uint64_t prime = 1099511628211ull;
+    uint64_t hash = 14695981039346656037ull ^ static_cast<uint64_t>(size);
+
+    const size_t wordCount = size / sizeof(uint64_t);
+    for (size_t i = 0; i < wordCount; ++i)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i * sizeof(uint64_t), sizeof(word));
+        hash = (((hash << 5) | (hash >> 59)) ^ word) * prime;
+    }
+
+    for (size_t i = wordCount * sizeof(uint64_t); i < size; ++i)
+        hash = (hash ^ data[i]) * prime;
+
+    return hash;
+}
+
+// Rounds an offset up to the blob alignment
+static uint64_t AlignBlob(uint64_t offset)
+{
+    return (offset + MeshCache::BLOB_ALIGNMENT - 1) & ~(MeshCache::BLOB_ALIGNMENT - 1);
+}
+
+// Size of the meshlet blob of a mesh with meshletCount meshlets
+static uint64_t GetMeshletBlobSize(uint64_t meshletCount)
+{
+    if (meshletCount == 0)
+        return 0;
+    return meshletCount * (Model::Mesh::Meshlets::StreamCount * sizeof(float) + 2 * sizeof(uint32_t));
+}
+
+// Size of the BVH blob of a mesh
+static uint64_t GetBvhBlobSize(uint64_t nodeCount, uint64_t triangleCount, uint64_t positionCount)
+{
+    return nodeCount * sizeof(Model::Mesh::Bvh::Node) + triangleCount * 4 * sizeof(uint32_t) + positionCount * sizeof(glm::vec3);
+}
+
+// True if every link of a cached BVH stays inside it. Children must come after their parent, which rules out cycles.
+static bool IsValidBvh(const Model::Mesh::Bvh& bvh, uint64_t indexCount)
+{
+    for (size_t n = 0; n < bvh.m_Nodes.size(); ++n)
+    {
+        const Model::Mesh::Bvh::Node& node = bvh.m_Nodes[n];
+        for (int slot = 0; slot < 4; ++slot)
+        {
+            const uint32_t child = node.m_Child[slot], triangleCount = node.m_TriangleCount[slot];
+            if (child == Model::Mesh::Bvh::EMPTY_CHILD)
+                continue;
+            if (triangleCount > MeshBvh::LEAF_SIZE || (triangleCount > 0 && uint64_t(child) + triangleCount > bvh.m_TriangleIds.size()) ||
+                (triangleCount == 0 && (child <= n || child >= bvh.m_Nodes.size())))
+                return false;
+        }
+    }
+
+    for (const uint32_t index : bvh.m_Triangles)
+    {
+        if (index >= bvh.m_Positions.size())
+            return false;
+    }
+    for (const uint32_t triangle : bvh.m_TriangleIds)
+    {
+        if (uint64_t(triangle) * 3 + 3 > indexCount)
+            return false;
+    }
+    return true;
+}
+
+// True if [offset, offset + size) lies inside a file of fileSize bytes
+static bool IsInFile(uint64_t offset, uint64_t size, uint64_t fileSize)
+{
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+std::shared_ptr<MappedFile> MeshCache::Load(const std::string& cachePath, uint64_t sourceHash, uint64_t importOptions, std::vector<std::shared_ptr<Model::Mesh>>& meshes,
+    TransformHierarchy& transforms, std::vector<Model::MeshInstance>& instances)
+{
+    std::error_code error;
+    if (!std::filesystem::exists(cachePath, error))
+        return nullptr;
+
+    auto file = std::make_shared<MappedFile>(cachePath);
+    const unsigned char* data = file->Data();
+    const uint64_t fileSize = file->Size();
+
+    if (fileSize < sizeof(Header))
+        return nullptr;
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.m_Magic != MAGIC || header.m_Version != VERSION || header.m_SourceHash != sourceHash || header.m_ImportOptions != importOptions)
+        return nullptr;
+
+    const uint64_t meshTableOffset = sizeof(Header);
+    const uint64_t submeshTableOffset = meshTableOffset + uint64_t(header.m_MeshCount) * sizeof(MeshEntry);
+    const uint64_t textureTableOffset = submeshTableOffset + uint64_t(header.m_SubmeshCount) * sizeof(SubmeshEntry);
+    const uint64_t lodTableOffset = textureTableOffset + uint64_t(header.m_TextureCount) * sizeof(TextureEntry);
+    const uint64_t nodeTableOffset = lodTableOffset + uint64_t(header.m_LodCount) * sizeof(LodEntry);
+    if (!IsInFile(nodeTableOffset, uint64_t(header.m_NodeCount) * sizeof(NodeEntry), fileSize))
+        return nullptr;
+
+    const MeshEntry* meshEntries = reinterpret_cast<const MeshEntry*>(data + meshTableOffset);
+    const SubmeshEntry* submeshEntries = reinterpret_cast<const SubmeshEntry*>(data + submeshTableOffset);
+    const TextureEntry* textureEntries = reinterpret_cast<const TextureEntry*>(data + textureTableOffset);
+    const LodEntry* lodEntries = reinterpret_cast<const LodEntry*>(data + lodTableOffset);
+    const NodeEntry* nodeEntries = reinterpret_cast<const NodeEntry*>(data + nodeTableOffset);
+
+    std::vector<std::shared_ptr<Model::Mesh>> cookedMeshes;
+    cookedMeshes.reserve(header.m_MeshCount);
+    for (uint32_t i = 0; i < header.m_MeshCount; ++i)
+    {
+        const MeshEntry& entry = meshEntries[i];
+        const uint64_t indexSize = entry.m_IndexType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        const uint64_t vertexStride = VertexFormat::GetStride(static_cast<VertexLayout>(entry.m_VertexLayout));
+
+        if (!IsInFile(entry.m_VertexOffset, entry.m_VertexCount * vertexStride, fileSize) ||
+            !IsInFile(entry.m_IndexOffset, entry.m_IndexCount * indexSize, fileSize) ||
+            !IsInFile(entry.m_MeshletOffset, GetMeshletBlobSize(entry.m_MeshletCount), fileSize) ||
+            !IsInFile(entry.m_BvhOffset, GetBvhBlobSize(entry.m_BvhNodeCount, entry.m_BvhTriangleCount, entry.m_BvhPositionCount), fileSize) ||
+            uint64_t(entry.m_FirstTexture) + entry.m_TextureCount > header.m_TextureCount ||
+            uint64_t(entry.m_FirstSubmesh) + entry.m_SubmeshCount > header.m_SubmeshCount ||
+            entry.m_VertexLayout > static_cast<uint32_t>(VertexLayout::Skinned) ||
+            (entry.m_IndexType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT && entry.m_IndexType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT))
+        {
+            std::cerr << "Ignoring malformed mesh cache: " << cachePath << std::endl;
+            return nullptr;
+        }
+
+        auto mesh = std::make_shared<Model::Mesh>(std::vector<Model::Mesh::Vertex>(), std::vector<unsigned int>(), std::vector<std::shared_ptr<Model::Mesh::TextureImage>>());
+        mesh->m_IndexType = entry.m_IndexType;
+        mesh->m_VertexLayout = static_cast<VertexLayout>(entry.m_VertexLayout);
+        mesh->m_Cooked.m_Vertices = data + entry.m_VertexOffset;
+        mesh->m_Cooked.m_VertexCount = static_cast<size_t>(entry.m_VertexCount);
+        mesh->m_Cooked.m_Indices = data + entry.m_IndexOffset;
+        mesh->m_Cooked.m_IndexCount = static_cast<size_t>(entry.m_IndexCount);
+
+        // Meshlets are small and stay resident after the CPU copy is released, so they are copied out of the mapping
+        Model::Mesh::Meshlets& meshlets = mesh->m_Meshlets;
+        meshlets.m_Count = entry.m_MeshletCount;
+        meshlets.m_Bounds.resize(size_t(entry.m_MeshletCount) * Model::Mesh::Meshlets::StreamCount);
+        meshlets.m_FirstTriangle.resize(entry.m_MeshletCount);
+        meshlets.m_TriangleCount.resize(entry.m_MeshletCount);
+        if (entry.m_MeshletCount > 0)
+        {
+            const unsigned char* blob = data + entry.m_MeshletOffset;
+            std::memcpy(meshlets.m_Bounds.data(), blob, meshlets.m_Bounds.size() * sizeof(float));
+            blob += meshlets.m_Bounds.size() * sizeof(float);
+            std::memcpy(meshlets.m_FirstTriangle.data(), blob, meshlets.m_FirstTriangle.size() * sizeof(uint32_t));
+            blob += meshlets.m_FirstTriangle.size() * sizeof(uint32_t);
+            std::memcpy(meshlets.m_TriangleCount.data(), blob, meshlets.m_TriangleCount.size() * sizeof(uint32_t));
+        }
+
+        for (uint32_t m = 0; m < entry.m_MeshletCount; ++m)
+        {
+            if ((uint64_t(meshlets.m_FirstTriangle[m]) + meshlets.m_TriangleCount[m]) * 3 > entry.m_IndexCount)
+            {
+                std::cerr << "Ignoring malformed mesh cache: " << cachePath << std::endl;
+                return nullptr;
+            }
+        }
+
+        // So is the BVH, which picking needs at any time
+        Model::Mesh::Bvh& bvh = mesh->m_Bvh;
+        bvh.m_Nodes.resize(entry.m_BvhNodeCount);
+        bvh.m_Triangles.resize(size_t(entry.m_BvhTriangleCount) * 3);
+        bvh.m_TriangleIds.resize(entry.m_BvhTriangleCount);
+        bvh.m_Positions.resize(entry.m_BvhPositionCount);
+        if (entry.m_BvhNodeCount > 0)
+        {
+            const unsigned char* blob = data + entry.m_BvhOffset;
+            std::memcpy(bvh.m_Nodes.data(), blob, bvh.m_Nodes.size() * sizeof(Model::Mesh::Bvh::Node));
+            blob += bvh.m_Nodes.size() * sizeof(Model::Mesh::Bvh::Node);
+            std::memcpy(bvh.m_Triangles.data(), blob, bvh.m_Triangles.size() * sizeof(uint32_t));
+            blob += bvh.m_Triangles.size() * sizeof(uint32_t);
+            std::memcpy(bvh.m_TriangleIds.data(), blob, bvh.m_TriangleIds.size() * sizeof(uint32_t));
+            blob += bvh.m_TriangleIds.size() * sizeof(uint32_t);
+            std::memcpy(bvh.m_Positions.data(), blob, bvh.m_Positions.size() * sizeof(glm::vec3));
+        }
+
+        if (!IsValidBvh(bvh, entry.m_IndexCount))
+        {
+            std::cerr << "Ignoring malformed mesh cache: " << cachePath << std::endl;
+            return nullptr;
+        }
+
+        for (uint32_t s = 0; s < entry.m_SubmeshCount; ++s)
+        {
+            const SubmeshEntry& submeshEntry = submeshEntries[entry.m_FirstSubmesh + s];
+            if (submeshEntry.m_BaseVertex > entry.m_VertexCount || submeshEntry.m_VertexCount > entry.m_VertexCount - submeshEntry.m_BaseVertex ||
+                submeshEntry.m_Texture < -1 || submeshEntry.m_Texture >= int64_t(entry.m_TextureCount) ||
+                uint64_t(submeshEntry.m_FirstLod) + submeshEntry.m_LodCount > header.m_LodCount ||
+                uint64_t(submeshEntry.m_FirstMeshlet) + submeshEntry.m_MeshletCount > entry.m_MeshletCount)
+            {
+                std::cerr << "Ignoring malformed mesh cache: " << cachePath << std::endl;
+                return nullptr;
+            }
+
+            Model::Mesh::Submesh submesh;
+            submesh.m_BaseVertex = static_cast<size_t>(submeshEntry.m_BaseVertex);
+            submesh.m_VertexCount = static_cast<size_t>(submeshEntry.m_VertexCount);
+            submesh.m_Material = submeshEntry.m_Material;
+            submesh.m_Texture = submeshEntry.m_Texture;
+            submesh.m_FirstMeshlet = submeshEntry.m_FirstMeshlet;
+            submesh.m_MeshletCount = submeshEntry.m_MeshletCount;
+            submesh.m_Bounds.m_Min = glm::vec3(submeshEntry.m_BoundsMin[0], submeshEntry.m_BoundsMin[1], submeshEntry.m_BoundsMin[2]);
+            submesh.m_Bounds.m_Max = glm::vec3(submeshEntry.m_BoundsMax[0], submeshEntry.m_BoundsMax[1], submeshEntry.m_BoundsMax[2]);
+            submesh.m_Bounds.m_Radius = submeshEntry.m_BoundsRadius;
+            for (uint32_t l = 0; l < submeshEntry.m_LodCount; ++l)
+            {
+                const LodEntry& lod = lodEntries[submeshEntry.m_FirstLod + l];
+                if (lod.m_FirstIndex > entry.m_IndexCount || lod.m_IndexCount > entry.m_IndexCount - lod.m_FirstIndex)
+                {
+                    std::cerr << "Ignoring malformed mesh cache: " << cachePath << std::endl;
+                    return nullptr;
+                }
+                submesh.m_Lods.push_back({ static_cast<size_t>(lod.m_FirstIndex), static_cast<size_t>(lod.m_IndexCount), lod.m_Error });
+            }
+            mesh->m_Submeshes.push_back(std::move(submesh));
+        }
+        mesh->ComputeBounds();
+
+        // Packed positions only decode correctly against the bounds they were quantized to
+        const glm::vec3 quantizeMin(entry.m_QuantizeMin[0], entry.m_QuantizeMin[1], entry.m_QuantizeMin[2]);
+        const glm::vec3 quantizeMax(entry.m_QuantizeMax[0], entry.m_QuantizeMax[1], entry.m_QuantizeMax[2]);
+        if (mesh->m_VertexLayout != VertexLayout::Full && entry.m_VertexCount > 0 && (mesh->m_Bounds.m_Min != quantizeMin || mesh->m_Bounds.m_Max != quantizeMax))
+        {
+            std::cerr << "Ignoring malformed mesh cache: " << cachePath << std::endl;
+            return nullptr;
+        }
+
+        for (uint32_t t = 0; t < entry.m_TextureCount; ++t)
+        {
+            const TextureEntry& texture = textureEntries[entry.m_FirstTexture + t];
+            if (!IsInFile(texture.m_PixelOffset, texture.m_PixelSize, fileSize) ||
+                uint64_t(texture.m_Width) * texture.m_Height * texture.m_Components > texture.m_PixelSize)
+            {
+                std::cerr << "Ignoring malformed mesh cache: " << cachePath << std::endl;
+                return nullptr;
+            }
+
+            mesh->m_Cooked.m_Textures.push_back({ data + texture.m_PixelOffset, texture.m_Width, texture.m_Height, texture.m_Components, texture.m_ContentHash });
+        }
+
+        cookedMeshes.emplace_back(mesh);
+    }
+
+    // Parents precede their children, which AddNode() checks along with the depth-first order
+    TransformHierarchy cookedTransforms;
+    std::vector<Model::MeshInstance> cookedInstances;
+    cookedTransforms.Reserve(header.m_NodeCount);
+    for (uint32_t n = 0; n < header.m_NodeCount; ++n)
+    {
+        const NodeEntry& node = nodeEntries[n];
+        const bool validParent = n == 0 ? node.m_Parent == TransformHierarchy::NO_PARENT : node.m_Parent < n;
+        if (!validParent || node.m_Mesh < -1 || node.m_Mesh >= int64_t(header.m_MeshCount))
+        {
+            std::cerr << "Ignoring malformed mesh cache: " << cachePath << std::endl;
+            return nullptr;
+        }
+
+        glm::mat4 local;
+        std::memcpy(&local[0][0], node.m_Local, sizeof(node.m_Local));
+        cookedTransforms.AddNode(node.m_Parent, local);
+        if (node.m_Mesh >= 0)
+            cookedInstances.push_back({ n, static_cast<uint32_t>(node.m_Mesh) });
+    }
+
+    meshes = std::move(cookedMeshes);
+    transforms = std::move(cookedTransforms);
+    instances = std::move(cookedInstances);
+    return file;
+}
+
+void MeshCache::Write(const std::string& cachePath, uint64_t sourceHash, uint64_t importOptions, const std::vector<std::shared_ptr<Model::Mesh>>& meshes,
+    const TransformHierarchy& transforms, const std::vector<Model::MeshInstance>& instances)
+{
+    Header header = {};
+    header.m_Magic = MAGIC;
+    header.m_Version = VERSION;
+    header.m_SourceHash = sourceHash;
+    header.m_ImportOptions = importOptions;
+    header.m_MeshCount = static_cast<uint32_t>(meshes.size());
+    header.m_NodeCount = static_cast<uint32_t>(transforms.Size());
+
+    for (const auto& mesh : meshes)
+    {
+        header.m_TextureCount += static_cast<uint32_t>(mesh->m_TextureImages.size());
+        header.m_SubmeshCount += static_cast<uint32_t>(mesh->m_Submeshes.size());
+        for (const auto& submesh : mesh->m_Submeshes)
+            header.m_LodCount += static_cast<uint32_t>(submesh.m_Lods.size());
+    }
+
+    // Lay out the table of contents first, then every blob behind it
+    std::vector<MeshEntry> meshEntries(meshes.size());
+    std::vector<SubmeshEntry> submeshEntries;
+    submeshEntries.reserve(header.m_SubmeshCount);
+    std::vector<TextureEntry> textureEntries;
+    textureEntries.reserve(header.m_TextureCount);
+    std::vector<LodEntry> lodEntries;
+    lodEntries.reserve(header.m_LodCount);
+
+    std::vector<NodeEntry> nodeEntries(transforms.Size());
+    for (size_t n = 0; n < nodeEntries.size(); ++n)
+    {
+        nodeEntries[n].m_Parent = transforms.GetParent(n);
+        nodeEntries[n].m_Mesh = -1;
+        std::memcpy(nodeEntries[n].m_Local, &transforms.GetLocal(n)[0][0], sizeof(nodeEntries[n].m_Local));
+    }
+    for (const auto& instance : instances)
+        nodeEntries[instance.m_Node].m_Mesh = static_cast<int32_t>(instance.m_Mesh);
+
+    // Each image is written once, by the first texture entry that uses it
+    std::map<const Model::Mesh::TextureImage*, uint64_t> pixelOffsets;
+    std::vector<bool> ownsPixels;
+    ownsPixels.reserve(header.m_TextureCount);
+
+    uint64_t offset = sizeof(Header) + meshEntries.size() * sizeof(MeshEntry) + uint64_t(header.m_SubmeshCount) * sizeof(SubmeshEntry)
+        + uint64_t(header.m_TextureCount) * sizeof(TextureEntry) + uint64_t(header.m_LodCount) * sizeof(LodEntry) + nodeEntries.size() * sizeof(NodeEntry);
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        const auto& mesh = meshes[i];
+        MeshEntry& entry = meshEntries[i];
+        const uint64_t indexSize = mesh->m_IndexType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+        entry.m_VertexOffset = offset = AlignBlob(offset);
+        entry.m_VertexCount = mesh->m_Vertices.size();
+        entry.m_VertexLayout = static_cast<uint32_t>(mesh->m_VertexLayout);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            entry.m_QuantizeMin[axis] = mesh->m_Bounds.m_Min[axis];
+            entry.m_QuantizeMax[axis] = mesh->m_Bounds.m_Max[axis];
+        }
+        offset += entry.m_VertexCount * VertexFormat::GetStride(mesh->m_VertexLayout);
+
+        entry.m_IndexOffset = offset = AlignBlob(offset);
+        entry.m_IndexCount = mesh->m_Indices.size();
+        entry.m_IndexType = mesh->m_IndexType;
+
+        offset += entry.m_IndexCount * indexSize;
+
+        entry.m_FirstSubmesh = static_cast<uint32_t>(submeshEntries.size());
+        entry.m_SubmeshCount = static_cast<uint32_t>(mesh->m_Submeshes.size());
+        for (const auto& submesh : mesh->m_Submeshes)
+        {
+            SubmeshEntry submeshEntry = {};
+            submeshEntry.m_BaseVertex = submesh.m_BaseVertex;
+            submeshEntry.m_VertexCount = submesh.m_VertexCount;
+            submeshEntry.m_Material = submesh.m_Material;
+            submeshEntry.m_Texture = submesh.m_Texture;
+            submeshEntry.m_FirstLod = static_cast<uint32_t>(lodEntries.size());
+            submeshEntry.m_LodCount = static_cast<uint32_t>(submesh.m_Lods.size());
+            submeshEntry.m_FirstMeshlet = static_cast<uint32_t>(submesh.m_FirstMeshlet);
+            submeshEntry.m_MeshletCount = static_cast<uint32_t>(submesh.m_MeshletCount);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                submeshEntry.m_BoundsMin[axis] = submesh.m_Bounds.m_Min[axis];
+                submeshEntry.m_BoundsMax[axis] = submesh.m_Bounds.m_Max[axis];
+            }
+            submeshEntry.m_BoundsRadius = submesh.m_Bounds.m_Radius;
+            submeshEntries.push_back(submeshEntry);
+
+            for (const auto& lod : submesh.m_Lods)
+                lodEntries.push_back({ lod.m_FirstIndex, lod.m_IndexCount, lod.m_Error, 0 });
+        }
+
+        entry.m_MeshletOffset = offset = AlignBlob(offset);
+        entry.m_MeshletCount = static_cast<uint32_t>(mesh->m_Meshlets.m_Count);
+        offset += GetMeshletBlobSize(entry.m_MeshletCount);
+
+        const Model::Mesh::Bvh& bvh = mesh->m_Bvh;
+        entry.m_BvhOffset = offset = AlignBlob(offset);
+        entry.m_BvhNodeCount = static_cast<uint32_t>(bvh.m_Nodes.size());
+        entry.m_BvhTriangleCount = static_cast<uint32_t>(bvh.m_TriangleIds.size());
+        entry.m_BvhPositionCount = static_cast<uint32_t>(bvh.m_Positions.size());
+        offset += GetBvhBlobSize(entry.m_BvhNodeCount, entry.m_BvhTriangleCount, entry.m_BvhPositionCount);
+
+        entry.m_FirstTexture = static_cast<uint32_t>(textureEntries.size());
+        entry.m_TextureCount = static_cast<uint32_t>(mesh->m_TextureImages.size());
+        for (const auto& image : mesh->m_TextureImages)
+        {
+            TextureEntry texture = {};
+            texture.m_PixelSize = image->m_Pixels.size();
+            texture.m_ContentHash = image->m_ContentHash;
+            texture.m_Width = image->m_Width;
+            texture.m_Height = image->m_Height;
+            texture.m_Components = image->m_Components;
+
+            auto written = pixelOffsets.find(image.get());
+            ownsPixels.push_back(written == pixelOffsets.end());
+            if (ownsPixels.back())
+            {
+                texture.m_PixelOffset = offset = AlignBlob(offset);
+                pixelOffsets.emplace(image.get(), texture.m_PixelOffset);
+                offset += texture.m_PixelSize;
+            }
+            else
+            {
+                texture.m_PixelOffset = written->second;
+            }
+            textureEntries.push_back(texture);
+        }
+    }
+
+    const std::string temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!stream)
+            throw std::runtime_error("Failed to create mesh cache: " + temporaryPath);
+
+        uint64_t position = 0;
+        auto writeBlob = [&stream, &position](uint64_t blobOffset, const void* bytes, uint64_t size)
+        {
+            static const char padding[BLOB_ALIGNMENT] = {};
+            stream.write(padding, static_cast<std::streamsize>(blobOffset - position));
+            if (size > 0)
+                stream.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+            position = blobOffset + size;
+        };
+
+        writeBlob(0, &header, sizeof(header));
+        writeBlob(position, meshEntries.data(), meshEntries.size() * sizeof(MeshEntry));
+        writeBlob(position, submeshEntries.data(), submeshEntries.size() * sizeof(SubmeshEntry));
+        writeBlob(position, textureEntries.data(), textureEntries.size() * sizeof(TextureEntry));
+        writeBlob(position, lodEntries.data(), lodEntries.size() * sizeof(LodEntry));
+        writeBlob(position, nodeEntries.data(), nodeEntries.size() * sizeof(NodeEntry));
+
+        size_t textureIndex = 0;
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            const auto& mesh = meshes[i];
+            const MeshEntry& entry = meshEntries[i];
+
+            // Vertices are stored in the upload layout so a cache hit uploads them without packing
+            std::vector<unsigned char> packed;
+            VertexFormat::Pack(mesh->m_Vertices.data(), mesh->m_Vertices.size(), mesh->m_VertexLayout, mesh->m_Bounds.m_Min, mesh->m_Bounds.m_Max, packed);
+            writeBlob(entry.m_VertexOffset, packed.data(), packed.size());
+
+            // Indices are stored in the GPU index type so a cache hit uploads them as-is
+            if (entry.m_IndexType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+            {
+                const std::vector<uint16_t> indices16(mesh->m_Indices.begin(), mesh->m_Indices.end());
+                writeBlob(entry.m_IndexOffset, indices16.data(), indices16.size() * sizeof(uint16_t));
+            }
+            else
+            {
+                writeBlob(entry.m_IndexOffset, mesh->m_Indices.data(), mesh->m_Indices.size() * sizeof(uint32_t));
+            }
+
+            const Model::Mesh::Meshlets& meshlets = mesh->m_Meshlets;
+            if (meshlets.m_Count > 0)
+            {
+                writeBlob(entry.m_MeshletOffset, meshlets.m_Bounds.data(), meshlets.m_Bounds.size() * sizeof(float));
+                writeBlob(position, meshlets.m_FirstTriangle.data(), meshlets.m_FirstTriangle.size() * sizeof(uint32_t));
+                writeBlob(position, meshlets.m_TriangleCount.data(), meshlets.m_TriangleCount.size() * sizeof(uint32_t));
+            }
+
+            const Model::Mesh::Bvh& bvh = mesh->m_Bvh;
+            writeBlob(entry.m_BvhOffset, bvh.m_Nodes.data(), bvh.m_Nodes.size() * sizeof(Model::Mesh::Bvh::Node));
+            writeBlob(position, bvh.m_Triangles.data(), bvh.m_Triangles.size() * sizeof(uint32_t));
+            writeBlob(position, bvh.m_TriangleIds.data(), bvh.m_TriangleIds.size() * sizeof(uint32_t));
+            writeBlob(position, bvh.m_Positions.data(), bvh.m_Positions.size() * sizeof(glm::vec3));
+
+            for (const auto& image : mesh->m_TextureImages)
+            {
+                const TextureEntry& texture = textureEntries[textureIndex];
+                if (ownsPixels[textureIndex++])
+                    writeBlob(texture.m_PixelOffset, image->m_Pixels.data(), texture.m_PixelSize);
+            }
+        }
+
+        if (!stream)
+            throw std::runtime_error("Failed to write mesh cache: " + temporaryPath);
+    }
+
+    std::filesystem::rename(temporaryPath, cachePath);
+}
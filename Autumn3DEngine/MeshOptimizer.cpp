@@ -0,0 +1,239 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+MeshOptimizer::CacheStatistics MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+    CacheStatistics statistics;
+    if (indexCount < 3 || vertexCount == 0)
+        return statistics;
+
+    // A vertex is in the FIFO while fewer than cacheSize misses happened since it was inserted
+    std::vector<size_t> insertedAt(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0, uniqueVertices = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        const unsigned int index = indices[i];
+        if (!used[index] || misses - insertedAt[index] >= cacheSize)
+        {
+            uniqueVertices += used[index] ? 0 : 1;
+            used[index] = true;
+            insertedAt[index] = ++misses;
+        }
+    }
+
+    statistics.m_ACMR = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+    statistics.m_ATVR = static_cast<float>(misses) / static_cast<float>(std::max<size_t>(uniqueVertices, 1));
+    return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount, std::vector<size_t>& clusters, unsigned int cacheSize)
+{
+    clusters.clear();
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Vertex -> triangle adjacency in compressed rows
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        ++liveTriangles[indices[i]];
+
+    std::vector<size_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+    std::vector<unsigned int> adjacency(adjacencyOffsets[vertexCount]);
+    std::vector<size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        for (int c = 0; c < 3; ++c)
+            adjacency[fill[indices[t * 3 + c]]++] = static_cast<unsigned int>(t);
+    }
+
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    size_t time = cacheSize + 1;
+    size_t cursor = 0;
+
+    // Finds a vertex that still has triangles, first from the dead-end stack, then in input order
+    auto skipDeadEnd = [&]() -> long long
+    {
+        while (!deadEnd.empty())
+        {
+            const unsigned int vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[vertex] > 0)
+                return vertex;
+        }
+        for (; cursor < vertexCount; ++cursor)
+        {
+            if (liveTriangles[cursor] > 0)
+                return static_cast<long long>(cursor);
+        }
+        return -1;
+    };
+
+    long long fanning = skipDeadEnd();
+    clusters.push_back(0);
+    while (fanning >= 0)
+    {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (size_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; ++a)
+        {
+            const unsigned int triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+
+            for (int c = 0; c < 3; ++c)
+            {
+                const unsigned int vertex = indices[triangle * 3 + c];
+                output.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+                if (time - cacheTime[vertex] > cacheSize)
+                    cacheTime[vertex] = time++;
+            }
+            emitted[triangle] = true;
+        }
+
+        // Continue with the candidate that will still be in the cache after its remaining triangles are emitted
+        long long next = -1;
+        long long bestPriority = -1;
+        for (unsigned int vertex : candidates)
+        {
+            if (liveTriangles[vertex] == 0)
+                continue;
+
+            long long priority = 0;
+            if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+                priority = static_cast<long long>(time - cacheTime[vertex]);
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+
+        if (next < 0)
+        {
+            next = skipDeadEnd();
+            if (next >= 0 && output.size() / 3 > clusters.back())
+                clusters.push_back(output.size() / 3);
+        }
+        fanning = next;
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Model::Mesh::Vertex* vertices, size_t vertexCount, const std::vector<size_t>& clusters)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (clusters.size() < 2 || vertexCount == 0)
+        return;
+
+    struct Cluster
+    {
+        size_t m_First, m_End;
+        float m_SortKey;
+    };
+
+    // Area-weighted centroid and normal of every cluster and of the whole mesh
+    std::vector<Cluster> sorted(clusters.size());
+    std::vector<glm::vec3> centroids(clusters.size()), normals(clusters.size());
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        sorted[c].m_First = clusters[c];
+        sorted[c].m_End = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = sorted[c].m_First; t < sorted[c].m_End; ++t)
+        {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].m_Position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].m_Position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].m_Position;
+            const glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+            const float faceArea = glm::length(faceNormal);
+
+            centroid += (p0 + p1 + p2) * (faceArea / 3.0f);
+            normal += faceNormal;
+            area += faceArea;
+        }
+
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids[c] = area > 0.0f ? centroid / area : centroid;
+        normals[c] = normal;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        const float normalLength = glm::length(normals[c]);
+        sorted[c].m_SortKey = normalLength > 0.0f ? glm::dot(centroids[c] - meshCentroid, normals[c] / normalLength) : 0.0f;
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.m_SortKey > b.m_SortKey; });
+
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    for (const Cluster& cluster : sorted)
+        output.insert(output.end(), indices + cluster.m_First * 3, indices + cluster.m_End * 3);
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Model::Mesh::Vertex>& vertices, unsigned int* indices, size_t indexCount)
+{
+    const unsigned int unassigned = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), unassigned);
+    unsigned int nextVertex = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        if (remap[indices[i]] == unassigned)
+            remap[indices[i]] = nextVertex++;
+        indices[i] = remap[indices[i]];
+    }
+
+    for (auto& target : remap)
+    {
+        if (target == unassigned)
+            target = nextVertex++;
+    }
+
+    std::vector<Model::Mesh::Vertex> reordered(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v)
+        reordered[remap[v]] = vertices[v];
+    vertices.swap(reordered);
+}
+
+void MeshOptimizer::Optimize(std::vector<Model::Mesh::Vertex>& vertices, std::vector<unsigned int>& indices, CacheStatistics& before, CacheStatistics& after)
+{
+    before = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+    after = before;
+    if (indices.size() < 3 || indices.size() % 3 != 0)
+        return;
+
+    // Indices that point past the vertex array would make the passes read out of bounds
+    if (*std::max_element(indices.begin(), indices.end()) >= vertices.size())
+        return;
+
+    std::vector<size_t> clusters;
+    OptimizeVertexCache(indices.data(), indices.size(), vertices.size(), clusters);
+    OptimizeOverdraw(indices.data(), indices.size(), vertices.data(), vertices.size(), clusters);
+    OptimizeVertexFetch(vertices, indices.data(), indices.size());
+
+    after = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+}
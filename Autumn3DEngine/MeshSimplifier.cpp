@@ -0,0 +1,321 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// Symmetric 4x4 quadric stored as its 10 unique coefficients
+struct Quadric
+{
+    double m_A00 = 0, m_A01 = 0, m_A02 = 0, m_A11 = 0, m_A12 = 0, m_A22 = 0;
+    double m_B0 = 0, m_B1 = 0, m_B2 = 0, m_C = 0;
+
+    static Quadric FromPlane(const glm::dvec3& normal, double distance)
+    {
+        Quadric q;
+        q.m_A00 = normal.x * normal.x; q.m_A01 = normal.x * normal.y; q.m_A02 = normal.x * normal.z;
+        q.m_A11 = normal.y * normal.y; q.m_A12 = normal.y * normal.z; q.m_A22 = normal.z * normal.z;
+        q.m_B0 = normal.x * distance; q.m_B1 = normal.y * distance; q.m_B2 = normal.z * distance;
+        q.m_C = distance * distance;
+        return q;
+    }
+
+    void Add(const Quadric& q)
+    {
+        m_A00 += q.m_A00; m_A01 += q.m_A01; m_A02 += q.m_A02; m_A11 += q.m_A11; m_A12 += q.m_A12; m_A22 += q.m_A22;
+        m_B0 += q.m_B0; m_B1 += q.m_B1; m_B2 += q.m_B2; m_C += q.m_C;
+    }
+
+    // Sum of squared distances from p to the accumulated planes
+    double Evaluate(const glm::vec3& p) const
+    {
+        const double x = p.x, y = p.y, z = p.z;
+        const double value = m_A00 * x * x + 2 * m_A01 * x * y + 2 * m_A02 * x * z + m_A11 * y * y + 2 * m_A12 * y * z + m_A22 * z * z
+            + 2 * (m_B0 * x + m_B1 * y + m_B2 * z) + m_C;
+        return std::max(value, 0.0);
+    }
+};
+
+struct Collapse
+{
+    unsigned int m_From;
+    unsigned int m_To;
+    double m_Cost;
+};
+
+// Bit pattern of a position, used to find vertices that share one
+struct PositionKey
+{
+    uint32_t m_Bits[3];
+    bool operator==(const PositionKey& other) const { return std::memcmp(m_Bits, other.m_Bits, sizeof(m_Bits)) == 0; }
+};
+
+float MeshSimplifier::Simplify(const Model::Mesh::Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+    size_t targetIndexCount, float maxError, std::vector<unsigned int>& result)
+{
+    result.assign(indices, indices + indexCount);
+    if (indexCount % 3 != 0 || indexCount <= targetIndexCount)
+        return 0.0f;
+
+    // Vertices sharing a position with another vertex sit on an attribute seam and are locked.
+    // Only vertices the triangles use count; other LODs or primitives may leave unreferenced ones in the array.
+    std::vector<bool> locked(vertexCount, false);
+    std::vector<unsigned int> positionIds(vertexCount);
+    {
+        std::vector<bool> referenced(vertexCount, false);
+        for (size_t i = 0; i < indexCount; ++i)
+            referenced[indices[i]] = true;
+
+        std::vector<unsigned int> byPosition;
+        byPosition.reserve(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            positionIds[v] = static_cast<unsigned int>(v);
+            if (referenced[v])
+                byPosition.push_back(static_cast<unsigned int>(v));
+        }
+
+        // Sorting by the position bits groups equal positions; each group maps to its first vertex
+        auto positionBits = [vertices](unsigned int v)
+        {
+            PositionKey key;
+            std::memcpy(key.m_Bits, &vertices[v].m_Position, sizeof(key.m_Bits));
+            return key;
+        };
+        std::sort(byPosition.begin(), byPosition.end(), [&positionBits](unsigned int a, unsigned int b)
+        {
+            const PositionKey keyA = positionBits(a), keyB = positionBits(b);
+            return std::memcmp(keyA.m_Bits, keyB.m_Bits, sizeof(keyA.m_Bits)) < 0 || (keyA == keyB && a < b);
+        });
+
+        for (size_t i = 1; i < byPosition.size(); ++i)
+        {
+            if (positionBits(byPosition[i]) == positionBits(byPosition[i - 1]))
+            {
+                positionIds[byPosition[i]] = positionIds[byPosition[i - 1]];
+                locked[byPosition[i]] = locked[byPosition[i - 1]] = true;
+            }
+        }
+    }
+
+    // Edges without an opposite half-edge are open borders; edges used more than twice are non-manifold
+    {
+        std::vector<size_t> offsets(vertexCount + 1, 0);
+        for (size_t i = 0; i < indexCount; ++i)
+            ++offsets[positionIds[indices[i]] + 1];
+        for (size_t v = 0; v < vertexCount; ++v)
+            offsets[v + 1] += offsets[v];
+
+        std::vector<unsigned int> triangles(indexCount);
+        std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indexCount; ++i)
+            triangles[fill[positionIds[indices[i]]]++] = static_cast<unsigned int>(i / 3);
+
+        // Counts the triangles around position a that contain the directed edge from -> to
+        auto countHalfEdges = [&](unsigned int a, unsigned int from, unsigned int to)
+        {
+            int count = 0;
+            for (size_t t = offsets[a]; t < offsets[a + 1]; ++t)
+            {
+                const unsigned int* triangle = &indices[triangles[t] * 3];
+                for (int e = 0; e < 3; ++e)
+                    count += (positionIds[triangle[e]] == from && positionIds[triangle[(e + 1) % 3]] == to) ? 1 : 0;
+            }
+            return count;
+        };
+
+        for (size_t i = 0; i < indexCount; i += 3)
+        {
+            for (int e = 0; e < 3; ++e)
+            {
+                const unsigned int a = indices[i + e], b = indices[i + (e + 1) % 3];
+                const unsigned int pa = positionIds[a], pb = positionIds[b];
+                if (countHalfEdges(pa, pa, pb) != 1 || countHalfEdges(pa, pb, pa) != 1)
+                    locked[a] = locked[b] = true;
+            }
+        }
+    }
+
+    // Plane quadric of every triangle, accumulated on its vertices
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        const glm::dvec3 p0 = vertices[indices[i]].m_Position, p1 = vertices[indices[i + 1]].m_Position, p2 = vertices[indices[i + 2]].m_Position;
+        const glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const double length = glm::length(normal);
+        if (length == 0.0)
+            continue;
+
+        const glm::dvec3 unitNormal = normal / length;
+        const Quadric plane = Quadric::FromPlane(unitNormal, -glm::dot(unitNormal, p0));
+        for (int c = 0; c < 3; ++c)
+            quadrics[indices[i + c]].Add(plane);
+    }
+
+    const double maxCost = static_cast<double>(maxError) * maxError;
+    double appliedCost = 0.0;
+
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<size_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<Collapse> bestCollapse(vertexCount);
+
+    // Each pass collapses a batch of the cheapest independent edges, then rebuilds the index buffer
+    while (result.size() > targetIndexCount)
+    {
+        const size_t triangleCount = result.size() / 3;
+
+        // Vertex -> triangle adjacency of the current triangles
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (unsigned int index : result)
+            ++adjacencyOffsets[index + 1];
+        for (size_t v = 0; v < vertexCount; ++v)
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        adjacency.resize(result.size());
+        std::vector<size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            for (int c = 0; c < 3; ++c)
+                adjacency[fill[result[t * 3 + c]]++] = static_cast<unsigned int>(t);
+        }
+
+        // Cheapest collapse of every movable vertex; sorting one candidate per vertex instead of per edge keeps passes fast
+        std::fill(bestCollapse.begin(), bestCollapse.end(), Collapse{ 0, 0, std::numeric_limits<double>::infinity() });
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int e = 0; e < 3; ++e)
+            {
+                const unsigned int a = result[i + e], b = result[i + (e + 1) % 3];
+                if (!locked[a])
+                {
+                    const double cost = quadrics[a].Evaluate(vertices[b].m_Position);
+                    if (cost < bestCollapse[a].m_Cost)
+                        bestCollapse[a] = { a, b, cost };
+                }
+                if (!locked[b])
+                {
+                    const double cost = quadrics[b].Evaluate(vertices[a].m_Position);
+                    if (cost < bestCollapse[b].m_Cost)
+                        bestCollapse[b] = { b, a, cost };
+                }
+            }
+        }
+
+        collapses.clear();
+        for (const Collapse& collapse : bestCollapse)
+        {
+            if (collapse.m_Cost <= maxCost)
+                collapses.push_back(collapse);
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.m_Cost < y.m_Cost; });
+
+        // Every collapse removes about two triangles
+        const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t removed = 0;
+        for (size_t v = 0; v < vertexCount; ++v)
+            remap[v] = static_cast<unsigned int>(v);
+        std::fill(touched.begin(), touched.end(), false);
+
+        for (const Collapse& collapse : collapses)
+        {
+            if (collapse.m_Cost > maxCost || removed >= trianglesToRemove)
+                break;
+            if (touched[collapse.m_From] || touched[collapse.m_To])
+                continue;
+
+            // Reject collapses that would flip a surviving triangle around the moving vertex
+            const glm::vec3& target = vertices[collapse.m_To].m_Position;
+            bool flips = false;
+            for (size_t a = adjacencyOffsets[collapse.m_From]; a < adjacencyOffsets[collapse.m_From + 1] && !flips; ++a)
+            {
+                const unsigned int* triangle = &result[adjacency[a] * 3];
+                if (triangle[0] == collapse.m_To || triangle[1] == collapse.m_To || triangle[2] == collapse.m_To)
+                    continue;
+
+                glm::vec3 before[3], after[3];
+                for (int c = 0; c < 3; ++c)
+                {
+                    before[c] = vertices[triangle[c]].m_Position;
+                    after[c] = triangle[c] == collapse.m_From ? target : before[c];
+                }
+                const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                flips = glm::dot(normalBefore, normalAfter) <= 0.0f;
+            }
+            if (flips)
+                continue;
+
+            remap[collapse.m_From] = collapse.m_To;
+            quadrics[collapse.m_To].Add(quadrics[collapse.m_From]);
+            appliedCost = std::max(appliedCost, collapse.m_Cost);
+
+            // Freeze the neighbourhood so later collapses in this pass see up-to-date geometry
+            for (size_t a = adjacencyOffsets[collapse.m_From]; a < adjacencyOffsets[collapse.m_From + 1]; ++a)
+            {
+                const unsigned int* triangle = &result[adjacency[a] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+                removed += (triangle[0] == collapse.m_To || triangle[1] == collapse.m_To || triangle[2] == collapse.m_To) ? 1 : 0;
+            }
+        }
+
+        if (removed == 0)
+            break;
+
+        // Rewrite the triangles and drop the ones that became degenerate
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            const unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    return static_cast<float>(std::sqrt(appliedCost));
+}
+
+void MeshSimplifier::BuildLods(Model::Mesh& mesh, unsigned int lodCount)
+{
+    for (auto& submesh : mesh.m_Submeshes)
+    {
+        // LOD 0 is the submesh as imported; any previous chain is dropped
+        submesh.m_Lods.resize(std::min<size_t>(submesh.m_Lods.size(), 1));
+        if (submesh.m_Lods.empty())
+            continue;
+
+        const Model::Mesh::Lod& lod0 = submesh.m_Lods[0];
+        const Model::Mesh::Vertex* vertices = mesh.m_Vertices.data() + submesh.m_BaseVertex;
+        std::vector<unsigned int> source(mesh.m_Indices.begin() + lod0.m_FirstIndex, mesh.m_Indices.begin() + lod0.m_FirstIndex + lod0.m_IndexCount);
+        if (source.empty() || source.size() % 3 != 0 || *std::max_element(source.begin(), source.end()) >= submesh.m_VertexCount)
+            continue;
+
+        std::vector<unsigned int> simplified;
+        std::vector<size_t> clusters;
+        float error = 0.0f;
+        for (unsigned int level = 1; level <= lodCount; ++level)
+        {
+            const size_t targetIndexCount = source.size() / 6 * 3;
+            if (targetIndexCount < 3 * 64)
+                break;
+
+            // Levels are built from the previous one, so their errors add up
+            error += Simplify(vertices, submesh.m_VertexCount, source.data(), source.size(), targetIndexCount,
+                std::numeric_limits<float>::max(), simplified);
+            if (simplified.size() * 10 > source.size() * 9)
+                break;
+
+            MeshOptimizer::OptimizeVertexCache(simplified.data(), simplified.size(), submesh.m_VertexCount, clusters);
+            submesh.m_Lods.push_back({ mesh.m_Indices.size(), simplified.size(), error });
+            mesh.m_Indices.insert(mesh.m_Indices.end(), simplified.begin(), simplified.end());
+            source.swap(simplified);
+        }
+    }
+}
@@ -0,0 +1,242 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Fills the bounding sphere and normal cone of every meshlet of a submesh
+static void ComputeMeshletBounds(Model::Mesh& mesh, const Model::Mesh::Submesh& submesh)
+{
+    using Meshlets = Model::Mesh::Meshlets;
+    Meshlets& meshlets = mesh.m_Meshlets;
+    const Model::Mesh::Vertex* vertices = mesh.m_Vertices.data() + submesh.m_BaseVertex;
+
+    std::vector<glm::vec3> normals;
+    for (size_t m = submesh.m_FirstMeshlet; m < submesh.m_FirstMeshlet + submesh.m_MeshletCount; ++m)
+    {
+        const unsigned int* indices = &mesh.m_Indices[size_t(meshlets.m_FirstTriangle[m]) * 3];
+        const size_t indexCount = size_t(meshlets.m_TriangleCount[m]) * 3;
+
+        // Sphere around the centre of the bounding box
+        glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(-std::numeric_limits<float>::max());
+        for (size_t i = 0; i < indexCount; ++i)
+        {
+            boundsMin = glm::min(boundsMin, vertices[indices[i]].m_Position);
+            boundsMax = glm::max(boundsMax, vertices[indices[i]].m_Position);
+        }
+        const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        float radiusSquared = 0.0f;
+        for (size_t i = 0; i < indexCount; ++i)
+        {
+            const glm::vec3 offset = vertices[indices[i]].m_Position - center;
+            radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+        }
+
+        // The cone axis is the average face normal; the cutoff is the sine of the widest angle between it and a face normal
+        normals.clear();
+        glm::vec3 axis(0.0f);
+        for (size_t i = 0; i < indexCount; i += 3)
+        {
+            const glm::vec3& a = vertices[indices[i]].m_Position;
+            const glm::vec3 normal = glm::cross(vertices[indices[i + 1]].m_Position - a, vertices[indices[i + 2]].m_Position - a);
+            const float length = glm::length(normal);
+            if (length <= 0.0f)
+                continue;
+            normals.push_back(normal / length);
+            axis += normals.back();
+        }
+
+        float cutoff = 1.0f; // a cutoff of 1 never rejects the meshlet
+        const float axisLength = glm::length(axis);
+        if (axisLength > 0.0f)
+        {
+            axis /= axisLength;
+            float minDot = 1.0f;
+            for (const glm::vec3& normal : normals)
+                minDot = std::min(minDot, glm::dot(axis, normal));
+
+            // Cones wider than about 84 degrees from the axis are too wide to ever reject anything
+            if (minDot > 0.1f)
+                cutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+
+        meshlets.GetStream(Meshlets::CenterX)[m] = center.x;
+        meshlets.GetStream(Meshlets::CenterY)[m] = center.y;
+        meshlets.GetStream(Meshlets::CenterZ)[m] = center.z;
+        meshlets.GetStream(Meshlets::Radius)[m] = std::sqrt(radiusSquared);
+        meshlets.GetStream(Meshlets::ConeAxisX)[m] = axis.x;
+        meshlets.GetStream(Meshlets::ConeAxisY)[m] = axis.y;
+        meshlets.GetStream(Meshlets::ConeAxisZ)[m] = axis.z;
+        meshlets.GetStream(Meshlets::ConeCutoff)[m] = cutoff;
+    }
+}
+
+void MeshletBuilder::Build(Model::Mesh& mesh)
+{
+    mesh.m_Meshlets = Model::Mesh::Meshlets();
+    for (auto& submesh : mesh.m_Submeshes)
+    {
+        submesh.m_FirstMeshlet = submesh.m_MeshletCount = 0;
+        if (!submesh.m_Lods.empty())
+            BuildSubmesh(mesh, submesh);
+    }
+
+    // The bounds streams are laid out once the total meshlet count is known
+    mesh.m_Meshlets.m_Bounds.assign(Model::Mesh::Meshlets::StreamCount * mesh.m_Meshlets.m_Count, 0.0f);
+    for (const auto& submesh : mesh.m_Submeshes)
+        ComputeMeshletBounds(mesh, submesh);
+}
+
+void MeshletBuilder::BuildSubmesh(Model::Mesh& mesh, Model::Mesh::Submesh& submesh)
+{
+    const Model::Mesh::Lod& lod0 = submesh.m_Lods[0];
+    const size_t indexCount = lod0.m_IndexCount;
+    const size_t triangleCount = indexCount / 3;
+    const size_t vertexCount = submesh.m_VertexCount;
+    if (triangleCount <= MAX_TRIANGLES || indexCount % 3 != 0 || lod0.m_FirstIndex % 3 != 0)
+        return;
+    unsigned int* indices = mesh.m_Indices.data() + lod0.m_FirstIndex;
+    const Model::Mesh::Vertex* vertices = mesh.m_Vertices.data() + submesh.m_BaseVertex;
+    if (*std::max_element(indices, indices + indexCount) >= vertexCount)
+        return;
+
+    // Vertex -> triangle adjacency in compressed rows, and how many triangles around each vertex are still unassigned
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; ++i)
+        ++liveTriangles[indices[i]];
+
+    std::vector<size_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+    std::vector<unsigned int> adjacency(indexCount);
+    {
+        std::vector<size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indexCount; ++i)
+            adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    // Stamp of the meshlet a vertex was last added to, so membership tests are O(1) without clearing anything
+    std::vector<size_t> vertexMeshlet(vertexCount, std::numeric_limits<size_t>::max());
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> order; // triangles in meshlet order
+    order.reserve(triangleCount);
+    std::vector<unsigned int> meshletVertices;
+    meshletVertices.reserve(MAX_VERTICES);
+
+    Model::Mesh::Meshlets& meshlets = mesh.m_Meshlets;
+    submesh.m_FirstMeshlet = meshlets.m_Count;
+    size_t seed = 0;
+    glm::vec3 positionSum(0.0f);
+
+    auto addTriangle = [&](size_t triangle)
+    {
+        emitted[triangle] = true;
+        order.push_back(static_cast<unsigned int>(triangle));
+        for (int e = 0; e < 3; ++e)
+        {
+            const unsigned int vertex = indices[triangle * 3 + e];
+            --liveTriangles[vertex];
+            if (vertexMeshlet[vertex] != meshlets.m_Count)
+            {
+                vertexMeshlet[vertex] = meshlets.m_Count;
+                meshletVertices.push_back(vertex);
+                positionSum += vertices[vertex].m_Position;
+            }
+        }
+    };
+
+    while (order.size() < triangleCount)
+    {
+        // Continue next to the previous meshlet on the triangle with the fewest unassigned neighbours, so the remaining
+        // surface is consumed from its border and no isolated islands are left behind
+        size_t start = std::numeric_limits<size_t>::max();
+        unsigned int startScore = std::numeric_limits<unsigned int>::max();
+        for (const unsigned int vertex : meshletVertices)
+        {
+            for (size_t a = adjacencyOffsets[vertex]; liveTriangles[vertex] > 0 && a < adjacencyOffsets[vertex + 1]; ++a)
+            {
+                const unsigned int triangle = adjacency[a];
+                const unsigned int* corners = &indices[size_t(triangle) * 3];
+                const unsigned int score = liveTriangles[corners[0]] + liveTriangles[corners[1]] + liveTriangles[corners[2]];
+                if (!emitted[triangle] && score < startScore)
+                {
+                    start = triangle;
+                    startScore = score;
+                }
+            }
+        }
+
+        // Otherwise follow the existing triangle order, which the vertex cache optimizer already made spatially coherent
+        if (start == std::numeric_limits<size_t>::max())
+        {
+            while (emitted[seed])
+                ++seed;
+            start = seed;
+        }
+
+        const size_t meshletStart = order.size();
+        meshletVertices.clear();
+        positionSum = glm::vec3(0.0f);
+        addTriangle(start);
+
+        for (unsigned int meshletTriangles = 1; meshletTriangles < MAX_TRIANGLES; ++meshletTriangles)
+        {
+            const glm::vec3 center = positionSum / static_cast<float>(meshletVertices.size());
+
+            // Pick the neighbour that adds the fewest vertices, then the one closest to the meshlet centre
+            size_t best = std::numeric_limits<size_t>::max();
+            int bestNewVertices = 4;
+            float bestDistance = std::numeric_limits<float>::max();
+            for (const unsigned int vertex : meshletVertices)
+            {
+                if (liveTriangles[vertex] == 0)
+                    continue;
+
+                for (size_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; ++a)
+                {
+                    const unsigned int triangle = adjacency[a];
+                    if (emitted[triangle])
+                        continue;
+
+                    const unsigned int* corners = &indices[size_t(triangle) * 3];
+                    int newVertices = 0;
+                    for (int e = 0; e < 3; ++e)
+                        newVertices += vertexMeshlet[corners[e]] != meshlets.m_Count ? 1 : 0;
+                    if (newVertices > bestNewVertices || meshletVertices.size() + newVertices > MAX_VERTICES)
+                        continue;
+
+                    const glm::vec3 offset = (vertices[corners[0]].m_Position + vertices[corners[1]].m_Position
+                        + vertices[corners[2]].m_Position) * (1.0f / 3.0f) - center;
+                    const float distance = glm::dot(offset, offset);
+                    if (newVertices < bestNewVertices || distance < bestDistance)
+                    {
+                        best = triangle;
+                        bestNewVertices = newVertices;
+                        bestDistance = distance;
+                    }
+                }
+            }
+
+            // The meshlet is full or has no unassigned neighbours left
+            if (best == std::numeric_limits<size_t>::max())
+                break;
+            addTriangle(best);
+        }
+
+        meshlets.m_FirstTriangle.push_back(static_cast<uint32_t>(lod0.m_FirstIndex / 3 + meshletStart));
+        meshlets.m_TriangleCount.push_back(static_cast<uint32_t>(order.size() - meshletStart));
+        ++meshlets.m_Count;
+    }
+    submesh.m_MeshletCount = meshlets.m_Count - submesh.m_FirstMeshlet;
+
+    // Rewrite LOD 0 in meshlet order; coarser LODs behind it are untouched
+    std::vector<unsigned int> reordered(indexCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        reordered[t * 3 + 0] = indices[size_t(order[t]) * 3 + 0];
+        reordered[t * 3 + 1] = indices[size_t(order[t]) * 3 + 1];
+        reordered[t * 3 + 2] = indices[size_t(order[t]) * 3 + 2];
+    }
+    std::copy(reordered.begin(), reordered.end(), indices);
+}
@@ -1,6 +1,35 @@
 #include "Model.h"
+#include "AccessorView.h"
+#include "GltfBuffers.h"
+#include "MappedFile.h"
+#include "MeshBvh.h"
+#include "MeshCache.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+#include "VertexDecoder.h"
+#include "VertexFormat.h"
+#include "VertexWelder.h"
 
-Model::Model(const std::string& modelPath, bool gamma) : m_GammaCorrection(gamma) 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <limits>
+#include <numeric>
+#include <sstream>
+
+#include "json.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+Model::Model(const std::string& modelPath, bool gamma, const ModelImportSettings& settings, MeshLoadedCallback onMeshLoaded,
+    NodesLoadedCallback onNodesLoaded) :
+    m_GammaCorrection(gamma), m_ImportSettings(settings), m_OnMeshLoaded(std::move(onMeshLoaded)), m_OnNodesLoaded(std::move(onNodesLoaded))
 {
     try 
     {
@@ -15,152 +44,727 @@ Model::Model(const std::string& modelPath, bool gamma) : m_GammaCorrection(gamma
 
 void Model::LoadModel(const std::string& modelPath)
 {
+    m_Path = modelPath;
+    m_Directory = modelPath.substr(0, modelPath.find_last_of('/'));
+
+    m_Transforms.Clear();
+    m_Instances.clear();
+
+    // Map the source once: it is hashed for the mesh cache and, for .glb files, parsed in place
+    std::shared_ptr<MappedFile> sourceFile;
+    if (m_ImportSettings.m_UseMeshCache || m_ImportSettings.m_MapSourceFile)
+    {
+        try
+        {
+            sourceFile = std::make_shared<MappedFile>(modelPath);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to map model file, falling back to buffered reads: " << e.what() << std::endl;
+        }
+    }
+
+    // A cache hit maps the cooked meshes and skips parsing entirely
+    uint64_t sourceHash = 0;
+    const std::string cachePath = MeshCache::GetCachePath(modelPath);
+    if (m_ImportSettings.m_UseMeshCache && sourceFile)
+    {
+        try
+        {
+            sourceHash = MeshCache::HashFile(*sourceFile);
+            m_CookedFile = MeshCache::Load(cachePath, sourceHash, GetCacheOptions(), m_Meshes, m_Transforms, m_Instances);
+            if (m_CookedFile)
+            {
+                AssignNodeBounds();
+                if (m_ImportSettings.m_BuildOccluders)
+                {
+                    for (const auto& mesh : m_Meshes)
+                        OcclusionCuller::BuildOccluder(*mesh);
+                }
+                std::cout << "Loaded " << m_Meshes.size() << " meshes from mesh cache " << cachePath << std::endl;
+                if (m_OnNodesLoaded)
+                    m_OnNodesLoaded(m_Transforms, m_Instances);
+                if (m_OnMeshLoaded)
+                {
+                    for (size_t i = 0; i < m_Meshes.size(); ++i)
+                        m_OnMeshLoaded(i, m_Meshes[i]);
+                }
+                return;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Mesh cache unavailable, importing from source: " << e.what() << std::endl;
+        }
+    }
+
     tinygltf::Model gltfModel;
-    tinygltf::TinyGLTF loader;
-    std::string err, warn;
+    GltfBuffers buffers;
 
-    if (!loader.LoadBinaryFromFile(&gltfModel, &err, &warn, modelPath)) 
+    if (!m_ImportSettings.m_MapSourceFile || !sourceFile || !LoadMappedBinary(*sourceFile, gltfModel, buffers))
     {
-        throw std::runtime_error("Failed to load GLB file: " + err);
+        tinygltf::TinyGLTF loader;
+        std::string err, warn;
+
+        gltfModel = tinygltf::Model();
+        if (!loader.LoadBinaryFromFile(&gltfModel, &err, &warn, modelPath)) 
+        {
+            throw std::runtime_error("Failed to load GLB file: " + err);
+        }
+        buffers.Reset(gltfModel);
     }
 
-    m_Directory = modelPath.substr(0, modelPath.find_last_of('/'));
+    LoadImages(gltfModel);
 
     try
     {
-        ProcessNode(gltfModel);
+        // Node 0 is the model root; the scene's nodes hang below it
+        m_Transforms.AddNode(TransformHierarchy::NO_PARENT, glm::mat4(1.0f));
+
+        std::vector<int> meshSlots(gltfModel.meshes.size(), -1), meshIndices;
+        std::vector<bool> visited(gltfModel.nodes.size(), false);
+        const int sceneIndex = gltfModel.defaultScene >= 0 ? gltfModel.defaultScene : 0;
+        if (sceneIndex < static_cast<int>(gltfModel.scenes.size()))
+        {
+            for (const int node : gltfModel.scenes[sceneIndex].nodes)
+                ProcessNode(gltfModel, node, 0, meshSlots, meshIndices, visited);
+        }
+        else
+        {
+            // Without scenes every node that is nobody's child is a root
+            std::vector<bool> isChild(gltfModel.nodes.size(), false);
+            for (const auto& node : gltfModel.nodes)
+            {
+                for (const int child : node.children)
+                {
+                    if (child >= 0 && child < static_cast<int>(isChild.size()))
+                        isChild[child] = true;
+                }
+            }
+            for (size_t node = 0; node < gltfModel.nodes.size(); ++node)
+            {
+                if (!isChild[node])
+                    ProcessNode(gltfModel, static_cast<int>(node), 0, meshSlots, meshIndices, visited);
+            }
+        }
+
+        if (m_OnNodesLoaded)
+            m_OnNodesLoaded(m_Transforms, m_Instances);
+
+        ProcessMeshes(gltfModel, buffers, meshIndices);
+        AssignNodeBounds();
     }
     catch (const std::exception& e)
     {
         std::cerr << "Error processing model nodes: " << e.what() << std::endl;
         throw;
     }
+
+    // Failing to write the cache only costs the next launch a full import
+    if (m_ImportSettings.m_UseMeshCache && sourceHash != 0)
+    {
+        try
+        {
+            MeshCache::Write(cachePath, sourceHash, GetCacheOptions(), m_Meshes, m_Transforms, m_Instances);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to write mesh cache: " << e.what() << std::endl;
+        }
+    }
+}
+
+// Reads a little-endian 32-bit value from the GLB header
+static uint32_t ReadGlbWord(const unsigned char* bytes)
+{
+    return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
 }
 
-void Model::ProcessNode(const tinygltf::Model& gltfModel) {
-    for (const auto& node : gltfModel.nodes)
+bool Model::LoadMappedBinary(const MappedFile& file, tinygltf::Model& gltfModel, GltfBuffers& buffers)
+{
+    const unsigned char* bytes = file.Data();
+    const size_t size = file.Size();
+
+    // Header: magic, version, length. Then the JSON chunk and an optional BIN chunk.
+    if (size < 20 || ReadGlbWord(bytes) != 0x46546C67 || ReadGlbWord(bytes + 16) != 0x4E4F534A)
+        return false;
+
+    const size_t jsonLength = ReadGlbWord(bytes + 12);
+    const size_t binChunkOffset = 20 + jsonLength;
+    if (binChunkOffset > size)
+        throw std::runtime_error("Invalid GLB file: the JSON chunk exceeds the file size.");
+
+    const unsigned char* binData = nullptr;
+    size_t binLength = 0;
+    if (binChunkOffset + 8 <= size && ReadGlbWord(bytes + binChunkOffset + 4) == 0x004E4942)
+    {
+        binLength = ReadGlbWord(bytes + binChunkOffset);
+        binData = bytes + binChunkOffset + 8;
+        if (binChunkOffset + 8 + binLength > size)
+            throw std::runtime_error("Invalid GLB file: the BIN chunk exceeds the file size.");
+    }
+
+    nlohmann::json document = nlohmann::json::parse(bytes + 20, bytes + 20 + jsonLength);
+
+    // Images are decoded from the mapping below; ones stored outside the BIN chunk need the regular loader
+    nlohmann::json images = document.contains("images") ? document["images"] : nlohmann::json::array();
+    for (const auto& image : images)
+    {
+        if (!image.contains("bufferView"))
+            return false;
+    }
+    document.erase("images");
+
+    // Shrink the embedded buffer to a 4 byte placeholder so tinygltf does not copy the BIN chunk
+    std::vector<size_t> embeddedBuffers;
+    if (document.contains("buffers"))
+    {
+        auto& gltfBuffers = document["buffers"];
+        for (size_t i = 0; i < gltfBuffers.size(); ++i)
+        {
+            if (gltfBuffers[i].contains("uri"))
+                continue;
+
+            if (!binData || gltfBuffers[i].value("byteLength", size_t(0)) > binLength)
+                throw std::runtime_error("Invalid GLB file: buffer " + std::to_string(i) + " is larger than the BIN chunk.");
+
+            gltfBuffers[i]["byteLength"] = 4;
+            embeddedBuffers.push_back(i);
+        }
+    }
+
+    // Rebuild a small GLB from the patched JSON and the placeholder BIN chunk
+    std::string json = document.dump();
+    json.resize((json.size() + 3) & ~size_t(3), ' ');
+
+    std::vector<unsigned char> glb(12 + 8 + json.size() + 8 + 4, 0);
+    auto writeWord = [&glb](size_t offset, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+            glb[offset + i] = static_cast<unsigned char>(value >> (8 * i));
+    };
+    writeWord(0, 0x46546C67);                             // "glTF"
+    writeWord(4, 2);                                      // version
+    writeWord(8, static_cast<uint32_t>(glb.size()));      // total length
+    writeWord(12, static_cast<uint32_t>(json.size()));
+    writeWord(16, 0x4E4F534A);                            // "JSON"
+    std::memcpy(&glb[20], json.data(), json.size());
+    writeWord(20 + json.size(), 4);
+    writeWord(24 + json.size(), 0x004E4942);              // "BIN\0"
+
+    tinygltf::TinyGLTF loader;
+    std::string err, warn;
+    const std::string baseDirectory = std::filesystem::path(file.Path()).parent_path().string();
+    if (!loader.LoadBinaryFromMemory(&gltfModel, &err, &warn, glb.data(), static_cast<unsigned int>(glb.size()), baseDirectory))
+    {
+        throw std::runtime_error("Failed to load GLB file: " + err);
+    }
+
+    // Embedded buffers read straight from the mapped BIN chunk
+    buffers.Reset(gltfModel);
+    for (size_t bufferIndex : embeddedBuffers)
+        buffers.Bind(bufferIndex, binData, binLength);
+
+    // Decode the embedded images from the mapping with tinygltf's own decoder
+    gltfModel.images.reserve(images.size());
+    for (size_t i = 0; i < images.size(); ++i)
     {
-        if (node.mesh >= 0)
+        tinygltf::Image image;
+        image.name = images[i].value("name", "");
+        image.mimeType = images[i].value("mimeType", "");
+        image.bufferView = images[i]["bufferView"].get<int>();
+
+        const auto& bufferView = gltfModel.bufferViews.at(image.bufferView);
+        const GltfBuffers::Span& buffer = buffers[bufferView.buffer];
+        if (bufferView.byteOffset + bufferView.byteLength > buffer.m_Size)
+            throw std::runtime_error("Invalid GLB file: image " + std::to_string(i) + " exceeds its buffer.");
+
+        if (!tinygltf::LoadImageData(&image, static_cast<int>(i), &err, &warn, 0, 0, buffer.m_Data + bufferView.byteOffset,
+            static_cast<int>(bufferView.byteLength), nullptr))
         {
-            const tinygltf::Mesh& mesh = gltfModel.meshes[node.mesh];
-            m_Meshes.emplace_back(ProcessMesh(mesh, gltfModel));
+            throw std::runtime_error("Failed to decode image " + std::to_string(i) + ": " + err);
         }
+
+        gltfModel.images.emplace_back(std::move(image));
     }
+
+    return true;
+}
+
+uint64_t Model::GetCacheOptions() const
+{
+    uint64_t options = 0;
+    options |= m_ImportSettings.m_CompactVertices ? 1ull : 0ull;
+    options |= m_ImportSettings.m_OptimizeMeshes ? 2ull : 0ull;
+    options |= m_ImportSettings.m_WeldVertices ? 4ull : 0ull;
+    options |= m_ImportSettings.m_BuildMeshlets ? 8ull : 0ull;
+    options |= m_ImportSettings.m_BuildBvh ? 16ull : 0ull;
+    options |= uint64_t(std::min(m_ImportSettings.m_LodCount, 255u)) << 8;
+
+    uint32_t epsilonBits;
+    std::memcpy(&epsilonBits, &m_ImportSettings.m_WeldEpsilon, sizeof(epsilonBits));
+    options |= uint64_t(epsilonBits) << 32;
+    return options;
 }
 
-std::shared_ptr<Model::Mesh> Model::ProcessMesh(const tinygltf::Mesh& gltfMesh, const tinygltf::Model& gltfModel) 
+void Model::LoadImages(tinygltf::Model& gltfModel)
 {
+    // The pixels are moved, not copied; meshes then share one decoded copy per image
+    m_Images.clear();
+    m_Images.reserve(gltfModel.images.size());
+    for (size_t i = 0; i < gltfModel.images.size(); ++i)
+    {
+        tinygltf::Image& gltfImage = gltfModel.images[i];
+
+        auto image = std::make_shared<Mesh::TextureImage>();
+        image->m_ImageIndex = static_cast<int>(i);
+        image->m_Width = gltfImage.width;
+        image->m_Height = gltfImage.height;
+        image->m_Components = gltfImage.component;
+        image->m_Pixels = std::move(gltfImage.image);
+        image->m_ContentHash = MeshCache::HashBytes(image->m_Pixels.data(), image->m_Pixels.size());
+        m_Images.emplace_back(image);
+    }
+}
+
+// Runs an import pass that rewrites a vertex and an index array over every submesh of a mesh in turn, then reassembles the
+// mesh from the results. Passes may change the vertex and index counts. Only LOD 0 is passed on, so this runs before LODs are built.
+static void ProcessSubmeshes(Model::Mesh& mesh, const std::function<void(std::vector<Model::Mesh::Vertex>&, std::vector<unsigned int>&)>& pass)
+{
+    // A single submesh covers both arrays, which are processed in place
+    if (mesh.m_Submeshes.size() == 1)
+    {
+        pass(mesh.m_Vertices, mesh.m_Indices);
+        mesh.m_Submeshes[0].m_VertexCount = mesh.m_Vertices.size();
+        mesh.m_Submeshes[0].m_Lods = { { 0, mesh.m_Indices.size(), 0.0f } };
+        return;
+    }
+
     std::vector<Model::Mesh::Vertex> vertices;
     std::vector<unsigned int> indices;
-    std::vector<tinygltf::Image> textureImages;
+    vertices.reserve(mesh.m_Vertices.size());
+    indices.reserve(mesh.m_Indices.size());
+    for (auto& submesh : mesh.m_Submeshes)
+    {
+        const Model::Mesh::Lod& lod = submesh.m_Lods[0];
+        std::vector<Model::Mesh::Vertex> submeshVertices(mesh.m_Vertices.begin() + submesh.m_BaseVertex, mesh.m_Vertices.begin() + submesh.m_BaseVertex + submesh.m_VertexCount);
+        std::vector<unsigned int> submeshIndices(mesh.m_Indices.begin() + lod.m_FirstIndex, mesh.m_Indices.begin() + lod.m_FirstIndex + lod.m_IndexCount);
+        pass(submeshVertices, submeshIndices);
 
-    // Iterate over the primitives in the mesh
-    for (const auto& primitive : gltfMesh.primitives)
+        submesh.m_BaseVertex = vertices.size();
+        submesh.m_VertexCount = submeshVertices.size();
+        submesh.m_Lods = { { indices.size(), submeshIndices.size(), 0.0f } };
+        vertices.insert(vertices.end(), submeshVertices.begin(), submeshVertices.end());
+        indices.insert(indices.end(), submeshIndices.begin(), submeshIndices.end());
+    }
+
+    mesh.m_Vertices.swap(vertices);
+    mesh.m_Indices.swap(indices);
+}
+
+// Local transform of a glTF node: its matrix if it has one, its translation * rotation * scale otherwise
+static glm::mat4 GetNodeTransform(const tinygltf::Node& node)
+{
+    if (node.matrix.size() == 16)
     {
-        // Process vertex positions
-        const auto& positionsAccessor = gltfModel.accessors[primitive.attributes.at("POSITION")];
-        const auto& bufferView = gltfModel.bufferViews[positionsAccessor.bufferView];
-        const auto& buffer = gltfModel.buffers[bufferView.buffer];
-        const float* positions = reinterpret_cast<const float*>(&buffer.data[bufferView.byteOffset + positionsAccessor.byteOffset]);
+        glm::mat4 matrix;
+        for (int i = 0; i < 16; ++i)
+            matrix[i / 4][i % 4] = static_cast<float>(node.matrix[i]);
+        return matrix;
+    }
 
-        // Iterate over each vertex
-        for (size_t i = 0; i < positionsAccessor.count; ++i) 
+    glm::mat4 transform(1.0f);
+    if (node.translation.size() == 3)
+        transform = glm::translate(transform, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
+    if (node.rotation.size() == 4)
+        transform *= glm::mat4_cast(glm::quat(static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]), static_cast<float>(node.rotation[1]), static_cast<float>(node.rotation[2])));
+    if (node.scale.size() == 3)
+        transform = glm::scale(transform, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+    return transform;
+}
+
+void Model::ProcessNode(const tinygltf::Model& gltfModel, int nodeIndex, uint32_t parent, std::vector<int>& meshSlots, std::vector<int>& meshIndices, std::vector<bool>& visited)
+{
+    // A node reachable twice would make the hierarchy a graph
+    if (nodeIndex < 0 || nodeIndex >= static_cast<int>(gltfModel.nodes.size()) || visited[nodeIndex])
+    {
+        std::cerr << "Skipping invalid or repeated node " << nodeIndex << std::endl;
+        return;
+    }
+    visited[nodeIndex] = true;
+
+    const tinygltf::Node& node = gltfModel.nodes[nodeIndex];
+    const uint32_t transformNode = static_cast<uint32_t>(m_Transforms.AddNode(parent, GetNodeTransform(node)));
+
+    if (node.mesh >= 0 && node.mesh < static_cast<int>(meshSlots.size()))
+    {
+        // Meshes are imported once however many nodes instance them
+        if (meshSlots[node.mesh] < 0)
         {
-            Model::Mesh::Vertex vertex;
-            vertex.m_Position = glm::vec3(positions[i * 3 + 0], positions[i * 3 + 1], positions[i * 3 + 2]);
+            meshSlots[node.mesh] = static_cast<int>(meshIndices.size());
+            meshIndices.push_back(node.mesh);
+        }
+        m_Instances.push_back({ transformNode, static_cast<uint32_t>(meshSlots[node.mesh]) });
+    }
 
-            // Process normals
-            if (primitive.attributes.find("NORMAL") != primitive.attributes.end())
-            {
-                const auto& normalAccessor = gltfModel.accessors[primitive.attributes.at("NORMAL")];
-                const auto& normalBufferView = gltfModel.bufferViews[normalAccessor.bufferView];
-                const auto& normalBuffer = gltfModel.buffers[normalBufferView.buffer];
-                const float* normals = reinterpret_cast<const float*>(&normalBuffer.data[normalBufferView.byteOffset + normalAccessor.byteOffset]);
-                vertex.m_Normal = glm::vec3(normals[i * 3 + 0], normals[i * 3 + 1], normals[i * 3 + 2]);
-            }
+    for (const int child : node.children)
+        ProcessNode(gltfModel, child, transformNode, meshSlots, meshIndices, visited);
+}
+
+void Model::AssignNodeBounds()
+{
+    for (const auto& instance : m_Instances)
+        m_Transforms.SetBounds(instance.m_Node, m_Meshes[instance.m_Mesh]->m_Bounds);
+}
+
+// Writes a log line built by an import worker in one insertion, so lines from concurrent workers do not interleave
+static void WriteLogLine(const std::ostringstream& line)
+{
+    std::cout << line.str() + '\n' << std::flush;
+}
+
+void Model::ProcessMeshes(const tinygltf::Model& gltfModel, const GltfBuffers& buffers, const std::vector<int>& meshIndices)
+{
+    const auto importStart = std::chrono::steady_clock::now();
+
+    const unsigned int hardwareThreads = ThreadPool::ResolveThreadCount(m_ImportSettings.m_ThreadCount);
+    const unsigned int threadCount = std::min<unsigned int>(hardwareThreads, static_cast<unsigned int>(meshIndices.size()));
+
+    // Threads left over when there are fewer meshes than threads go to welding each mesh and building its BVH
+    const unsigned int weldThreadCount = std::max(1u, hardwareThreads / std::max(threadCount, 1u));
+
+    // One pool welds the large submeshes of every mesh. It cannot be the import pool: its workers would block on
+    // chunks queued behind them.
+    std::unique_ptr<ThreadPool> weldPool;
+    if (m_ImportSettings.m_WeldVertices && weldThreadCount > 1)
+        weldPool = std::make_unique<ThreadPool>(weldThreadCount);
+
+    // Processes a single mesh and reports how long it took
+    auto processTimed = [this, &gltfModel, &buffers, &meshIndices, &weldPool, weldThreadCount](size_t i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<Mesh> mesh = ProcessMesh(gltfModel.meshes[meshIndices[i]], gltfModel, buffers);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::ostringstream importLine;
+        importLine << "Imported mesh " << i + 1 << "/" << meshIndices.size() << " '" << gltfModel.meshes[meshIndices[i]].name
+            << "' (" << mesh->m_Vertices.size() << " vertices) in " << elapsed.count() << " ms";
+        if (elapsed.count() > 0.0)
+            importLine << " (" << static_cast<size_t>(mesh->m_Vertices.size() / (elapsed.count() / 1000.0)) << " vertices/s)";
+        WriteLogLine(importLine);
 
-            // Process texture coordinates
-            if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end())
+        if (m_ImportSettings.m_WeldVertices)
+        {
+            const size_t originalCount = mesh->m_Vertices.size();
+            ProcessSubmeshes(*mesh, [this, &weldPool](std::vector<Mesh::Vertex>& vertices, std::vector<unsigned int>& indices)
             {
-                const auto& texcoordAccessor = gltfModel.accessors[primitive.attributes.at("TEXCOORD_0")];
-                const auto& texcoordBufferView = gltfModel.bufferViews[texcoordAccessor.bufferView];
-                const auto& texcoordBuffer = gltfModel.buffers[texcoordBufferView.buffer];
-                const float* texcoords = reinterpret_cast<const float*>(&texcoordBuffer.data[texcoordBufferView.byteOffset + texcoordAccessor.byteOffset]);
-                vertex.m_TexCoords = glm::vec2(texcoords[i * 2 + 0], texcoords[i * 2 + 1]);
-            }
+                VertexWelder::Weld(vertices, indices, m_ImportSettings.m_WeldEpsilon, weldPool.get());
+            });
+
+            const size_t weldedCount = mesh->m_Vertices.size();
+            std::ostringstream weldLine;
+            weldLine << "Welded mesh " << i + 1 << "/" << meshIndices.size() << ": " << originalCount << " -> " << weldedCount << " vertices";
+            if (weldedCount > 0)
+                weldLine << " (" << static_cast<double>(originalCount) / weldedCount << "x)";
+            WriteLogLine(weldLine);
+        }
 
-            // Process tangents
-            if (primitive.attributes.find("TANGENT") != primitive.attributes.end()) 
+        if (m_ImportSettings.m_OptimizeMeshes)
+        {
+            // Statistics of the submeshes are averaged by triangle (ACMR) and vertex (ATVR) count
+            MeshOptimizer::CacheStatistics before, after;
+            double triangleCount = 0.0, vertexCount = 0.0;
+            const auto optimizeStart = std::chrono::steady_clock::now();
+            ProcessSubmeshes(*mesh, [&](std::vector<Mesh::Vertex>& vertices, std::vector<unsigned int>& indices)
             {
-                const auto& tangentAccessor = gltfModel.accessors[primitive.attributes.at("TANGENT")];
-                const auto& tangentBufferView = gltfModel.bufferViews[tangentAccessor.bufferView];
-                const auto& tangentBuffer = gltfModel.buffers[tangentBufferView.buffer];
-                const float* tangents = reinterpret_cast<const float*>(&tangentBuffer.data[tangentBufferView.byteOffset + tangentAccessor.byteOffset]);
-                vertex.m_Tangent = glm::vec3(tangents[i * 3 + 0], tangents[i * 3 + 1], tangents[i * 3 + 2]);
-            }
+                MeshOptimizer::CacheStatistics submeshBefore, submeshAfter;
+                MeshOptimizer::Optimize(vertices, indices, submeshBefore, submeshAfter);
+
+                const double triangles = static_cast<double>(indices.size() / 3), verticesUsed = static_cast<double>(vertices.size());
+                before.m_ACMR += static_cast<float>(submeshBefore.m_ACMR * triangles);
+                after.m_ACMR += static_cast<float>(submeshAfter.m_ACMR * triangles);
+                before.m_ATVR += static_cast<float>(submeshBefore.m_ATVR * verticesUsed);
+                after.m_ATVR += static_cast<float>(submeshAfter.m_ATVR * verticesUsed);
+                triangleCount += triangles;
+                vertexCount += verticesUsed;
+            });
+            const std::chrono::duration<double, std::milli> optimizeElapsed = std::chrono::steady_clock::now() - optimizeStart;
 
-            // Process bitangents (optional, not always available in glTF)
-            if (primitive.attributes.find("BITANGENT") != primitive.attributes.end())
+            const float triangleWeight = triangleCount > 0.0 ? static_cast<float>(1.0 / triangleCount) : 0.0f;
+            const float vertexWeight = vertexCount > 0.0 ? static_cast<float>(1.0 / vertexCount) : 0.0f;
+            std::ostringstream optimizeLine;
+            optimizeLine << "Optimized mesh " << i + 1 << "/" << meshIndices.size() << " in " << optimizeElapsed.count() << " ms: ACMR "
+                << before.m_ACMR * triangleWeight << " -> " << after.m_ACMR * triangleWeight << ", ATVR "
+                << before.m_ATVR * vertexWeight << " -> " << after.m_ATVR * vertexWeight;
+            WriteLogLine(optimizeLine);
+        }
+
+        if (m_ImportSettings.m_LodCount > 0)
+        {
+            MeshSimplifier::BuildLods(*mesh, m_ImportSettings.m_LodCount);
+
+            for (size_t s = 0; s < mesh->m_Submeshes.size(); ++s)
             {
-                const auto& bitangentAccessor = gltfModel.accessors[primitive.attributes.at("BITANGENT")];
-                const auto& bitangentBufferView = gltfModel.bufferViews[bitangentAccessor.bufferView];
-                const auto& bitangentBuffer = gltfModel.buffers[bitangentBufferView.buffer];
-                const float* bitangents = reinterpret_cast<const float*>(&bitangentBuffer.data[bitangentBufferView.byteOffset + bitangentAccessor.byteOffset]);
-                vertex.m_Bitangent = glm::vec3(bitangents[i * 3 + 0], bitangents[i * 3 + 1], bitangents[i * 3 + 2]);
+                std::ostringstream lodLine;
+                lodLine << "Built " << mesh->m_Submeshes[s].m_Lods.size() << " LODs for mesh " << i + 1 << "/" << meshIndices.size();
+                if (mesh->m_Submeshes.size() > 1)
+                    lodLine << " submesh " << s + 1 << "/" << mesh->m_Submeshes.size();
+                lodLine << ":";
+                for (const auto& lod : mesh->m_Submeshes[s].m_Lods)
+                    lodLine << " " << lod.m_IndexCount / 3 << " triangles (error " << lod.m_Error << ")";
+                WriteLogLine(lodLine);
             }
+        }
 
-            // Process bone weights and IDs (for skinned models)
-            if (primitive.attributes.find("JOINTS_0") != primitive.attributes.end() &&
-                primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end())
+        if (m_ImportSettings.m_BuildMeshlets)
+        {
+            MeshletBuilder::Build(*mesh);
+            if (mesh->m_Meshlets.m_Count > 0)
             {
-                const auto& jointsAccessor = gltfModel.accessors[primitive.attributes.at("JOINTS_0")];
-                const auto& weightsAccessor = gltfModel.accessors[primitive.attributes.at("WEIGHTS_0")];
-                const auto& jointsBufferView = gltfModel.bufferViews[jointsAccessor.bufferView];
-                const auto& jointsBuffer = gltfModel.buffers[jointsBufferView.buffer];
-                const unsigned short* joints = reinterpret_cast<const unsigned short*>(&jointsBuffer.data[jointsBufferView.byteOffset + jointsAccessor.byteOffset]);
-                const float* weights = reinterpret_cast<const float*>(&gltfModel.buffers[gltfModel.bufferViews[weightsAccessor.bufferView].buffer].data[weightsAccessor.byteOffset]);
-
-                // For each vertex, assign bone IDs and weights
-                for (int j = 0; j < MAX_BONE_INFLUENCE; ++j) 
-                {
-                    vertex.m_BoneIDs[j] = (j < jointsAccessor.count) ? joints[i * MAX_BONE_INFLUENCE + j] : 0;
-                    vertex.m_Weights[j] = (j < weightsAccessor.count) ? weights[i * MAX_BONE_INFLUENCE + j] : 0.0f;
-                }
+                std::ostringstream meshletLine;
+                meshletLine << "Split mesh " << i + 1 << "/" << meshIndices.size() << " into " << mesh->m_Meshlets.m_Count << " meshlets";
+                WriteLogLine(meshletLine);
             }
+        }
 
-            vertices.push_back(vertex);
+        if (m_ImportSettings.m_BuildOccluders)
+            OcclusionCuller::BuildOccluder(*mesh);
+
+        if (m_ImportSettings.m_BuildBvh)
+        {
+            const auto bvhStart = std::chrono::steady_clock::now();
+            MeshBvh::Build(*mesh, weldThreadCount);
+            const std::chrono::duration<double, std::milli> bvhElapsed = std::chrono::steady_clock::now() - bvhStart;
+            std::ostringstream bvhLine;
+            bvhLine << "Built BVH for mesh " << i + 1 << "/" << meshIndices.size() << ": " << mesh->m_Bvh.m_TriangleIds.size() << " triangles, "
+                << mesh->m_Bvh.m_Nodes.size() << " nodes in " << bvhElapsed.count() << " ms";
+            WriteLogLine(bvhLine);
         }
 
-        // Process indices (handle if indices exist)
+        // Hand the mesh out right away so it can be uploaded while the rest of the model is still importing
+        if (m_OnMeshLoaded)
+            m_OnMeshLoaded(i, mesh);
+        return mesh;
+    };
+
+    m_Meshes.reserve(m_Meshes.size() + meshIndices.size());
+    if (threadCount <= 1)
+    {
+        for (size_t i = 0; i < meshIndices.size(); ++i)
+            m_Meshes.emplace_back(processTimed(i));
+    }
+    else
+    {
+        ThreadPool pool(threadCount);
+        std::vector<std::future<std::shared_ptr<Mesh>>> results;
+        results.reserve(meshIndices.size());
+
+        for (size_t i = 0; i < meshIndices.size(); ++i)
+            results.emplace_back(pool.Submit([&processTimed, i]() { return processTimed(i); }));
+
+        // Collecting in submission order keeps m_Meshes in meshIndices order; get() rethrows any import error
+        for (auto& result : results)
+            m_Meshes.emplace_back(result.get());
+    }
+
+    const std::chrono::duration<double, std::milli> totalElapsed = std::chrono::steady_clock::now() - importStart;
+    std::cout << "Imported " << meshIndices.size() << " meshes (" << m_Instances.size() << " instances, " << m_Transforms.Size()
+        << " nodes) on " << std::max(threadCount, 1u) << " thread(s) in " << totalElapsed.count() << " ms" << std::endl;
+}
+
+// Reads the min/max of a float vec3 accessor, rounded outwards to float. Returns false if the accessor has none.
+static bool GetAccessorBounds(const tinygltf::Accessor& accessor, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+    // Quantized positions would need their min/max decoded the same way as the vertices
+    if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || accessor.minValues.size() != 3 || accessor.maxValues.size() != 3)
+        return false;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        boundsMin[i] = static_cast<float>(accessor.minValues[i]);
+        if (boundsMin[i] > accessor.minValues[i])
+            boundsMin[i] = std::nextafter(boundsMin[i], -std::numeric_limits<float>::max());
+        boundsMax[i] = static_cast<float>(accessor.maxValues[i]);
+        if (boundsMax[i] < accessor.maxValues[i])
+            boundsMax[i] = std::nextafter(boundsMax[i], std::numeric_limits<float>::max());
+    }
+    return boundsMin.x <= boundsMax.x && boundsMin.y <= boundsMax.y && boundsMin.z <= boundsMax.z;
+}
+
+std::shared_ptr<Model::Mesh> Model::ProcessMesh(const tinygltf::Mesh& gltfMesh, const tinygltf::Model& gltfModel, const GltfBuffers& buffers)
+{
+    std::vector<Model::Mesh::Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<std::shared_ptr<Mesh::TextureImage>> textureImages;
+    std::vector<Mesh::Submesh> submeshes;
+
+    // Size the vertex and index arrays once for all primitives
+    size_t vertexCount = 0, indexCount = 0;
+    for (const auto& primitive : gltfMesh.primitives)
+    {
+        const size_t primitiveVertexCount = gltfModel.accessors.at(primitive.attributes.at("POSITION")).count;
+        vertexCount += primitiveVertexCount;
+        indexCount += primitive.indices >= 0 ? gltfModel.accessors[primitive.indices].count : primitiveVertexCount;
+    }
+    vertices.resize(vertexCount);
+    indices.reserve(indexCount);
+
+    // Every primitive becomes a submesh over its own range of the shared vertex and index arrays
+    size_t baseVertex = 0;
+    for (const auto& primitive : gltfMesh.primitives)
+    {
+        Mesh::Submesh submesh;
+        submesh.m_BaseVertex = baseVertex;
+
+        // Resolve every attribute accessor once, then decode all vertices of the primitive in one pass
+        submesh.m_VertexCount = VertexDecoder::DecodePrimitive(primitive, gltfModel, buffers, vertices.data() + baseVertex);
+        baseVertex += submesh.m_VertexCount;
+
+        // The POSITION accessor's min/max saves scanning the vertices; Mesh::ComputeBounds() scans primitives without them
+        glm::vec3 accessorMin, accessorMax;
+        if (GetAccessorBounds(gltfModel.accessors[primitive.attributes.at("POSITION")], accessorMin, accessorMax))
+            submesh.m_Bounds = Bounds::FromBox(accessorMin, accessorMax);
+
+        // Process indices. They stay relative to the primitive's first vertex, which the submesh draws with as its base vertex.
+        // 32-bit sources are copied with a single memcpy, narrower ones are widened.
+        const size_t firstIndex = indices.size();
         if (primitive.indices >= 0)
         {
-            const auto& indicesAccessor = gltfModel.accessors[primitive.indices];
-            const auto& indicesBufferView = gltfModel.bufferViews[indicesAccessor.bufferView];
-            const auto& indicesBuffer = gltfModel.buffers[indicesBufferView.buffer];
-            const unsigned int* indicesData = reinterpret_cast<const unsigned int*>(&indicesBuffer.data[indicesBufferView.byteOffset + indicesAccessor.byteOffset]);
-            indices.insert(indices.end(), indicesData, indicesData + indicesAccessor.count);
+            const AccessorView<uint32_t, 1> indexView(gltfModel, buffers, primitive.indices);
+            indices.resize(firstIndex + indexView.Count());
+            indexView.CopyTo(indices.data() + firstIndex);
         }
+        else
+        {
+            // Non-indexed primitives draw their vertices in order
+            indices.resize(firstIndex + submesh.m_VertexCount);
+            std::iota(indices.begin() + firstIndex, indices.end(), 0u);
+        }
+        submesh.m_Lods.push_back({ firstIndex, indices.size() - firstIndex, 0.0f });
 
-        // Handle materials (if they exist)
+        // Handle materials (if they exist). Primitives sampling the same image share one texture.
         if (primitive.material >= 0) 
         {
+            submesh.m_Material = primitive.material;
             const auto& material = gltfModel.materials[primitive.material];
             if (material.pbrMetallicRoughness.baseColorTexture.index >= 0)
             {
                 const auto& textureInfo = material.pbrMetallicRoughness.baseColorTexture;
-                const auto& image = gltfModel.images[gltfModel.textures[textureInfo.index].source];
-                textureImages.push_back(image);
+                const auto& image = m_Images.at(gltfModel.textures[textureInfo.index].source);
+                auto found = std::find(textureImages.begin(), textureImages.end(), image);
+                if (found == textureImages.end())
+                    found = textureImages.insert(textureImages.end(), image);
+                submesh.m_Texture = static_cast<int>(found - textureImages.begin());
             }
         }
+
+        submeshes.push_back(std::move(submesh));
     }
 
-    return std::make_shared<Mesh>(vertices, indices, textureImages);
+    // Submeshes with the same texture are drawn together
+    std::stable_sort(submeshes.begin(), submeshes.end(), [](const Mesh::Submesh& a, const Mesh::Submesh& b) { return a.m_Texture < b.m_Texture; });
+
+    // Indices are relative to the base vertex, so 16 bits are enough while no submesh has more than 65536 vertices.
+    // Welding and optimizing never add vertices, so this holds for the processed mesh as well.
+    const bool wideIndices = std::any_of(submeshes.begin(), submeshes.end(), [](const Mesh::Submesh& submesh) { return submesh.m_VertexCount > 65536; });
+
+    auto mesh = std::make_shared<Mesh>(std::move(vertices), std::move(indices), std::move(textureImages));
+    mesh->m_Submeshes = std::move(submeshes);
+    mesh->m_IndexType = wideIndices ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT : TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+    mesh->ComputeBounds();
+    if (m_ImportSettings.m_CompactVertices)
+        mesh->m_VertexLayout = VertexFormat::SelectLayout(mesh->m_Vertices.data(), mesh->m_Vertices.size());
+    return mesh;
 }
 
-Model::Mesh::Mesh(const std::vector<Model::Mesh::Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<tinygltf::Image>& textureImages) :
-    m_VAO(0), m_VBO(0), m_EBO(0)
+Model::Mesh::Mesh(std::vector<Model::Mesh::Vertex> vertices, std::vector<unsigned int> indices, std::vector<std::shared_ptr<TextureImage>> textureImages) :
+    m_VertexLayout(VertexLayout::Full), m_IndexType(TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT),
+    m_Released(false), m_ReleasedVertexCount(0), m_ReleasedIndexCount(0)
 {
-    m_Vertices = vertices;
-    m_Indices = indices;
-    m_TextureImages = textureImages;
+    m_Vertices = std::move(vertices);
+    m_Indices = std::move(indices);
+    m_TextureImages = std::move(textureImages);
+}
+
+glm::vec3 Model::Mesh::GetPosition(size_t vertex) const
+{
+    if (!IsCooked())
+        return m_Vertices[vertex].m_Position;
+
+    const unsigned char* record = static_cast<const unsigned char*>(m_Cooked.m_Vertices) + vertex * VertexFormat::GetStride(m_VertexLayout);
+    if (m_VertexLayout != VertexLayout::Full)
+        return VertexFormat::UnpackPosition(record, m_Bounds.m_Min, m_Bounds.m_Max);
+
+    glm::vec3 position;
+    std::memcpy(&position, record + offsetof(Vertex, m_Position), sizeof(position));
+    return position;
+}
+
+void Model::Mesh::ComputeBounds()
+{
+    // Cooked submeshes carry their bounds, which packed positions are quantized against
+    m_Bounds = Bounds();
+    for (auto& submesh : m_Submeshes)
+    {
+        if (submesh.m_Bounds.IsEmpty() && !m_Released && !IsCooked() && submesh.m_VertexCount > 0)
+            submesh.m_Bounds = Bounds::FromPositions(&m_Vertices[submesh.m_BaseVertex].m_Position, submesh.m_VertexCount, sizeof(Vertex));
+        m_Bounds.Merge(submesh.m_Bounds);
+    }
+}
+
+void Model::Mesh::ReleaseCpuData()
+{
+    if (m_Released)
+        return;
+
+    m_ReleasedVertexCount = GetVertexCount();
+    m_ReleasedIndexCount = GetIndexCount();
+
+    // Swapping with empty vectors returns the memory; clear() would keep the capacity
+    vector<Vertex>().swap(m_Vertices);
+    vector<unsigned int>().swap(m_Indices);
+    vector<std::shared_ptr<TextureImage>>().swap(m_TextureImages);
+    m_Cooked = CookedData();
+    m_Released = true;
+}
+
+void Model::Mesh::RestoreCpuData(Mesh&& source)
+{
+    m_Submeshes = std::move(source.m_Submeshes);
+    m_Meshlets = std::move(source.m_Meshlets);
+    m_Vertices = std::move(source.m_Vertices);
+    m_Indices = std::move(source.m_Indices);
+    m_TextureImages = std::move(source.m_TextureImages);
+    m_Cooked = std::move(source.m_Cooked);
+    m_Released = false;
+}
+
+void Model::ReleaseCpuData()
+{
+    for (const auto& mesh : m_Meshes)
+        mesh->ReleaseCpuData();
+
+    vector<std::shared_ptr<Mesh::TextureImage>>().swap(m_Images);
+    m_CookedFile.reset();
+}
+
+void Model::RestoreCpuData()
+{
+    const bool released = std::any_of(m_Meshes.begin(), m_Meshes.end(), [](const std::shared_ptr<Mesh>& mesh) { return !mesh->HasCpuData(); });
+    if (!released)
+        return;
+
+    // A fresh import hits the mesh cache when it is valid, so this is usually just a mapping
+    ModelImportSettings settings = m_ImportSettings;
+    settings.m_Residency = MeshResidency::KeepCpuCopy;
+    Model reloaded(m_Path, m_GammaCorrection, settings);
+    if (reloaded.m_Meshes.size() != m_Meshes.size())
+        throw std::runtime_error("Cannot restore " + m_Path + ": the file changed since it was loaded.");
+
+    // Every mesh takes the new data, since cooked meshes still resident point into the mapping being replaced
+    for (size_t i = 0; i < m_Meshes.size(); ++i)
+        m_Meshes[i]->RestoreCpuData(std::move(*reloaded.m_Meshes[i]));
+
+    m_Images = std::move(reloaded.m_Images);
+    m_CookedFile = std::move(reloaded.m_CookedFile);
 }
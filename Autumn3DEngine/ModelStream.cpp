@@ -0,0 +1,83 @@
+#include "ModelStream.h"
+
+ModelStream::ModelStream(const std::string& modelPath, const ModelImportSettings& settings, const glm::mat4& rootTransform) :
+    m_Path(modelPath), m_Settings(settings), m_RootTransform(rootTransform), m_DecodedCount(0), m_UploadedCount(0), m_Imported(false),
+    m_Failed(false), m_NodesLoaded(false)
+{
+    m_Import = std::async(std::launch::async, [this]() { Import(); });
+}
+
+ModelStream::~ModelStream()
+{
+    // The import cannot be cancelled; it only references this object, so wait for it before tearing down
+    if (m_Import.valid())
+        m_Import.wait();
+}
+
+std::string ModelStream::GetError() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Error;
+}
+
+std::shared_ptr<Model> ModelStream::GetModel() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Model;
+}
+
+bool ModelStream::PopDecodedMesh(size_t& meshIndex, std::shared_ptr<Model::Mesh>& mesh)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_DecodedMeshes.empty())
+        return false;
+
+    meshIndex = m_DecodedMeshes.front().first;
+    mesh = std::move(m_DecodedMeshes.front().second);
+    m_DecodedMeshes.pop_front();
+    return true;
+}
+
+void ModelStream::AddUploadedMesh(size_t meshIndex, const std::shared_ptr<Model::Mesh>& mesh)
+{
+    if (meshIndex >= m_UploadedMeshes.size())
+        m_UploadedMeshes.resize(meshIndex + 1);
+    m_UploadedMeshes[meshIndex] = mesh;
+    ++m_UploadedCount;
+}
+
+void ModelStream::Import()
+{
+    try
+    {
+        // Meshes are queued from the import workers as they finish
+        auto onMeshLoaded = [this](size_t meshIndex, const std::shared_ptr<Model::Mesh>& mesh)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_DecodedMeshes.emplace_back(meshIndex, mesh);
+            ++m_DecodedCount;
+        };
+
+        // The hierarchy is copied once, before any mesh is queued, and not written again
+        auto onNodesLoaded = [this](const TransformHierarchy& transforms, const std::vector<Model::MeshInstance>& instances)
+        {
+            m_Transforms = transforms;
+            m_Transforms.SetLocal(0, m_RootTransform);
+            m_Instances = instances;
+            m_NodesLoaded = true;
+        };
+
+        auto model = std::make_shared<Model>(m_Path, false, m_Settings, onMeshLoaded, onNodesLoaded);
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Model = model;
+    }
+    catch (const std::exception& e)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Error = e.what();
+        m_Failed = true;
+    }
+
+    m_Imported = true;
+}
@@ -0,0 +1,390 @@
+#include "OcclusionCuller.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <future>
+#include <limits>
+
+OcclusionCuller::OcclusionCuller(unsigned int threadCount) :
+    m_Width(0), m_Height(0), m_TilesX(0), m_TilesY(0), m_ViewProjection(1.0f)
+{
+    const unsigned int resolvedCount = ThreadPool::ResolveThreadCount(threadCount);
+    if (resolvedCount > 1)
+        m_Pool = std::make_unique<ThreadPool>(resolvedCount);
+    SetResolution(256, 128);
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+}
+
+void OcclusionCuller::BuildOccluder(Model::Mesh& mesh)
+{
+    mesh.m_Occluder = Model::Mesh::Occluder();
+    if (!mesh.HasCpuData())
+        return;
+
+    const size_t vertexCount = mesh.GetVertexCount();
+    auto getIndex = [&mesh](size_t i) -> size_t
+    {
+        if (!mesh.IsCooked())
+            return mesh.m_Indices[i];
+        if (mesh.m_IndexType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+            return static_cast<const uint16_t*>(mesh.m_Cooked.m_Indices)[i];
+        return static_cast<const uint32_t*>(mesh.m_Cooked.m_Indices)[i];
+    };
+
+    // Only the vertices the chosen LODs use are kept
+    std::vector<uint32_t> remap(vertexCount, std::numeric_limits<uint32_t>::max());
+    Model::Mesh::Occluder& occluder = mesh.m_Occluder;
+    for (const auto& submesh : mesh.m_Submeshes)
+    {
+        if (submesh.m_Lods.empty())
+            continue;
+
+        // LOD 0 has no error, so there is always a level to pick
+        size_t lodIndex = 0;
+        for (size_t l = 1; l < submesh.m_Lods.size(); ++l)
+        {
+            if (submesh.m_Lods[l].m_Error <= OCCLUDER_LOD_ERROR * submesh.m_Bounds.m_Radius)
+                lodIndex = l;
+        }
+
+        const Model::Mesh::Lod& lod = submesh.m_Lods[lodIndex];
+        for (size_t i = lod.m_FirstIndex; i + 2 < lod.m_FirstIndex + lod.m_IndexCount; i += 3)
+        {
+            size_t corners[3];
+            bool valid = true;
+            for (int c = 0; c < 3; ++c)
+            {
+                corners[c] = submesh.m_BaseVertex + getIndex(i + c);
+                valid = valid && corners[c] < vertexCount;
+            }
+            if (!valid)
+                continue;
+
+            for (const size_t vertex : corners)
+            {
+                if (remap[vertex] == std::numeric_limits<uint32_t>::max())
+                {
+                    remap[vertex] = static_cast<uint32_t>(occluder.m_Positions.size());
+                    occluder.m_Positions.push_back(mesh.GetPosition(vertex));
+                }
+                occluder.m_Indices.push_back(remap[vertex]);
+            }
+        }
+    }
+}
+
+void OcclusionCuller::SetResolution(int width, int height)
+{
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    if (width == m_Width && height == m_Height)
+        return;
+
+    m_Width = width;
+    m_Height = height;
+    m_TilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    m_TilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    m_Bins.assign(size_t(m_TilesX) * m_TilesY, std::vector<uint32_t>());
+
+    // Level 0 is padded to whole tiles so the SIMD spans never need a tail
+    m_Levels.clear();
+    Level level;
+    level.m_Width = width;
+    level.m_Height = height;
+    level.m_Stride = m_TilesX * TILE_WIDTH;
+    level.m_Depth.assign(size_t(level.m_Stride) * m_TilesY * TILE_HEIGHT, 1.0f);
+    m_Levels.push_back(std::move(level));
+
+    while (m_Levels.back().m_Width > 1 || m_Levels.back().m_Height > 1)
+    {
+        Level next;
+        next.m_Width = (m_Levels.back().m_Width + 1) / 2;
+        next.m_Height = (m_Levels.back().m_Height + 1) / 2;
+        next.m_Stride = next.m_Width;
+        next.m_Depth.assign(size_t(next.m_Width) * next.m_Height, 1.0f);
+        m_Levels.push_back(std::move(next));
+    }
+}
+
+void OcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+{
+    m_ViewProjection = viewProjection;
+    m_Triangles.clear();
+    for (auto& bin : m_Bins)
+        bin.clear();
+
+    // The other levels are rebuilt from level 0 after rasterizing
+    std::fill(m_Levels[0].m_Depth.begin(), m_Levels[0].m_Depth.end(), 1.0f);
+}
+
+void OcclusionCuller::AddOccluder(const glm::vec3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount, const glm::mat4& worldMatrix)
+{
+    // Project to pixel coordinates with depth in [0, 1]; w <= 0 marks vertices in front of the near plane
+    const glm::mat4 clip = m_ViewProjection * worldMatrix;
+    m_Projected.resize(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        const glm::vec4 p = clip * glm::vec4(positions[v], 1.0f);
+        if (p.w <= 0.0f || p.z < -p.w)
+        {
+            m_Projected[v] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+            continue;
+        }
+        const float inverseW = 1.0f / p.w;
+        m_Projected[v] = glm::vec4((p.x * inverseW * 0.5f + 0.5f) * m_Width, (p.y * inverseW * 0.5f + 0.5f) * m_Height, p.z * inverseW * 0.5f + 0.5f, 1.0f);
+    }
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount)
+            continue;
+        const glm::vec4& a = m_Projected[indices[i]];
+        const glm::vec4& b = m_Projected[indices[i + 1]];
+        const glm::vec4& c = m_Projected[indices[i + 2]];
+        if (a.w < 0.0f || b.w < 0.0f || c.w < 0.0f)
+            continue;
+
+        // Pixel centres i + 0.5 inside the bounding box, clamped to the buffer
+        Triangle triangle;
+        triangle.m_MinX = std::max(0, static_cast<int>(std::ceil(std::min(a.x, std::min(b.x, c.x)) - 0.5f)));
+        triangle.m_MinY = std::max(0, static_cast<int>(std::ceil(std::min(a.y, std::min(b.y, c.y)) - 0.5f)));
+        triangle.m_MaxX = std::min(m_Width - 1, static_cast<int>(std::floor(std::max(a.x, std::max(b.x, c.x)) - 0.5f)));
+        triangle.m_MaxY = std::min(m_Height - 1, static_cast<int>(std::floor(std::max(a.y, std::max(b.y, c.y)) - 0.5f)));
+        if (triangle.m_MinX > triangle.m_MaxX || triangle.m_MinY > triangle.m_MaxY)
+            continue;
+
+        // Both windings are drawn; the edges of clockwise triangles are flipped so the inside is positive
+        const float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+        if (std::fabs(area) < 1e-8f)
+            continue;
+        const float sign = area > 0.0f ? 1.0f : -1.0f;
+        const glm::vec4* corners[3] = { &a, &b, &c };
+        for (int e = 0; e < 3; ++e)
+        {
+            const glm::vec4& from = *corners[e];
+            const glm::vec4& to = *corners[(e + 1) % 3];
+            triangle.m_EdgeA[e] = sign * (from.y - to.y);
+            triangle.m_EdgeB[e] = sign * (to.x - from.x);
+            triangle.m_EdgeC[e] = sign * (from.x * to.y - from.y * to.x);
+        }
+
+        triangle.m_DzDx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+        triangle.m_DzDy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+        triangle.m_Z = a.z - triangle.m_DzDx * a.x - triangle.m_DzDy * a.y;
+
+        const uint32_t triangleIndex = static_cast<uint32_t>(m_Triangles.size());
+        m_Triangles.push_back(triangle);
+        for (int tileY = triangle.m_MinY / TILE_HEIGHT; tileY <= triangle.m_MaxY / TILE_HEIGHT; ++tileY)
+        {
+            for (int tileX = triangle.m_MinX / TILE_WIDTH; tileX <= triangle.m_MaxX / TILE_WIDTH; ++tileX)
+                m_Bins[size_t(tileY) * m_TilesX + tileX].push_back(triangleIndex);
+        }
+    }
+}
+
+void OcclusionCuller::Rasterize()
+{
+    const size_t tileCount = m_Bins.size();
+    if (!m_Pool || m_Triangles.empty())
+    {
+        for (size_t tile = 0; tile < tileCount; ++tile)
+            RasterizeTile(tile);
+    }
+    else
+    {
+        // Tiles own disjoint pixels, so workers just take the next tile until none are left
+        std::atomic<size_t> nextTile(0);
+        std::vector<std::future<void>> workers;
+        for (unsigned int t = 0; t < m_Pool->GetThreadCount(); ++t)
+        {
+            workers.push_back(m_Pool->Submit([this, &nextTile, tileCount]()
+            {
+                for (size_t tile = nextTile++; tile < tileCount; tile = nextTile++)
+                    RasterizeTile(tile);
+            }));
+        }
+        for (auto& worker : workers)
+            worker.get();
+    }
+
+    BuildPyramid();
+}
+
+void OcclusionCuller::RasterizeTile(size_t tile)
+{
+    const std::vector<uint32_t>& bin = m_Bins[tile];
+    if (bin.empty())
+        return;
+
+    const int tileX = static_cast<int>(tile % m_TilesX) * TILE_WIDTH;
+    const int tileY = static_cast<int>(tile / m_TilesX) * TILE_HEIGHT;
+    Level& level = m_Levels[0];
+
+    for (const uint32_t triangleIndex : bin)
+    {
+        const Triangle& t = m_Triangles[triangleIndex];
+
+        // Spans start on a multiple of four inside the tile; the edge functions reject the extra pixels
+        const int minX = std::max(t.m_MinX, tileX) & ~3;
+        const int maxX = std::min(t.m_MaxX, tileX + TILE_WIDTH - 1);
+        const int minY = std::max(t.m_MinY, tileY);
+        const int maxY = std::min(t.m_MaxY, tileY + TILE_HEIGHT - 1);
+
+        for (int y = minY; y <= maxY; ++y)
+        {
+            const float centerY = y + 0.5f;
+            float* row = level.m_Depth.data() + size_t(y) * level.m_Stride;
+
+#if defined(AUTUMN3D_SIMD_SSE2)
+
+            const __m128 centerX = _mm_add_ps(_mm_set1_ps(minX + 0.5f), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+            __m128 edge0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.m_EdgeA[0]), centerX), _mm_set1_ps(t.m_EdgeB[0] * centerY + t.m_EdgeC[0]));
+            __m128 edge1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.m_EdgeA[1]), centerX), _mm_set1_ps(t.m_EdgeB[1] * centerY + t.m_EdgeC[1]));
+            __m128 edge2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.m_EdgeA[2]), centerX), _mm_set1_ps(t.m_EdgeB[2] * centerY + t.m_EdgeC[2]));
+            __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.m_DzDx), centerX), _mm_set1_ps(t.m_DzDy * centerY + t.m_Z));
+            const __m128 step0 = _mm_set1_ps(t.m_EdgeA[0] * 4.0f), step1 = _mm_set1_ps(t.m_EdgeA[1] * 4.0f), step2 = _mm_set1_ps(t.m_EdgeA[2] * 4.0f);
+            const __m128 depthStep = _mm_set1_ps(t.m_DzDx * 4.0f);
+            const __m128 zero = _mm_setzero_ps();
+
+            for (int x = minX; x <= maxX; x += 4)
+            {
+                const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)), _mm_cmpge_ps(edge2, zero));
+                if (_mm_movemask_ps(inside))
+                {
+                    const __m128 stored = _mm_loadu_ps(row + x);
+                    const __m128 nearest = _mm_min_ps(stored, depth);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, stored)));
+                }
+                edge0 = _mm_add_ps(edge0, step0);
+                edge1 = _mm_add_ps(edge1, step1);
+                edge2 = _mm_add_ps(edge2, step2);
+                depth = _mm_add_ps(depth, depthStep);
+            }
+
+#elif defined(AUTUMN3D_SIMD_NEON)
+
+            const float32x4_t centerX = vaddq_f32(vdupq_n_f32(minX + 0.5f), float32x4_t{ 0.0f, 1.0f, 2.0f, 3.0f });
+            float32x4_t edge0 = vmlaq_n_f32(vdupq_n_f32(t.m_EdgeB[0] * centerY + t.m_EdgeC[0]), centerX, t.m_EdgeA[0]);
+            float32x4_t edge1 = vmlaq_n_f32(vdupq_n_f32(t.m_EdgeB[1] * centerY + t.m_EdgeC[1]), centerX, t.m_EdgeA[1]);
+            float32x4_t edge2 = vmlaq_n_f32(vdupq_n_f32(t.m_EdgeB[2] * centerY + t.m_EdgeC[2]), centerX, t.m_EdgeA[2]);
+            float32x4_t depth = vmlaq_n_f32(vdupq_n_f32(t.m_DzDy * centerY + t.m_Z), centerX, t.m_DzDx);
+            const float32x4_t step0 = vdupq_n_f32(t.m_EdgeA[0] * 4.0f), step1 = vdupq_n_f32(t.m_EdgeA[1] * 4.0f), step2 = vdupq_n_f32(t.m_EdgeA[2] * 4.0f);
+            const float32x4_t depthStep = vdupq_n_f32(t.m_DzDx * 4.0f);
+            const float32x4_t zero = vdupq_n_f32(0.0f);
+
+            for (int x = minX; x <= maxX; x += 4)
+            {
+                const uint32x4_t inside = vandq_u32(vandq_u32(vcgeq_f32(edge0, zero), vcgeq_f32(edge1, zero)), vcgeq_f32(edge2, zero));
+                const float32x4_t stored = vld1q_f32(row + x);
+                vst1q_f32(row + x, vbslq_f32(inside, vminq_f32(stored, depth), stored));
+                edge0 = vaddq_f32(edge0, step0);
+                edge1 = vaddq_f32(edge1, step1);
+                edge2 = vaddq_f32(edge2, step2);
+                depth = vaddq_f32(depth, depthStep);
+            }
+
+#else
+
+            for (int x = minX; x <= maxX; ++x)
+            {
+                const float centerX = x + 0.5f;
+                bool inside = true;
+                for (int e = 0; e < 3; ++e)
+                    inside = inside && t.m_EdgeA[e] * centerX + t.m_EdgeB[e] * centerY + t.m_EdgeC[e] >= 0.0f;
+                if (inside)
+                    row[x] = std::min(row[x], t.m_Z + t.m_DzDx * centerX + t.m_DzDy * centerY);
+            }
+
+#endif
+        }
+    }
+}
+
+void OcclusionCuller::BuildPyramid()
+{
+    // Every texel keeps the farthest depth of the up to four texels below it
+    for (size_t l = 1; l < m_Levels.size(); ++l)
+    {
+        const Level& source = m_Levels[l - 1];
+        Level& target = m_Levels[l];
+        for (int y = 0; y < target.m_Height; ++y)
+        {
+            const float* row0 = source.m_Depth.data() + size_t(y * 2) * source.m_Stride;
+            const float* row1 = source.m_Depth.data() + size_t(std::min(y * 2 + 1, source.m_Height - 1)) * source.m_Stride;
+            for (int x = 0; x < target.m_Width; ++x)
+            {
+                const int x0 = x * 2, x1 = std::min(x * 2 + 1, source.m_Width - 1);
+                target.m_Depth[size_t(y) * target.m_Stride + x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::IsVisible(const Bounds& worldBounds) const
+{
+    if (worldBounds.IsEmpty())
+        return false;
+
+    // Screen rectangle and nearest depth of the eight corners. Boxes reaching the near plane are always visible.
+    float minX = std::numeric_limits<float>::max(), minY = std::numeric_limits<float>::max(), nearestDepth = std::numeric_limits<float>::max();
+    float maxX = -std::numeric_limits<float>::max(), maxY = -std::numeric_limits<float>::max();
+    // Clip space is linear in the position, so the corners are the min corner plus combinations of the three edge vectors
+    const glm::vec4 origin = m_ViewProjection * glm::vec4(worldBounds.m_Min, 1.0f);
+    const glm::vec3 size = worldBounds.m_Max - worldBounds.m_Min;
+    const glm::vec4 edgeX = m_ViewProjection[0] * size.x, edgeY = m_ViewProjection[1] * size.y, edgeZ = m_ViewProjection[2] * size.z;
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        glm::vec4 p = origin;
+        if (corner & 1)
+            p += edgeX;
+        if (corner & 2)
+            p += edgeY;
+        if (corner & 4)
+            p += edgeZ;
+        if (p.w <= 0.0f || p.z < -p.w)
+            return true;
+
+        const float inverseW = 1.0f / p.w;
+        const float x = (p.x * inverseW * 0.5f + 0.5f) * m_Width, y = (p.y * inverseW * 0.5f + 0.5f) * m_Height;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearestDepth = std::min(nearestDepth, p.z * inverseW * 0.5f + 0.5f);
+    }
+
+    // Off-screen boxes are the frustum culler's business
+    if (maxX < 0.0f || maxY < 0.0f || minX >= m_Width || minY >= m_Height)
+        return true;
+
+    int x0 = std::max(0, static_cast<int>(minX)), y0 = std::max(0, static_cast<int>(minY));
+    int x1 = std::min(m_Width - 1, static_cast<int>(maxX)), y1 = std::min(m_Height - 1, static_cast<int>(maxY));
+
+    // The first level where the rectangle touches at most 2x2 texels
+    size_t levelIndex = 0;
+    while (levelIndex + 1 < m_Levels.size() && (x1 - x0 > 1 || y1 - y0 > 1))
+    {
+        x0 >>= 1;
+        y0 >>= 1;
+        x1 >>= 1;
+        y1 >>= 1;
+        ++levelIndex;
+    }
+
+    const Level& level = m_Levels[levelIndex];
+    for (int y = y0; y <= y1; ++y)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            if (nearestDepth <= level.m_Depth[size_t(y) * level.m_Stride + x])
+                return true;
+        }
+    }
+    return false;
+}
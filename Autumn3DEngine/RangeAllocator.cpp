@@ -0,0 +1,90 @@
+#include "RangeAllocator.h"
+
+#include <iterator>
+#include <stdexcept>
+
+RangeAllocator::RangeAllocator(uint64_t capacity) :
+    m_Capacity(0), m_Used(0)
+{
+    Grow(capacity);
+}
+
+uint64_t RangeAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    if (size == 0 || alignment == 0)
+        return INVALID_OFFSET;
+
+    // The smallest range that fits the size, skipping ranges too small once their start is aligned
+    for (auto candidate = m_FreeBySize.lower_bound({ size, 0 }); candidate != m_FreeBySize.end(); ++candidate)
+    {
+        const uint64_t rangeOffset = candidate->second, rangeSize = candidate->first;
+        const uint64_t offset = (rangeOffset + alignment - 1) / alignment * alignment;
+        const uint64_t padding = offset - rangeOffset;
+        if (padding > rangeSize || rangeSize - padding < size)
+            continue;
+
+        RemoveFreeRange(m_FreeByOffset.find(rangeOffset));
+        if (padding > 0)
+            AddFreeRange(rangeOffset, padding);
+        if (rangeSize - padding > size)
+            AddFreeRange(offset + size, rangeSize - padding - size);
+        m_Used += size;
+        return offset;
+    }
+    return INVALID_OFFSET;
+}
+
+void RangeAllocator::Free(uint64_t offset, uint64_t size)
+{
+    if (size == 0)
+        return;
+    if (offset > m_Capacity || size > m_Capacity - offset || size > m_Used)
+        throw std::runtime_error("RangeAllocator::Free: range outside the allocator");
+
+    m_Used -= size;
+
+    // Merge with the free ranges directly before and after
+    auto next = m_FreeByOffset.lower_bound(offset);
+    if (next != m_FreeByOffset.end() && next->first == offset + size)
+    {
+        size += next->second;
+        auto merged = next++;
+        RemoveFreeRange(merged);
+    }
+    if (next != m_FreeByOffset.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            size += previous->second;
+            RemoveFreeRange(previous);
+        }
+    }
+    AddFreeRange(offset, size);
+}
+
+void RangeAllocator::Grow(uint64_t capacity)
+{
+    if (capacity <= m_Capacity)
+        return;
+
+    const uint64_t tailOffset = m_Capacity, tailSize = capacity - m_Capacity;
+    m_Capacity = capacity;
+
+    // The tail is handed to Free() as if it had been allocated, which merges it with a free range ending at the old capacity
+    m_Used += tailSize;
+    Free(tailOffset, tailSize);
+}
+
+void RangeAllocator::AddFreeRange(uint64_t offset, uint64_t size)
+{
+    m_FreeByOffset.emplace(offset, size);
+    m_FreeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::RemoveFreeRange(std::map<uint64_t, uint64_t>::iterator range)
+{
+    m_FreeBySize.erase({ range->second, range->first });
+    m_FreeByOffset.erase(range);
+}
@@ -0,0 +1,128 @@
+#include "RenderQueue.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <future>
+
+static const int GEOMETRY_SHIFT = RenderQueue::DEPTH_BITS;
+static const int MATERIAL_SHIFT = GEOMETRY_SHIFT + RenderQueue::GEOMETRY_BITS;
+static const int SHADER_SHIFT = MATERIAL_SHIFT + RenderQueue::MATERIAL_BITS;
+static const int PASS_SHIFT = SHADER_SHIFT + RenderQueue::SHADER_BITS;
+static_assert(PASS_SHIFT + RenderQueue::PASS_BITS == 64, "Sort key fields must fill 64 bits");
+
+static uint64_t GetField(uint64_t key, int shift, int bits)
+{
+    return (key >> shift) & ((uint64_t(1) << bits) - 1);
+}
+
+// Runs body(chunk, begin, end) over [0, count) split into chunkCount chunks, on the pool when there is more than one
+static void ForEachChunk(ThreadPool* pool, size_t chunkCount, size_t count, const std::function<void(size_t, size_t, size_t)>& body)
+{
+    if (!pool || chunkCount < 2)
+    {
+        body(0, 0, count);
+        return;
+    }
+
+    const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    std::vector<std::future<void>> chunks;
+    for (size_t chunk = 0, begin = 0; begin < count; ++chunk, begin += chunkSize)
+    {
+        const size_t end = std::min(count, begin + chunkSize);
+        chunks.emplace_back(pool->Submit([&body, chunk, begin, end]() { body(chunk, begin, end); }));
+    }
+    for (auto& chunk : chunks)
+        chunk.get();
+}
+
+RenderQueue::RenderQueue(unsigned int threadCount)
+{
+    const unsigned int resolvedCount = ThreadPool::ResolveThreadCount(threadCount);
+    if (resolvedCount > 1)
+        m_Pool = std::make_unique<ThreadPool>(resolvedCount);
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+uint64_t RenderQueue::MakeKey(uint32_t pass, uint32_t shader, uint32_t material, uint32_t geometry, float depth)
+{
+    // The bits of a non-negative float order like the float itself, so its top bits quantize any depth range
+    uint32_t depthBits = 0;
+    if (depth > 0.0f)
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+    return (GetField(pass, 0, PASS_BITS) << PASS_SHIFT) |
+        (GetField(shader, 0, SHADER_BITS) << SHADER_SHIFT) |
+        (GetField(material, 0, MATERIAL_BITS) << MATERIAL_SHIFT) |
+        (GetField(geometry, 0, GEOMETRY_BITS) << GEOMETRY_SHIFT) |
+        (depthBits >> (32 - DEPTH_BITS));
+}
+
+void RenderQueue::Sort()
+{
+    const size_t count = m_Entries.size();
+    if (count < 2)
+        return;
+
+    const size_t chunkCount = m_Pool && count >= PARALLEL_THRESHOLD ? m_Pool->GetThreadCount() : 1;
+    m_Scratch.resize(count);
+    m_Offsets.resize(chunkCount);
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        for (auto& offsets : m_Offsets)
+            offsets.assign(256, 0);
+
+        ForEachChunk(m_Pool.get(), chunkCount, count, [this, shift](size_t chunk, size_t begin, size_t end)
+        {
+            std::vector<size_t>& histogram = m_Offsets[chunk];
+            for (size_t i = begin; i < end; ++i)
+                ++histogram[(m_Entries[i].m_Key >> shift) & 0xff];
+        });
+
+        // Digit-major, chunk-minor positions keep the sort stable. A byte every key shares leaves the order as it is.
+        bool sharedDigit = false;
+        size_t position = 0;
+        for (size_t digit = 0; digit < 256 && !sharedDigit; ++digit)
+        {
+            const size_t first = position;
+            for (auto& offsets : m_Offsets)
+            {
+                const size_t digitCount = offsets[digit];
+                offsets[digit] = position;
+                position += digitCount;
+            }
+            sharedDigit = position - first == count;
+        }
+        if (sharedDigit)
+            continue;
+
+        ForEachChunk(m_Pool.get(), chunkCount, count, [this, shift](size_t chunk, size_t begin, size_t end)
+        {
+            std::vector<size_t>& offsets = m_Offsets[chunk];
+            for (size_t i = begin; i < end; ++i)
+                m_Scratch[offsets[(m_Entries[i].m_Key >> shift) & 0xff]++] = m_Entries[i];
+        });
+        m_Entries.swap(m_Scratch);
+    }
+}
+
+RenderQueue::StateChanges RenderQueue::CountStateChanges() const
+{
+    StateChanges changes;
+    for (size_t i = 0; i < m_Entries.size(); ++i)
+    {
+        const uint64_t key = m_Entries[i].m_Key;
+        const bool first = i == 0;
+        const uint64_t previous = first ? 0 : m_Entries[i - 1].m_Key;
+        changes.m_Pass += first || GetField(key, PASS_SHIFT, PASS_BITS) != GetField(previous, PASS_SHIFT, PASS_BITS);
+        changes.m_Shader += first || GetField(key, SHADER_SHIFT, SHADER_BITS) != GetField(previous, SHADER_SHIFT, SHADER_BITS);
+        changes.m_Material += first || GetField(key, MATERIAL_SHIFT, MATERIAL_BITS) != GetField(previous, MATERIAL_SHIFT, MATERIAL_BITS);
+        changes.m_Geometry += first || GetField(key, GEOMETRY_SHIFT, GEOMETRY_BITS) != GetField(previous, GEOMETRY_SHIFT, GEOMETRY_BITS);
+    }
+    return changes;
+}
@@ -1,10 +1,21 @@
 #include "Renderer.h"
+#include "VertexFormat.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
+#include <functional>
+#include <limits>
+#include <numeric>
 
 Renderer::Renderer()
-    : m_ScreenWidth(0), m_ScreenHeight(0), m_GlfwWindow(nullptr), m_Shader(nullptr),
-    m_DeltaTime(0.0f), m_LastFrame(0.0f), m_LastX(0.0f), m_LastY(0.0f), m_FirstMouse(true)
+    : m_ScreenWidth(0), m_ScreenHeight(0), m_GlfwWindow(nullptr), m_ShaderDirectory("..\\..\\..\\..\\Shaders\\"), m_Shader(nullptr), m_SetupModelCount(0),
+    m_DeltaTime(0.0f), m_LastFrame(0.0f), m_LastX(0.0f), m_LastY(0.0f), m_FirstMouse(true),
+    m_UploadBudgetMs(4.0), m_LodErrorThreshold(1.0f), m_LodScale(1.0f), m_ViewProjection(1.0f),
+    m_FrustumCulling(true), m_NextInstanceId(0), m_OcclusionCulling(true), m_OccluderTriangleBudget(32768), m_OccluderMinRadius(32.0f),
+    m_SceneBvhDirty(true), m_ClusterCulling(true), m_IndirectDrawing(true), m_IndirectSupported(false),
+    m_GpuCulling(true), m_DrawSorting(true)
 {
     try
     {
@@ -17,7 +28,7 @@ Renderer::Renderer()
     }
 }
 
-void Renderer::CreateGLFWWindow(int width, int height)
+void Renderer::CreateGLFWWindow(int width, int height, bool visible)
 {
     try
     {
@@ -27,17 +38,24 @@ void Renderer::CreateGLFWWindow(int width, int height)
             throw std::runtime_error("Failed to initialize GLFW!");
         }
 
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
 
 #ifdef __APPLE__
         glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-        // Create GLFW Window
+        // Create GLFW Window. A 4.5 context enables indirect drawing; 3.3 is the minimum the renderer runs on.
         m_GlfwWindow = glfwCreateWindow(width, height, "Autumn 3D", nullptr, nullptr);
         if (m_GlfwWindow == nullptr)
+        {
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+            m_GlfwWindow = glfwCreateWindow(width, height, "Autumn 3D", nullptr, nullptr);
+        }
+        if (m_GlfwWindow == nullptr)
         {
             glfwTerminate();
             throw std::runtime_error("Failed to create GLFW Window");
@@ -48,11 +66,25 @@ void Renderer::CreateGLFWWindow(int width, int height)
         throw std::runtime_error("Error in CreateGLFWWindow: " + std::string(e.what()));
     }
 
-    m_ScreenWidth = width;
-    m_ScreenHeight = height;
+    // Rendering works in framebuffer pixels, which differ from window coordinates on high-DPI displays
+    glfwGetFramebufferSize(m_GlfwWindow, &m_ScreenWidth, &m_ScreenHeight);
 
-    m_LastX = m_ScreenWidth / 2.0f;
-    m_LastY = m_ScreenHeight / 2.0f;
+    m_LastX = width / 2.0f;
+    m_LastY = height / 2.0f;
+}
+
+// True if the current context exposes the named extension
+static bool HasGLExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const GLubyte* extension = glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i));
+        if (extension && std::strcmp(reinterpret_cast<const char*>(extension), name) == 0)
+            return true;
+    }
+    return false;
 }
 
 void Renderer::InitializeOpenGL()
@@ -81,10 +113,55 @@ void Renderer::InitializeOpenGL()
         }
 
         // Set OpenGL state
-        glEnable(GL_DEPTH_TEST);
+        m_StateCache.Enable(GL_DEPTH_TEST);
 
         // Setup the shaders
-        m_Shader = std::make_shared<Shader>("..\\..\\..\\..\\Shaders\\VertexShader.glsl", "..\\..\\..\\..\\Shaders\\FragmentShader.glsl");
+        m_Shader = std::make_shared<Shader>((m_ShaderDirectory + "VertexShader.glsl").c_str(), (m_ShaderDirectory + "FragmentShader.glsl").c_str());
+        m_ModelMatrixUniform = m_Shader->GetUniform<glm::mat4>("modelMatrix");
+        m_PackedVertexUniform = m_Shader->GetUniform<bool>("packedVertex");
+        m_PositionOffsetUniform = m_Shader->GetUniform<glm::vec3>("positionOffset");
+        m_PositionScaleUniform = m_Shader->GetUniform<glm::vec3>("positionScale");
+        m_ProjectionMatrixUniform = m_Shader->GetUniform<glm::mat4>("projectionMatrix");
+        m_ViewMatrixUniform = m_Shader->GetUniform<glm::mat4>("viewMatrix");
+
+        // Every submesh samples at most one base colour texture, bound to unit 0
+        if (m_Shader->GetUniformLocation("texture_diffuse1") == -1)
+            throw std::runtime_error("Shader uniform location not found: texture_diffuse1");
+        m_StateCache.UseProgram(m_Shader->ID);
+        m_Shader->SetInt("texture_diffuse1", 0);
+
+        // Indirect drawing reads per-draw data from a shader storage buffer indexed by gl_DrawID
+        m_IndirectSupported = GLAD_GL_VERSION_4_3 && HasGLExtension("GL_ARB_shader_draw_parameters");
+        if (m_IndirectSupported)
+        {
+            m_IndirectShader = std::make_shared<Shader>((m_ShaderDirectory + "IndirectVertexShader.glsl").c_str(), (m_ShaderDirectory + "FragmentShader.glsl").c_str());
+            m_IndirectProjectionMatrixUniform = m_IndirectShader->GetUniform<glm::mat4>("projectionMatrix");
+            m_IndirectViewMatrixUniform = m_IndirectShader->GetUniform<glm::mat4>("viewMatrix");
+            m_IndirectDrawOffsetUniform = m_IndirectShader->GetUniform<int>("drawOffset");
+            m_StateCache.UseProgram(m_IndirectShader->ID);
+            m_IndirectShader->SetInt("texture_diffuse1", 0);
+        }
+        std::cout << "OpenGL " << glGetString(GL_VERSION) << ", indirect drawing " << (m_IndirectSupported ? "supported" : "unsupported") << std::endl;
+
+        // GPU culling needs compute shaders; drawing only the surviving commands also needs an indirect draw count
+        if (m_IndirectSupported)
+        {
+            GpuCuller::DrawIndirectCountProc drawIndirectCount = nullptr;
+            if (GLAD_GL_VERSION_4_6)
+                drawIndirectCount = glMultiDrawElementsIndirectCount;
+            else if (HasGLExtension("GL_ARB_indirect_parameters"))
+                drawIndirectCount = reinterpret_cast<GpuCuller::DrawIndirectCountProc>(glfwGetProcAddress("glMultiDrawElementsIndirectCountARB"));
+
+            try
+            {
+                m_GpuCuller.Initialize((m_ShaderDirectory + "CullComputeShader.glsl").c_str(), (m_ShaderDirectory + "HiZComputeShader.glsl").c_str(), drawIndirectCount, m_StateCache);
+                std::cout << "GPU culling supported, " << (drawIndirectCount ? "with" : "without") << " indirect draw count" << std::endl;
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "GPU culling unavailable: " << e.what() << std::endl;
+            }
+        }
     }
     catch (const std::exception& e)
     {
@@ -92,12 +169,20 @@ void Renderer::InitializeOpenGL()
     }
 }
 
-void Renderer::Load3DModel(const std::string& modelPath)
+// Where models are placed in the world when they are loaded
+static glm::mat4 GetDefaultModelTransform()
+{
+    return glm::scale(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, 0.5f));
+}
+
+void Renderer::Load3DModel(const std::string& modelPath, const ModelImportSettings& settings)
 {
     try
     {
-        const auto& model = std::make_shared<Model>(modelPath);
+        const auto& model = std::make_shared<Model>(modelPath, false, settings);
+        model->SetRootTransform(GetDefaultModelTransform());
         m_Models.push_back(model);
+        m_SceneBvhDirty = true;
     }
     catch (const std::exception& e)
     {
@@ -105,6 +190,77 @@ void Renderer::Load3DModel(const std::string& modelPath)
     }
 }
 
+bool Renderer::Pick(const glm::vec3& origin, const glm::vec3& direction, PickResult& result)
+{
+    // Moved instances only refit the scene hierarchy; a new model rebuilds it
+    for (const auto& model : m_Models)
+        model->m_Transforms.Update();
+    if (m_SceneBvhDirty)
+    {
+        m_SceneBvh.Build(m_Models);
+        m_SceneBvhDirty = false;
+    }
+    else
+    {
+        m_SceneBvh.Refit();
+    }
+
+    SceneBvh::Hit hit;
+    if (!m_SceneBvh.Intersect(origin, direction, hit))
+        return false;
+
+    result.m_Model = m_Models[hit.m_Model];
+    result.m_Mesh = hit.m_Mesh;
+    result.m_Instance = hit.m_Instance;
+    result.m_Triangle = hit.m_Triangle;
+    result.m_Position = hit.m_Position;
+    result.m_Distance = hit.m_Distance;
+    return true;
+}
+
+bool Renderer::PickScreen(double x, double y, PickResult& result)
+{
+    // Cursor positions are in window coordinates, not framebuffer pixels
+    int windowWidth = 0, windowHeight = 0;
+    if (m_GlfwWindow)
+        glfwGetWindowSize(m_GlfwWindow, &windowWidth, &windowHeight);
+    if (windowWidth <= 0 || windowHeight <= 0)
+        return false;
+
+    // Unproject the window position on the near and far planes
+    const glm::mat4 inverseViewProjection = glm::inverse(m_ViewProjection);
+    const float ndcX = static_cast<float>(2.0 * x / windowWidth - 1.0);
+    const float ndcY = static_cast<float>(1.0 - 2.0 * y / windowHeight);
+    const glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    const glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    const glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    return Pick(origin, glm::vec3(farPoint) / farPoint.w - origin, result);
+}
+
+std::shared_ptr<ModelStream> Renderer::Load3DModelAsync(const std::string& modelPath, const ModelImportSettings& settings)
+{
+    const auto& stream = std::make_shared<ModelStream>(modelPath, settings, GetDefaultModelTransform());
+    m_Streams.push_back(stream);
+    return stream;
+}
+
+void Renderer::UnloadModels()
+{
+    for (const auto& model : m_Models)
+        FreeMeshes(model->m_Meshes);
+    for (const auto& stream : m_Streams)
+        FreeMeshes(stream->GetUploadedMeshes());
+
+    m_Models.clear();
+    m_Streams.clear();
+    m_SetupModelCount = 0;
+
+    // Nothing keeps its instance IDs, so they start over dense
+    m_InstanceIds.clear();
+    m_NextInstanceId = 0;
+    m_SceneBvhDirty = true;
+}
+
 void Renderer::Render()
 {
     try
@@ -112,16 +268,6 @@ void Renderer::Render()
         if (!m_GlfwWindow)
             throw std::runtime_error("GLFW window is not initialized.");
 
-        // Make sure to set up the meshes
-        for (const auto& model : m_Models)
-        {
-            for (const auto& mesh : model->m_Meshes)
-            {
-                SetupMesh(mesh);
-                LoadTextures(mesh);
-            }
-        }
-
         while (!glfwWindowShouldClose(m_GlfwWindow))
         {
             // Time calculation
@@ -129,32 +275,17 @@ void Renderer::Render()
             m_DeltaTime = currentFrame - m_LastFrame;
             m_LastFrame = currentFrame;
 
+            // A minimized window has a 0x0 framebuffer and nothing to draw into
+            if (m_ScreenWidth <= 0 || m_ScreenHeight <= 0)
+            {
+                glfwWaitEvents();
+                continue;
+            }
+
             // Handle input
             ProcessInput();
 
-            // Render
-            glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-            // Use the shader program
-            m_Shader->UseProgram();
-
-            // Set view and projection matrices
-            glm::mat4 projection = glm::perspective(glm::radians(m_Camera->m_Zoom),
-                (float)m_ScreenWidth / (float)m_ScreenHeight,
-                0.1f, 100.0f);
-            glm::mat4 view = m_Camera->GetViewMatrix();
-            m_Shader->SetMat4("projectionMatrix", projection);
-            m_Shader->SetMat4("viewMatrix", view);
-
-            for (const auto& model : m_Models)
-            {
-                glm::mat4 modelMatrix = glm::mat4(1.0f);
-                modelMatrix = glm::translate(modelMatrix, glm::vec3(0.0f, 0.0f, 0.0f));
-                modelMatrix = glm::scale(modelMatrix, glm::vec3(0.5f, 0.5f, 0.5f));
-                m_Shader->SetMat4("modelMatrix", modelMatrix);
-                DrawModel(model);
-            }
+            RenderFrame();
 
             glfwSwapBuffers(m_GlfwWindow);
             glfwPollEvents();
@@ -168,6 +299,115 @@ void Renderer::Render()
     }
 }
 
+void Renderer::RenderFrame()
+{
+    SetupModels();
+
+    m_LastStateStats = m_StateCache.GetStats();
+    m_StateCache.ResetStats();
+
+    // Upload whatever the background loaders finished since the last frame
+    UploadStreamedMeshes();
+
+    // GPU culling renders into its own framebuffer so the Hi-Z pyramid can be built from the depth
+    const bool gpuCulling = IsGpuCullingActive();
+    if (gpuCulling)
+        m_GpuCuller.BeginFrame(m_ScreenWidth, m_ScreenHeight, m_StateCache);
+
+    // Render
+    glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Use the shader program
+    const bool indirect = IsIndirectDrawingActive();
+    const std::shared_ptr<Shader>& shader = indirect ? m_IndirectShader : m_Shader;
+    m_StateCache.UseProgram(shader->ID);
+
+    // Set view and projection matrices
+    glm::mat4 projection = glm::perspective(glm::radians(m_Camera->m_Zoom),
+        (float)m_ScreenWidth / (float)m_ScreenHeight,
+        0.1f, 100.0f);
+    glm::mat4 view = m_Camera->GetViewMatrix();
+    shader->Set(indirect ? m_IndirectProjectionMatrixUniform : m_ProjectionMatrixUniform, projection);
+    shader->Set(indirect ? m_IndirectViewMatrixUniform : m_ViewMatrixUniform, view);
+
+    // Pixels covered by one world unit at a distance of one unit, for LOD selection
+    m_LodScale = m_ScreenHeight / (2.0f * std::tan(glm::radians(m_Camera->m_Zoom) * 0.5f));
+    m_ViewProjection = projection * view;
+
+    m_LastClusterStats = m_ClusterStats;
+    m_ClusterStats = ClusterCullStats();
+    m_LastInstanceStats = m_InstanceStats;
+    m_InstanceStats = InstanceCullStats();
+    m_LastDrawOrderStats = m_DrawOrderStats;
+    m_DrawOrderStats = DrawOrderStats();
+
+    m_DrawItems.clear();
+    m_FrustumCuller.Clear();
+    m_FrustumCuller.SetViewProjection(m_ViewProjection);
+
+    // Only the subtrees whose transforms changed since the last frame are recomputed
+    for (const auto& model : m_Models)
+    {
+        model->m_Transforms.Update();
+        const uint32_t firstId = GetInstanceIdBase(model.get(), model->m_Instances.size());
+        for (size_t i = 0; i < model->m_Instances.size(); ++i)
+        {
+            const Model::MeshInstance& instance = model->m_Instances[i];
+            AddDrawItem(model->m_Meshes[instance.m_Mesh], model->m_Transforms.GetWorld(instance.m_Node), firstId + static_cast<uint32_t>(i));
+        }
+    }
+
+    // Models still streaming in draw the meshes uploaded so far at every node that instances them
+    for (const auto& stream : m_Streams)
+    {
+        if (!stream->HasNodes())
+            continue;
+
+        TransformHierarchy& transforms = stream->GetTransforms();
+        transforms.Update();
+        const auto& meshes = stream->GetUploadedMeshes();
+        const auto& instances = stream->GetInstances();
+        const uint32_t firstId = GetInstanceIdBase(stream.get(), instances.size());
+        for (size_t i = 0; i < instances.size(); ++i)
+        {
+            if (instances[i].m_Mesh < meshes.size())
+                AddDrawItem(meshes[instances[i].m_Mesh], transforms.GetWorld(instances[i].m_Node), firstId + static_cast<uint32_t>(i));
+        }
+    }
+
+    DrawVisibleItems();
+
+    if (gpuCulling)
+        m_GpuCuller.EndFrame();
+}
+
+void Renderer::SetupModels()
+{
+    if (m_SetupModelCount == m_Models.size())
+        return;
+
+    for (size_t i = m_SetupModelCount; i < m_Models.size(); ++i)
+    {
+        const auto& model = m_Models[i];
+        for (const auto& mesh : model->m_Meshes)
+        {
+            if (mesh->m_GpuGeometry.m_VAO != 0)
+                continue;
+            SetupMesh(mesh);
+            LoadTextures(mesh);
+        }
+
+        if (model->m_ImportSettings.m_Residency == MeshResidency::ReleaseAfterUpload)
+            model->ReleaseCpuData();
+    }
+    m_SetupModelCount = m_Models.size();
+    m_StateCache.Invalidate();
+    std::cout << "Textures: " << m_TextureCache.GetUploadCount() << " uploaded, " << m_TextureCache.GetHitCount() << " shared" << std::endl;
+    std::cout << "Geometry: " << m_GeometryArena.GetPageCount() << " arena pages, " << m_GeometryArena.GetUsed() / 1024 << " of "
+        << m_GeometryArena.GetCapacity() / 1024 << " KB used" << std::endl;
+}
+
 void Renderer::ProcessInput()
 {
     try
@@ -194,48 +434,40 @@ void Renderer::SetupMesh(const std::shared_ptr<Model::Mesh>& mesh)
 {
     try
     {
-        // Generate buffers and array objects
-        glGenVertexArrays(1, &mesh->m_VAO);
-        glGenBuffers(1, &mesh->m_VBO);
-        glGenBuffers(1, &mesh->m_EBO);
-
-        if (!mesh->m_VAO || !mesh->m_VBO || !mesh->m_EBO)
-            throw std::runtime_error("Failed to generate OpenGL buffers or VAO.");
-
-        // Bind VAO
-        glBindVertexArray(mesh->m_VAO);
-
-        // Load vertex data into buffers
-        glBindBuffer(GL_ARRAY_BUFFER, mesh->m_VBO);
-        glBufferData(GL_ARRAY_BUFFER, mesh->m_Vertices.size() * sizeof(Model::Mesh::Vertex), &mesh->m_Vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->m_EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->m_Indices.size() * sizeof(unsigned int), &mesh->m_Indices[0], GL_STATIC_DRAW);
-
-        // Set vertex attribute pointers
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Model::Mesh::Vertex), (void*)0); // m_Position
-
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Model::Mesh::Vertex), (void*)offsetof(Model::Mesh::Vertex, m_Normal)); // m_Normal
-
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Model::Mesh::Vertex), (void*)offsetof(Model::Mesh::Vertex, m_TexCoords)); // Texture coords
-
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Model::Mesh::Vertex), (void*)offsetof(Model::Mesh::Vertex, m_Tangent)); // m_Tangent
-
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Model::Mesh::Vertex), (void*)offsetof(Model::Mesh::Vertex, m_Bitangent)); // m_Bitangent
-
-        glEnableVertexAttribArray(5);
-        glVertexAttribIPointer(5, 4, GL_INT, sizeof(Model::Mesh::Vertex), (void*)offsetof(Model::Mesh::Vertex, m_BoneIDs)); // Bone IDs
+        if (!mesh->HasCpuData())
+            throw std::runtime_error("The mesh data was released; call Model::RestoreCpuData() before uploading it again.");
+
+        // Vertex data in the upload layout. Cooked meshes are stored packed and upload the mapped cache bytes as-is.
+        const size_t vertexCount = mesh->GetVertexCount();
+        const void* vertexData = mesh->IsCooked() ? mesh->m_Cooked.m_Vertices : mesh->m_Vertices.data();
+        size_t vertexSize = vertexCount * VertexFormat::GetStride(mesh->m_VertexLayout);
+        std::vector<unsigned char> packed;
+        if (!mesh->IsCooked() && mesh->m_VertexLayout != VertexLayout::Full)
+        {
+            // Compact layouts quantize positions to the mesh bounds
+            VertexFormat::Pack(mesh->m_Vertices.data(), vertexCount, mesh->m_VertexLayout, mesh->m_Bounds.m_Min, mesh->m_Bounds.m_Max, packed);
+            vertexData = packed.data();
+            vertexSize = packed.size();
+        }
 
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Model::Mesh::Vertex), (void*)offsetof(Model::Mesh::Vertex, m_Weights)); // Weights
+        // Index data in the GPU index type
+        const size_t indexSize = mesh->m_IndexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+        const void* indexData = mesh->m_Indices.data();
+        std::vector<unsigned short> indices16;
+        if (mesh->IsCooked())
+        {
+            // The cache already stores indices in the GPU index type
+            indexData = mesh->m_Cooked.m_Indices;
+        }
+        else if (mesh->m_IndexType == GL_UNSIGNED_SHORT)
+        {
+            // Meshes imported from 8/16-bit index accessors keep 16-bit indices on the GPU
+            indices16.assign(mesh->m_Indices.begin(), mesh->m_Indices.end());
+            indexData = indices16.data();
+        }
 
-        // Unbind VAO
-        glBindVertexArray(0);
+        // Every mesh is a pair of ranges in the shared arena buffers of its vertex layout
+        m_GeometryArena.Upload(*mesh, vertexData, vertexSize, indexData, mesh->GetIndexCount() * indexSize);
     }
     catch (const std::exception& e)
     {
@@ -244,41 +476,87 @@ void Renderer::SetupMesh(const std::shared_ptr<Model::Mesh>& mesh)
     }
 }
 
-void Renderer::DrawMesh(const std::shared_ptr<Model::Mesh>& mesh)
+void Renderer::FreeMeshes(const std::vector<std::shared_ptr<Model::Mesh>>& meshes)
 {
-    try
+    // Null entries are streamed meshes not uploaded yet; meshes without a VAO hold no ranges
+    for (const auto& mesh : meshes)
     {
-        unsigned int diffuseNr = 0, specularNr = 0, normalNr = 0, heightNr = 0;
+        if (mesh)
+            m_GeometryArena.Free(*mesh);
+    }
+}
 
-        // Bind appropriate textures
-        for (unsigned int i = 0; i < mesh->m_TexturesLoaded.size(); ++i)
+void Renderer::DrawMesh(const std::shared_ptr<Model::Mesh>& mesh, const glm::mat4& modelMatrix)
+{
+    try
+    {
+        // Compact layouts store positions relative to the mesh bounds
+        const bool packed = mesh->m_VertexLayout != VertexLayout::Full;
+        const glm::vec3 positionOffset = packed ? mesh->m_Bounds.m_Min : glm::vec3(0.0f);
+        const glm::vec3 positionScale = packed ? mesh->m_Bounds.m_Max - mesh->m_Bounds.m_Min : glm::vec3(1.0f);
+
+        // Indirect drawing only records the draws; IndirectDrawList::Submit() issues them for the whole frame
+        const bool indirect = IsIndirectDrawingActive();
+        uint32_t indirectInstance = 0;
+        if (indirect)
+        {
+            indirectInstance = m_IndirectDrawList.AddInstance(modelMatrix, positionOffset, positionScale, packed);
+        }
+        else
         {
-            glActiveTexture(GL_TEXTURE0 + i);
-            std::string number;
-            const std::string& name = mesh->m_TexturesLoaded[i]->m_TextureType;
-
-            // Assign texture unit number based on texture type
-            if (name == "texture_diffuse") number = std::to_string(++diffuseNr);
-            else if (name == "texture_specular") number = std::to_string(1);
-            else if (name == "texture_normal") number = std::to_string(1);
-            else if (name == "texture_height") number = std::to_string(1);
-
-            // Set the sampler to the correct texture unit
-            int location = glGetUniformLocation(m_Shader->ID, (name + number).c_str());
-            if (location == -1)
-                throw std::runtime_error("Shader uniform location not found: " + name + number);
-
-            glUniform1i(location, i);
-            glBindTexture(GL_TEXTURE_2D, mesh->m_TexturesLoaded[i]->m_TextureID);
+            m_Shader->Set(m_ModelMatrixUniform, modelMatrix);
+            m_Shader->Set(m_PackedVertexUniform, packed);
+            m_Shader->Set(m_PositionOffsetUniform, positionOffset);
+            m_Shader->Set(m_PositionScaleUniform, positionScale);
         }
 
-        // Draw mesh
-        glBindVertexArray(mesh->m_VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(mesh->m_Indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        const float pixelsPerUnit = GetLodPixelsPerUnit(*mesh, modelMatrix);
+        const bool cullClusters = m_ClusterCulling && mesh->m_Meshlets.m_Count > 0;
+        if (cullClusters)
+            PrepareClusterCulling(modelMatrix);
+
+        // Meshes of one arena page share a VAO, so the cache only rebinds it when the page changes
+        if (!indirect)
+            m_StateCache.BindVertexArray(mesh->m_GpuGeometry.m_VAO);
+
+        // Submeshes are ordered by texture, so every run of submeshes sharing a texture is drawn with one call
+        const auto& submeshes = mesh->m_Submeshes;
+        for (size_t first = 0, last = 0; first < submeshes.size(); first = last)
+        {
+            const int texture = submeshes[first].m_Texture;
+            m_DrawCounts.clear();
+            m_DrawOffsets.clear();
+            m_DrawBaseVertices.clear();
+
+            for (last = first; last < submeshes.size() && submeshes[last].m_Texture == texture; ++last)
+            {
+                const Model::Mesh::Submesh& submesh = submeshes[last];
+                const size_t lod = SelectLod(submesh, pixelsPerUnit);
+
+                // Full detail draws only the meshlets that survive culling
+                if (lod == 0 && cullClusters && submesh.m_MeshletCount > 0)
+                    CullMeshlets(*mesh, submesh);
+                else if (lod < submesh.m_Lods.size())
+                    AddDrawRange(*mesh, submesh.m_Lods[lod].m_FirstIndex, submesh.m_Lods[lod].m_IndexCount, submesh.m_BaseVertex);
+            }
 
-        // Reset active texture
-        glActiveTexture(GL_TEXTURE0);
+            if (m_DrawCounts.empty())
+                continue;
+
+            const bool hasTexture = texture >= 0 && static_cast<size_t>(texture) < mesh->m_TexturesLoaded.size();
+            const unsigned int textureID = hasTexture ? mesh->m_TexturesLoaded[texture]->m_TextureID : 0;
+            if (indirect)
+            {
+                for (size_t i = 0; i < m_DrawCounts.size(); ++i)
+                    m_IndirectDrawList.AddDraw(mesh->m_GpuGeometry.m_VAO, mesh->m_IndexType, textureID, indirectInstance,
+                        static_cast<uint32_t>(m_DrawCounts[i]), reinterpret_cast<size_t>(m_DrawOffsets[i]), m_DrawBaseVertices[i]);
+                continue;
+            }
+
+            m_StateCache.BindTexture(0, GL_TEXTURE_2D, textureID);
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_DrawCounts.data(), mesh->m_IndexType, m_DrawOffsets.data(),
+                static_cast<GLsizei>(m_DrawCounts.size()), m_DrawBaseVertices.data());
+        }
     }
     catch (const std::exception& e)
     {
@@ -287,40 +565,346 @@ void Renderer::DrawMesh(const std::shared_ptr<Model::Mesh>& mesh)
     }
 }
 
+void Renderer::AddDrawRange(const Model::Mesh& mesh, size_t firstIndex, size_t indexCount, size_t baseVertex)
+{
+    // Offsets and base vertices are relative to the mesh's ranges in the shared arena buffers
+    const size_t indexSize = mesh.m_IndexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    const size_t offset = static_cast<size_t>(mesh.m_GpuGeometry.m_IndexOffset) + firstIndex * indexSize;
+    baseVertex += mesh.m_GpuGeometry.m_BaseVertex;
+    if (!m_DrawCounts.empty() && m_DrawBaseVertices.back() == static_cast<GLint>(baseVertex) &&
+        reinterpret_cast<size_t>(m_DrawOffsets.back()) + m_DrawCounts.back() * indexSize == offset)
+    {
+        m_DrawCounts.back() += static_cast<GLsizei>(indexCount);
+        return;
+    }
+
+    m_DrawCounts.push_back(static_cast<GLsizei>(indexCount));
+    m_DrawOffsets.push_back(reinterpret_cast<const void*>(offset));
+    m_DrawBaseVertices.push_back(static_cast<GLint>(baseVertex));
+}
+
 void Renderer::LoadTextures(const shared_ptr<Model::Mesh>& mesh)
 {
-    for (const auto& textureImage : mesh->m_TextureImages)
+    // Cooked meshes upload pixels straight from the mapped cache
+    std::vector<TextureCache::TextureSource> sources = mesh->m_Cooked.m_Textures;
+    if (!mesh->IsCooked())
     {
-        auto texture = std::make_shared<Model::Mesh::Texture>();
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
+        for (const auto& textureImage : mesh->m_TextureImages)
+            sources.push_back({ textureImage->m_Pixels.data(), textureImage->m_Width, textureImage->m_Height, textureImage->m_Components, textureImage->m_ContentHash });
+    }
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureImage.width, textureImage.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureImage.image.data());
-        glGenerateMipmap(GL_TEXTURE_2D);
+    // Images already uploaded for another mesh or model are shared instead of uploaded again
+    for (const auto& source : sources)
+        mesh->m_TexturesLoaded.emplace_back(m_TextureCache.Acquire(source, "texture_diffuse"));
+}
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+void Renderer::AddDrawItem(const std::shared_ptr<Model::Mesh>& mesh, const glm::mat4& worldMatrix, uint32_t id)
+{
+    // Skip meshes that have not been uploaded yet or have nothing to draw
+    if (!mesh || !mesh->m_GpuGeometry.m_VAO || mesh->m_Bounds.IsEmpty())
+        return;
+
+    m_DrawItems.push_back({ &mesh, &worldMatrix, mesh->m_Bounds.Transform(worldMatrix), id });
+    m_FrustumCuller.AddBox(m_DrawItems.back().m_Bounds);
+}
 
-        texture->m_TextureID = textureID;
-        texture->m_TextureType = "texture_diffuse";
-        mesh->m_TexturesLoaded.emplace_back(texture);
+uint32_t Renderer::GetInstanceIdBase(const void* owner, size_t count)
+{
+    InstanceIdRange& range = m_InstanceIds[owner];
+    if (count > range.m_Count)
+    {
+        range.m_First = m_NextInstanceId;
+        range.m_Count = count;
+        m_NextInstanceId += static_cast<uint32_t>(count);
     }
+    return range.m_First;
 }
 
-void Renderer::DrawModel(const std::shared_ptr<Model>& model)
+void Renderer::DrawVisibleItems()
 {
-    for (auto& mesh : model->m_Meshes) {
+    // GPU culling tests every item itself
+    const bool gpuCulling = IsGpuCullingActive();
+
+    m_VisibleItems.clear();
+    if (m_FrustumCulling && !gpuCulling)
+    {
+        m_FrustumCuller.Cull(m_VisibleItems);
+    }
+    else
+    {
+        m_VisibleItems.resize(m_DrawItems.size());
+        std::iota(m_VisibleItems.begin(), m_VisibleItems.end(), 0u);
+    }
+    m_InstanceStats.m_InstancesTested += m_DrawItems.size();
+    m_InstanceStats.m_InstancesFrustumCulled += m_DrawItems.size() - m_VisibleItems.size();
+
+    if (m_OcclusionCulling && !gpuCulling)
+        CullOccluded();
+
+    // Items sharing a shader, texture and arena page are drawn together, front to back within each group
+    const unsigned int shader = IsIndirectDrawingActive() ? m_IndirectShader->ID : m_Shader->ID;
+    m_RenderQueue.Clear();
+    for (const uint32_t index : m_VisibleItems)
+        m_RenderQueue.Add(MakeSortKey(m_DrawItems[index], shader), index);
+    m_DrawOrderStats.m_Items = m_RenderQueue.GetSize();
+    m_DrawOrderStats.m_Unsorted = m_RenderQueue.CountStateChanges();
+    if (m_DrawSorting)
+        m_RenderQueue.Sort();
+    m_DrawOrderStats.m_Sorted = m_RenderQueue.CountStateChanges();
+
+    m_IndirectDrawList.Clear();
+    m_GpuCuller.Clear();
+    for (size_t i = 0; i < m_RenderQueue.GetSize(); ++i)
+    {
+        const DrawItem& item = m_DrawItems[m_RenderQueue.GetItem(i)];
         try
         {
-            DrawMesh(mesh);
+            // One culler instance per IndirectDrawList instance, which DrawMesh() adds first
+            if (gpuCulling)
+                m_GpuCuller.AddInstance(item.m_Bounds, item.m_Id);
+            DrawMesh(*item.m_Mesh, *item.m_World);
         }
         catch (const std::exception& e) {
             std::cerr << "Error drawing mesh: " << e.what() << std::endl;
         }
     }
+    if (IsIndirectDrawingActive())
+    {
+        try
+        {
+            if (gpuCulling)
+                m_GpuCuller.Draw(m_IndirectDrawList, m_ViewProjection, *m_IndirectShader, m_IndirectDrawOffsetUniform, m_StateCache);
+            else
+                m_IndirectDrawList.Submit(*m_IndirectShader, m_IndirectDrawOffsetUniform, m_StateCache);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error submitting indirect draws: " << e.what() << std::endl;
+        }
+    }
+}
+
+uint64_t Renderer::MakeSortKey(const DrawItem& item, unsigned int shader) const
+{
+    const Model::Mesh& mesh = **item.m_Mesh;
+
+    // A mesh is keyed by the texture of its first submesh; its submeshes are ordered by texture already
+    unsigned int texture = 0;
+    if (!mesh.m_Submeshes.empty())
+    {
+        const int index = mesh.m_Submeshes.front().m_Texture;
+        if (index >= 0 && static_cast<size_t>(index) < mesh.m_TexturesLoaded.size())
+            texture = mesh.m_TexturesLoaded[index]->m_TextureID;
+    }
+
+    // Clip-space w is the distance along the view direction
+    const float depth = (m_ViewProjection * glm::vec4(item.m_Bounds.GetCenter(), 1.0f)).w;
+    return RenderQueue::MakeKey(0, shader, texture, mesh.m_GpuGeometry.m_VAO, depth);
+}
+
+void Renderer::CullOccluded()
+{
+    // The meshes covering the most of the screen are the best occluders
+    m_OccluderCandidates.clear();
+    for (const uint32_t index : m_VisibleItems)
+    {
+        const DrawItem& item = m_DrawItems[index];
+        if ((*item.m_Mesh)->m_Occluder.m_Indices.empty())
+            continue;
+
+        const float distance = glm::length(item.m_Bounds.GetCenter() - m_Camera->m_Position);
+        const float screenRadius = distance > item.m_Bounds.m_Radius ? item.m_Bounds.m_Radius * m_LodScale / distance : std::numeric_limits<float>::max();
+        if (screenRadius >= m_OccluderMinRadius)
+            m_OccluderCandidates.emplace_back(screenRadius, index);
+    }
+    if (m_OccluderCandidates.empty())
+        return;
+    std::sort(m_OccluderCandidates.begin(), m_OccluderCandidates.end(), std::greater<std::pair<float, uint32_t>>());
+
+    // A low resolution buffer with the screen's aspect ratio
+    const int width = 256;
+    m_OcclusionCuller.SetResolution(width, std::max(1, width * m_ScreenHeight / std::max(m_ScreenWidth, 1)));
+    m_OcclusionCuller.BeginFrame(m_ViewProjection);
+
+    m_IsOccluder.assign(m_DrawItems.size(), 0);
+    size_t triangles = 0;
+    for (const auto& candidate : m_OccluderCandidates)
+    {
+        const DrawItem& item = m_DrawItems[candidate.second];
+        const Model::Mesh::Occluder& occluder = (*item.m_Mesh)->m_Occluder;
+        if (triangles > 0 && triangles + occluder.m_Indices.size() / 3 > m_OccluderTriangleBudget)
+            continue;
+
+        m_OcclusionCuller.AddOccluder(occluder.m_Positions.data(), occluder.m_Positions.size(), occluder.m_Indices.data(), occluder.m_Indices.size(), *item.m_World);
+        m_IsOccluder[candidate.second] = 1;
+        triangles += occluder.m_Indices.size() / 3;
+        ++m_InstanceStats.m_Occluders;
+    }
+    m_InstanceStats.m_OccluderTriangles += triangles;
+    m_OcclusionCuller.Rasterize();
+
+    // Occluders are drawn regardless; their boxes would only test against their own depth
+    const size_t visibleCount = m_VisibleItems.size();
+    m_VisibleItems.erase(std::remove_if(m_VisibleItems.begin(), m_VisibleItems.end(), [this](uint32_t index)
+    {
+        return !m_IsOccluder[index] && !m_OcclusionCuller.IsVisible(m_DrawItems[index].m_Bounds);
+    }), m_VisibleItems.end());
+    m_InstanceStats.m_InstancesOcclusionCulled += visibleCount - m_VisibleItems.size();
+}
+
+float Renderer::GetLodPixelsPerUnit(const Model::Mesh& mesh, const glm::mat4& modelMatrix) const
+{
+    // World-space bounding sphere; the largest axis scale bounds how much the model matrix stretches the error
+    const float scale = std::max(glm::length(glm::vec3(modelMatrix[0])), std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    const glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(mesh.m_Bounds.GetCenter(), 1.0f));
+    const float radius = mesh.m_Bounds.m_Radius * scale;
+
+    // Inside the bounds any error can fill the screen
+    const float distance = glm::length(center - m_Camera->m_Position) - radius;
+    if (distance <= 0.0f)
+        return std::numeric_limits<float>::max();
+    return scale * m_LodScale / distance;
+}
+
+size_t Renderer::SelectLod(const Model::Mesh::Submesh& submesh, float pixelsPerUnit) const
+{
+    // Take the coarsest level whose error projects to no more than the threshold
+    size_t lod = 0;
+    while (lod + 1 < submesh.m_Lods.size() && submesh.m_Lods[lod + 1].m_Error * pixelsPerUnit <= m_LodErrorThreshold)
+        ++lod;
+    return lod;
+}
+
+void Renderer::PrepareClusterCulling(const glm::mat4& modelMatrix)
+{
+    // Frustum planes (Gribb & Hartmann) and the camera in object space, so the meshlet bounds are tested as stored.
+    // The cone test assumes the model matrix scales uniformly.
+    FrustumCuller::ExtractPlanes(m_ViewProjection * modelMatrix, m_CullPlanes);
+    m_CullCamera = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(m_Camera->m_Position, 1.0f));
+}
+
+void Renderer::CullMeshlets(const Model::Mesh& mesh, const Model::Mesh::Submesh& submesh)
+{
+    using Meshlets = Model::Mesh::Meshlets;
+    const Meshlets& meshlets = mesh.m_Meshlets;
+
+    const float* centerX = meshlets.GetStream(Meshlets::CenterX);
+    const float* centerY = meshlets.GetStream(Meshlets::CenterY);
+    const float* centerZ = meshlets.GetStream(Meshlets::CenterZ);
+    const float* radii = meshlets.GetStream(Meshlets::Radius);
+    const float* axisX = meshlets.GetStream(Meshlets::ConeAxisX);
+    const float* axisY = meshlets.GetStream(Meshlets::ConeAxisY);
+    const float* axisZ = meshlets.GetStream(Meshlets::ConeAxisZ);
+    const float* cutoffs = meshlets.GetStream(Meshlets::ConeCutoff);
+
+    const size_t lastMeshlet = submesh.m_FirstMeshlet + submesh.m_MeshletCount;
+    for (size_t i = submesh.m_FirstMeshlet; i < lastMeshlet; ++i)
+    {
+        const glm::vec3 center(centerX[i], centerY[i], centerZ[i]);
+        const uint32_t triangleCount = meshlets.m_TriangleCount[i];
+        m_ClusterStats.m_TrianglesTested += triangleCount;
+
+        bool outside = false;
+        for (const glm::vec4& plane : m_CullPlanes)
+            outside |= glm::dot(glm::vec3(plane), center) + plane.w < -radii[i];
+        if (outside)
+        {
+            ++m_ClusterStats.m_ClustersFrustumCulled;
+            m_ClusterStats.m_TrianglesCulled += triangleCount;
+            continue;
+        }
+
+        // The whole cone faces away when the camera lies inside the cone's back-facing region (Shirman & Abi-Ezzi)
+        const glm::vec3 view = center - m_CullCamera;
+        if (glm::dot(view, glm::vec3(axisX[i], axisY[i], axisZ[i])) >= cutoffs[i] * glm::length(view) + radii[i])
+        {
+            ++m_ClusterStats.m_ClustersBackfaceCulled;
+            m_ClusterStats.m_TrianglesCulled += triangleCount;
+            continue;
+        }
+
+        AddDrawRange(mesh, size_t(meshlets.m_FirstTriangle[i]) * 3, size_t(triangleCount) * 3, submesh.m_BaseVertex);
+    }
+    m_ClusterStats.m_ClustersTested += submesh.m_MeshletCount;
+}
+
+void Renderer::UploadStreamedMeshes()
+{
+    const auto start = std::chrono::steady_clock::now();
+    auto budgetLeft = [this, &start]()
+    {
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() < m_UploadBudgetMs;
+    };
+
+    for (auto it = m_Streams.begin(); it != m_Streams.end();)
+    {
+        const auto& stream = *it;
+
+        // At least one mesh per frame is uploaded so a tight budget still makes progress
+        size_t meshIndex = 0;
+        std::shared_ptr<Model::Mesh> mesh;
+        bool uploadedAny = false;
+        while ((!uploadedAny || budgetLeft()) && stream->PopDecodedMesh(meshIndex, mesh))
+        {
+            try
+            {
+                SetupMesh(mesh);
+                LoadTextures(mesh);
+                stream->AddUploadedMesh(meshIndex, mesh);
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "Failed to upload a streamed mesh of " << stream->GetPath() << ": " << e.what() << std::endl;
+                m_GeometryArena.Free(*mesh);
+                stream->SkipMesh();
+            }
+            uploadedAny = true;
+        }
+
+        // Uploads bind buffers, vertex arrays and textures behind the state cache's back
+        if (uploadedAny)
+            m_StateCache.Invalidate();
+
+        if (stream->HasFailed())
+        {
+            std::cerr << "Failed to load 3D model from path: " << stream->GetPath() << ". Error: " << stream->GetError() << std::endl;
+            FreeMeshes(stream->GetUploadedMeshes());
+            m_InstanceIds.erase(stream.get());
+            it = m_Streams.erase(it);
+        }
+        else if (stream->IsReady())
+        {
+            std::cout << "Finished streaming " << stream->GetPath() << " (" << stream->GetUploadedMeshCount() << " meshes, "
+                << m_TextureCache.GetUploadCount() << " textures uploaded, " << m_TextureCache.GetHitCount() << " shared)" << std::endl;
+            // The import has finished with the meshes, so their CPU copies can go now
+            const auto& model = stream->GetModel();
+            if (stream->GetSettings().m_Residency == MeshResidency::ReleaseAfterUpload)
+                model->ReleaseCpuData();
+            model->SetRootTransform(stream->GetRootTransform());
+
+            // The model keeps the stream's instance IDs, so last frame's GPU visibility still applies to it
+            const auto ids = m_InstanceIds.find(stream.get());
+            if (ids != m_InstanceIds.end())
+            {
+                m_InstanceIds[model.get()] = ids->second;
+                m_InstanceIds.erase(ids);
+            }
+
+            // Its meshes are uploaded already; RenderFrame() set up every earlier model before the streams ran
+            m_Models.push_back(model);
+            if (m_SetupModelCount + 1 == m_Models.size())
+                ++m_SetupModelCount;
+            m_SceneBvhDirty = true;
+            it = m_Streams.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+
+        if (!budgetLeft())
+            break;
+    }
 }
 
 // Static callback functions
@@ -328,6 +912,13 @@ void Renderer::FrameBufferSizeCallback(GLFWwindow* m_GlfwWindow, int width, int
 {
     try
     {
+        // The projection, the occlusion culler and the GPU culling framebuffer follow the new size from the next frame on
+        Renderer* renderer = static_cast<Renderer*>(glfwGetWindowUserPointer(m_GlfwWindow));
+        if (renderer)
+        {
+            renderer->m_ScreenWidth = width;
+            renderer->m_ScreenHeight = height;
+        }
         glViewport(0, 0, width, height);
     }
     catch (const std::exception& e)
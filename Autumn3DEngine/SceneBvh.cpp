@@ -0,0 +1,154 @@
+#include "SceneBvh.h"
+#include "MeshBvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Instances per leaf; each one costs a matrix inverse and a mesh traversal, so leaves stay small
+static const size_t INSTANCES_PER_LEAF = 2;
+
+void SceneBvh::Build(const std::vector<std::shared_ptr<Model>>& models)
+{
+    Clear();
+    m_Models = models;
+
+    std::vector<Instance> instances;
+    std::vector<glm::vec3> boxMin, boxMax;
+    for (size_t m = 0; m < m_Models.size(); ++m)
+    {
+        const Model& model = *m_Models[m];
+        for (size_t i = 0; i < model.m_Instances.size(); ++i)
+        {
+            const Model::MeshInstance& instance = model.m_Instances[i];
+            const Bounds& bounds = model.m_Transforms.GetWorldBounds(instance.m_Node);
+            if (model.m_Meshes[instance.m_Mesh]->m_Bvh.m_Nodes.empty() || bounds.IsEmpty())
+                continue;
+
+            instances.push_back({ static_cast<uint32_t>(m), static_cast<uint32_t>(i) });
+            boxMin.push_back(bounds.m_Min);
+            boxMax.push_back(bounds.m_Max);
+        }
+    }
+
+    std::vector<uint32_t> order;
+    BvhBuilder::Build(boxMin, boxMax, INSTANCES_PER_LEAF, nullptr, m_Nodes, order);
+    m_Instances.reserve(order.size());
+    for (const uint32_t i : order)
+        m_Instances.push_back(instances[i]);
+}
+
+void SceneBvh::Refit()
+{
+    // Children always follow their parent, so a reverse sweep sees them first
+    for (size_t n = m_Nodes.size(); n-- > 0;)
+    {
+        BvhBuilder::Node& node = m_Nodes[n];
+        if (node.IsLeaf())
+        {
+            Bounds leafBounds;
+            for (size_t i = node.m_First; i < node.m_First + node.m_Count; ++i)
+            {
+                const Model& model = *m_Models[m_Instances[i].m_Model];
+                const Bounds& bounds = model.m_Transforms.GetWorldBounds(model.m_Instances[m_Instances[i].m_Instance].m_Node);
+                leafBounds.m_Min = glm::min(leafBounds.m_Min, bounds.m_Min);
+                leafBounds.m_Max = glm::max(leafBounds.m_Max, bounds.m_Max);
+            }
+            node.m_Min = leafBounds.m_Min;
+            node.m_Max = leafBounds.m_Max;
+        }
+        else
+        {
+            const BvhBuilder::Node& left = m_Nodes[node.m_First];
+            const BvhBuilder::Node& right = m_Nodes[node.m_First + 1];
+            node.m_Min = glm::min(left.m_Min, right.m_Min);
+            node.m_Max = glm::max(left.m_Max, right.m_Max);
+        }
+    }
+}
+
+void SceneBvh::Clear()
+{
+    m_Models.clear();
+    m_Instances.clear();
+    m_Nodes.clear();
+}
+
+bool SceneBvh::Intersect(const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const
+{
+    const float length = glm::length(direction);
+    if (m_Nodes.empty() || !(length > 0.0f))
+        return false;
+
+    // Distances are measured along the unit direction, which carries over unchanged into every instance's object space
+    const glm::vec3 unitDirection = direction / length;
+    glm::vec3 inverseDirection;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float component = std::abs(unitDirection[axis]) < 1e-20f ? std::copysign(1e-20f, unitDirection[axis]) : unitDirection[axis];
+        inverseDirection[axis] = 1.0f / component;
+    }
+
+    float best = std::numeric_limits<float>::max();
+    auto enterDistance = [&](const BvhBuilder::Node& node)
+    {
+        const glm::vec3 t0 = (node.m_Min - origin) * inverseDirection, t1 = (node.m_Max - origin) * inverseDirection;
+        const glm::vec3 slabEnter = glm::min(t0, t1), slabExit = glm::max(t0, t1);
+        const float enter = std::max(std::max(slabEnter.x, slabEnter.y), std::max(slabEnter.z, 0.0f));
+        const float exit = std::min(std::min(slabExit.x, slabExit.y), std::min(slabExit.z, best));
+        return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+    };
+
+    bool found = false;
+    std::vector<std::pair<float, uint32_t>> stack;
+    stack.reserve(64);
+    stack.emplace_back(enterDistance(m_Nodes[0]), 0u);
+    while (!stack.empty())
+    {
+        const std::pair<float, uint32_t> entry = stack.back();
+        stack.pop_back();
+        if (entry.first >= best)
+            continue;
+
+        const BvhBuilder::Node& node = m_Nodes[entry.second];
+        if (!node.IsLeaf())
+        {
+            // Nearest child on top
+            std::pair<float, uint32_t> left(enterDistance(m_Nodes[node.m_First]), node.m_First);
+            std::pair<float, uint32_t> right(enterDistance(m_Nodes[node.m_First + 1]), node.m_First + 1);
+            if (left.first < right.first)
+                std::swap(left, right);
+            stack.push_back(left);
+            stack.push_back(right);
+            continue;
+        }
+
+        for (size_t i = node.m_First; i < node.m_First + node.m_Count; ++i)
+        {
+            const Model& model = *m_Models[m_Instances[i].m_Model];
+            const Model::MeshInstance& instance = model.m_Instances[m_Instances[i].m_Instance];
+            const glm::mat4 worldToObject = glm::inverse(model.m_Transforms.GetWorld(instance.m_Node));
+            const glm::vec3 objectOrigin = glm::vec3(worldToObject * glm::vec4(origin, 1.0f));
+            const glm::vec3 objectDirection = glm::vec3(worldToObject * glm::vec4(unitDirection, 0.0f));
+
+            float distance;
+            uint32_t triangle;
+            if (MeshBvh::Intersect(model.m_Meshes[instance.m_Mesh]->m_Bvh, objectOrigin, objectDirection, best, distance, triangle))
+            {
+                best = distance;
+                found = true;
+                hit.m_Model = m_Instances[i].m_Model;
+                hit.m_Instance = m_Instances[i].m_Instance;
+                hit.m_Mesh = instance.m_Mesh;
+                hit.m_Triangle = triangle;
+            }
+        }
+    }
+
+    if (found)
+    {
+        hit.m_Distance = best;
+        hit.m_Position = origin + unitDirection * best;
+    }
+    return found;
+}
@@ -1,5 +1,7 @@
 #include "Shader.h"
 
+#include <algorithm>
+
 Shader::Shader(const char* vertexPath, const char* fragmentPath)
 {
     std::string vertexCode;
@@ -58,12 +60,51 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
     glAttachShader(ID, fragment);
     glLinkProgram(ID);
     CheckCompileErrors(ID, "PROGRAM");
+    ReflectUniforms();
 
     // Delete shaders as they're no longer needed
     glDeleteShader(vertex);
     glDeleteShader(fragment);
 }
 
+Shader::Shader(const char* computePath)
+{
+    std::string computeCode;
+    std::ifstream cShaderFile;
+
+    try
+    {
+        cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        cShaderFile.open(computePath);
+        std::stringstream cShaderStream;
+        cShaderStream << cShaderFile.rdbuf();
+        cShaderFile.close();
+        computeCode = cShaderStream.str();
+    }
+    catch (std::ifstream::failure& e)
+    {
+        std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+        throw;
+    }
+
+    const char* cShaderCode = computeCode.c_str();
+
+    // Compute shader
+    unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(compute, 1, &cShaderCode, NULL);
+    glCompileShader(compute);
+    CheckCompileErrors(compute, "COMPUTE");
+
+    // Shader program
+    ID = glCreateProgram();
+    glAttachShader(ID, compute);
+    glLinkProgram(ID);
+    CheckCompileErrors(ID, "PROGRAM");
+    ReflectUniforms();
+
+    glDeleteShader(compute);
+}
+
 void Shader::CheckCompileErrors(GLuint shader, std::string shaderType)
 {
     GLint success;
@@ -91,62 +132,199 @@ void Shader::CheckCompileErrors(GLuint shader, std::string shaderType)
     }
 }
 
-void Shader::SetBool(const std::string& name, bool value) const
+void Shader::ReflectUniforms()
+{
+    m_Uniforms.clear();
+    std::vector<GLchar> name;
+
+    if (GLAD_GL_VERSION_4_3)
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramInterfaceiv(ID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+        glGetProgramInterfaceiv(ID, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxLength);
+        name.resize(std::max(maxLength, 1));
+
+        const GLenum properties[] = { GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION };
+        for (GLint i = 0; i < count; ++i)
+        {
+            GLint values[3] = {};
+            glGetProgramResourceiv(ID, GL_UNIFORM, i, 3, properties, 3, nullptr, values);
+            glGetProgramResourceName(ID, GL_UNIFORM, i, static_cast<GLsizei>(name.size()), nullptr, name.data());
+            AddActiveUniform(name.data(), static_cast<GLenum>(values[0]), values[1], values[2]);
+        }
+    }
+    else
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        name.resize(std::max(maxLength, 1));
+
+        for (GLint i = 0; i < count; ++i)
+        {
+            GLint arraySize = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), nullptr, &arraySize, &type, name.data());
+            AddActiveUniform(name.data(), type, arraySize, glGetUniformLocation(ID, name.data()));
+        }
+    }
+
+    // Power of two table at most half full
+    size_t tableSize = 8;
+    while (tableSize < m_Uniforms.size() * 2)
+        tableSize *= 2;
+    m_UniformTable.assign(tableSize, -1);
+    for (size_t i = 0; i < m_Uniforms.size(); ++i)
+    {
+        size_t slot = m_Uniforms[i].m_Hash & (tableSize - 1);
+        while (m_UniformTable[slot] != -1)
+            slot = (slot + 1) & (tableSize - 1);
+        m_UniformTable[slot] = static_cast<int32_t>(i);
+    }
+}
+
+void Shader::AddActiveUniform(const std::string& name, GLenum type, GLint arraySize, GLint location)
+{
+    // Members of uniform blocks have no location
+    if (location < 0)
+        return;
+
+    // Arrays are reported by their first element; every element gets its own entry
+    const std::string suffix = "[0]";
+    const bool isArray = name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+    if (!isArray)
+    {
+        AddUniform(name, location, type);
+        return;
+    }
+
+    const std::string baseName = name.substr(0, name.size() - suffix.size());
+    AddUniform(baseName, location, type);
+    for (GLint element = 0; element < arraySize; ++element)
+    {
+        const std::string elementName = baseName + "[" + std::to_string(element) + "]";
+        AddUniform(elementName, element == 0 ? location : glGetUniformLocation(ID, elementName.c_str()), type);
+    }
+}
+
+void Shader::AddUniform(std::string name, GLint location, GLenum type)
+{
+    const uint32_t hash = HashName(name);
+    m_Uniforms.push_back({ std::move(name), hash, location, type });
+}
+
+const Shader::Uniform* Shader::FindUniform(std::string_view name) const
+{
+    if (m_UniformTable.empty())
+        return nullptr;
+
+    const size_t mask = m_UniformTable.size() - 1;
+    const uint32_t hash = HashName(name);
+    for (size_t slot = hash & mask; m_UniformTable[slot] != -1; slot = (slot + 1) & mask)
+    {
+        const Uniform& uniform = m_Uniforms[m_UniformTable[slot]];
+        if (uniform.m_Hash == hash && uniform.m_Name == name)
+            return &uniform;
+    }
+    return nullptr;
+}
+
+GLint Shader::GetUniformLocation(std::string_view name) const
+{
+    const Uniform* uniform = FindUniform(name);
+    return uniform ? uniform->m_Location : -1;
+}
+
+uint32_t Shader::HashName(std::string_view name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char c : name)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool Shader::AcceptsType(GLenum uniformType, GLenum valueType)
+{
+    if (uniformType == valueType)
+        return true;
+    if (valueType != GL_INT)
+        return false;
+
+    // Sampler and image uniforms hold a texture or image unit
+    switch (uniformType)
+    {
+    case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_ARRAY_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+    case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_BUFFER:
+    case GL_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_2D:
+    case GL_IMAGE_2D: case GL_IMAGE_3D: case GL_IMAGE_2D_ARRAY: case GL_IMAGE_CUBE:
+    case GL_INT_IMAGE_2D: case GL_UNSIGNED_INT_IMAGE_2D:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void Shader::SetBool(std::string_view name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniform1i(GetUniformLocation(name), (int)value);
 }
 
-void Shader::SetInt(const std::string& name, int value) const
+void Shader::SetInt(std::string_view name, int value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(GetUniformLocation(name), value);
 }
 
-void Shader::SetFloat(const std::string& name, float value) const
+void Shader::SetFloat(std::string_view name, float value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(GetUniformLocation(name), value);
 }
 
-void Shader::SetVec2(const std::string& name, const glm::vec2& value) const
+void Shader::SetVec2(std::string_view name, const glm::vec2& value) const
 {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform2fv(GetUniformLocation(name), 1, &value[0]);
 }
 
-void Shader::SetVec2(const std::string& name, float x, float y) const
+void Shader::SetVec2(std::string_view name, float x, float y) const
 {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    glUniform2f(GetUniformLocation(name), x, y);
 }
 
-void Shader::SetVec3(const std::string& name, const glm::vec3& value) const
+void Shader::SetVec3(std::string_view name, const glm::vec3& value) const
 {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform3fv(GetUniformLocation(name), 1, &value[0]);
 }
 
-void Shader::SetVec3(const std::string& name, float x, float y, float z) const
+void Shader::SetVec3(std::string_view name, float x, float y, float z) const
 {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    glUniform3f(GetUniformLocation(name), x, y, z);
 }
 
-void Shader::SetVec4(const std::string& name, const glm::vec4& value) const
+void Shader::SetVec4(std::string_view name, const glm::vec4& value) const
 {
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform4fv(GetUniformLocation(name), 1, &value[0]);
 }
 
-void Shader::SetVec4(const std::string& name, float x, float y, float z, float w) const
+void Shader::SetVec4(std::string_view name, float x, float y, float z, float w) const
 {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    glUniform4f(GetUniformLocation(name), x, y, z, w);
 }
 
-void Shader::SetMat2(const std::string& name, const glm::mat2& mat) const
+void Shader::SetMat2(std::string_view name, const glm::mat2& mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
-void Shader::SetMat3(const std::string& name, const glm::mat3& mat) const
+void Shader::SetMat3(std::string_view name, const glm::mat3& mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
-void Shader::SetMat4(const std::string& name, const glm::mat4& mat) const
+void Shader::SetMat4(std::string_view name, const glm::mat4& mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
@@ -0,0 +1,54 @@
+#include "TextureCache.h"
+
+#include <glad.h>
+#include <GLFW/glfw3.h>
+
+std::shared_ptr<Model::Mesh::Texture> TextureCache::Acquire(const TextureSource& source, const std::string& textureType)
+{
+    const Key key = { source.m_ContentHash, source.m_Width, source.m_Height, source.m_Components };
+
+    auto found = m_Textures.find(key);
+    if (found != m_Textures.end())
+    {
+        if (auto texture = found->second.lock())
+        {
+            ++m_HitCount;
+            return texture;
+        }
+    }
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, source.m_Width, source.m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, source.m_Pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // The last handle deletes the GL texture, unless the context is already gone
+    std::shared_ptr<Model::Mesh::Texture> texture(new Model::Mesh::Texture{ textureID, textureType }, [](Model::Mesh::Texture* released)
+    {
+        if (glfwGetCurrentContext())
+            glDeleteTextures(1, &released->m_TextureID);
+        delete released;
+    });
+
+    m_Textures[key] = texture;
+    ++m_UploadCount;
+    return texture;
+}
+
+size_t TextureCache::GetTextureCount() const
+{
+    size_t count = 0;
+    for (const auto& entry : m_Textures)
+    {
+        if (!entry.second.expired())
+            ++count;
+    }
+    return count;
+}
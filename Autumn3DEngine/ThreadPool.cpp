@@ -0,0 +1,58 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount) : m_Stopping(false)
+{
+    const unsigned int workerCount = ResolveThreadCount(threadCount);
+
+    m_Workers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i)
+    {
+        m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_Condition.notify_all();
+
+    for (auto& worker : m_Workers)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+}
+
+unsigned int ThreadPool::ResolveThreadCount(unsigned int threadCount)
+{
+    if (threadCount > 0)
+        return threadCount;
+
+    // hardware_concurrency may report 0 when the core count is unknown
+    const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 0 ? hardwareThreads : 1;
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Condition.wait(lock, [this]() { return m_Stopping || !m_Tasks.empty(); });
+
+            if (m_Stopping && m_Tasks.empty())
+                return;
+
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop();
+        }
+
+        // packaged_task stores any exception in its future, so nothing escapes the worker
+        task();
+    }
+}
@@ -0,0 +1,173 @@
+#include "TransformHierarchy.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+// out = a * b for column-major matrices. out must not alias a or b.
+#if defined(AUTUMN3D_SIMD_SSE2)
+
+static inline void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+    const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+    // Every column of the result is a linear combination of the columns of a
+    for (int c = 0; c < 4; ++c)
+    {
+        const __m128 column = _mm_loadu_ps(&b[c][0]);
+        __m128 result = _mm_mul_ps(a0, _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+        result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1))));
+        result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2))));
+        result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm_storeu_ps(&out[c][0], result);
+    }
+}
+
+#elif defined(AUTUMN3D_SIMD_NEON)
+
+static inline void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+    const float32x4_t a0 = vld1q_f32(&a[0][0]);
+    const float32x4_t a1 = vld1q_f32(&a[1][0]);
+    const float32x4_t a2 = vld1q_f32(&a[2][0]);
+    const float32x4_t a3 = vld1q_f32(&a[3][0]);
+
+    // Every column of the result is a linear combination of the columns of a
+    for (int c = 0; c < 4; ++c)
+    {
+        const float32x4_t column = vld1q_f32(&b[c][0]);
+        float32x4_t result = vmulq_lane_f32(a0, vget_low_f32(column), 0);
+        result = vmlaq_lane_f32(result, a1, vget_low_f32(column), 1);
+        result = vmlaq_lane_f32(result, a2, vget_high_f32(column), 0);
+        result = vmlaq_lane_f32(result, a3, vget_high_f32(column), 1);
+        vst1q_f32(&out[c][0], result);
+    }
+}
+
+#else
+
+static inline void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+    out = a * b;
+}
+
+#endif
+
+void TransformHierarchy::Clear()
+{
+    m_Parents.clear();
+    m_SubtreeEnds.clear();
+    m_Local.clear();
+    m_World.clear();
+    m_LocalBounds.clear();
+    m_WorldBounds.clear();
+    m_Dirty.clear();
+    m_DirtyNodes.clear();
+    m_Bounds = Bounds();
+    m_BoundsStale = true;
+}
+
+void TransformHierarchy::Reserve(size_t nodeCount)
+{
+    m_Parents.reserve(nodeCount);
+    m_SubtreeEnds.reserve(nodeCount);
+    m_Local.reserve(nodeCount);
+    m_World.reserve(nodeCount);
+    m_LocalBounds.reserve(nodeCount);
+    m_WorldBounds.reserve(nodeCount);
+    m_Dirty.reserve(nodeCount);
+}
+
+size_t TransformHierarchy::AddNode(uint32_t parent, const glm::mat4& local)
+{
+    const uint32_t node = static_cast<uint32_t>(m_Parents.size());
+
+    // The parent's subtree must still be open, i.e. end at the new node
+    if (parent != NO_PARENT && (parent >= node || m_SubtreeEnds[parent] != node))
+        throw std::runtime_error("Transform node " + std::to_string(node) + " is not added depth first under parent " + std::to_string(parent) + ".");
+
+    for (uint32_t ancestor = parent; ancestor != NO_PARENT; ancestor = m_Parents[ancestor])
+        ++m_SubtreeEnds[ancestor];
+
+    m_Parents.push_back(parent);
+    m_SubtreeEnds.push_back(node + 1);
+    m_Local.push_back(local);
+    m_World.push_back(local);
+    m_LocalBounds.emplace_back();
+    m_WorldBounds.emplace_back();
+    m_Dirty.push_back(1);
+    m_DirtyNodes.push_back(node);
+    return node;
+}
+
+void TransformHierarchy::SetLocal(size_t node, const glm::mat4& local)
+{
+    m_Local[node] = local;
+    MarkDirty(node);
+}
+
+void TransformHierarchy::SetBounds(size_t node, const Bounds& bounds)
+{
+    m_LocalBounds[node] = bounds;
+    MarkDirty(node);
+}
+
+void TransformHierarchy::MarkDirty(size_t node)
+{
+    if (!m_Dirty[node])
+    {
+        m_Dirty[node] = 1;
+        m_DirtyNodes.push_back(static_cast<uint32_t>(node));
+    }
+}
+
+size_t TransformHierarchy::Update()
+{
+    if (m_DirtyNodes.empty())
+        return 0;
+
+    // In index order a dirty node inside an already recomputed subtree is skipped
+    std::sort(m_DirtyNodes.begin(), m_DirtyNodes.end());
+
+    size_t updated = 0, processedEnd = 0;
+    for (const uint32_t root : m_DirtyNodes)
+    {
+        m_Dirty[root] = 0;
+        if (root < processedEnd)
+            continue;
+
+        const uint32_t rootParent = m_Parents[root];
+        if (rootParent == NO_PARENT)
+            m_World[root] = m_Local[root];
+        else
+            MultiplyMatrices(m_World[rootParent], m_Local[root], m_World[root]);
+
+        processedEnd = m_SubtreeEnds[root];
+        for (size_t node = root + 1; node < processedEnd; ++node)
+            MultiplyMatrices(m_World[m_Parents[node]], m_Local[node], m_World[node]);
+        updated += processedEnd - root;
+
+        for (size_t node = root; node < processedEnd; ++node)
+            m_WorldBounds[node] = m_LocalBounds[node].Transform(m_World[node]);
+    }
+
+    m_DirtyNodes.clear();
+    m_BoundsStale = true;
+    return updated;
+}
+
+const Bounds& TransformHierarchy::GetBounds()
+{
+    if (m_BoundsStale)
+    {
+        m_Bounds = Bounds();
+        for (const Bounds& bounds : m_WorldBounds)
+            m_Bounds.Merge(bounds);
+        m_BoundsStale = false;
+    }
+    return m_Bounds;
+}
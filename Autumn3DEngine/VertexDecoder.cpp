@@ -0,0 +1,237 @@
+#include "VertexDecoder.h"
+#include "AccessorView.h"
+#include "Simd.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// The SIMD path writes each vertex front to back with 16 byte stores that spill into the next field,
+// which is then overwritten by that field's own store. This relies on the fields being packed in this order.
+static_assert(offsetof(Model::Mesh::Vertex, m_Normal) == offsetof(Model::Mesh::Vertex, m_Position) + 12, "Unexpected Vertex layout");
+static_assert(offsetof(Model::Mesh::Vertex, m_TexCoords) == offsetof(Model::Mesh::Vertex, m_Normal) + 12, "Unexpected Vertex layout");
+static_assert(offsetof(Model::Mesh::Vertex, m_Tangent) == offsetof(Model::Mesh::Vertex, m_TexCoords) + 8, "Unexpected Vertex layout");
+static_assert(offsetof(Model::Mesh::Vertex, m_Bitangent) == offsetof(Model::Mesh::Vertex, m_Tangent) + 12, "Unexpected Vertex layout");
+static_assert(offsetof(Model::Mesh::Vertex, m_BoneIDs) == offsetof(Model::Mesh::Vertex, m_Bitangent) + 12, "Unexpected Vertex layout");
+static_assert(offsetof(Model::Mesh::Vertex, m_Weights) == offsetof(Model::Mesh::Vertex, m_BoneIDs) + 16, "Unexpected Vertex layout");
+static_assert(sizeof(Model::Mesh::Vertex) == offsetof(Model::Mesh::Vertex, m_Weights) + 16, "Unexpected Vertex layout");
+
+// Backing storage for absent streams, large enough for the widest attribute
+alignas(16) static const unsigned char s_ZeroElement[16] = {};
+
+VertexDecoder::Streams::Streams() :
+    m_Positions(Absent()), m_Normals(Absent()), m_TexCoords(Absent()), m_Tangents(Absent()),
+    m_Bitangents(Absent()), m_Joints(Absent()), m_Weights(Absent()), m_Count(0)
+{
+}
+
+VertexDecoder::Stream VertexDecoder::Absent()
+{
+    return { s_ZeroElement, 0 };
+}
+
+// True if the attribute's accessor stores the given component type without normalization
+static bool IsStoredAs(const tinygltf::Model& gltfModel, int accessorIndex, int componentType)
+{
+    const auto& accessor = gltfModel.accessors[accessorIndex];
+    return accessor.componentType == componentType && !accessor.normalized && accessor.bufferView >= 0;
+}
+
+VertexDecoder::Stream VertexDecoder::FindStream(const tinygltf::Primitive& primitive, const tinygltf::Model& gltfModel, const GltfBuffers& buffers, const char* attribute, int componentType)
+{
+    const auto it = primitive.attributes.find(attribute);
+    if (it == primitive.attributes.end() || !IsStoredAs(gltfModel, it->second, componentType))
+        return Absent();
+
+    // The view validates the stride and the buffer bounds
+    const AccessorView<unsigned char, 1> view(gltfModel, buffers, it->second);
+    return { view.Data(), view.Stride() };
+}
+
+template <typename T, int Components>
+void VertexDecoder::ConvertAttribute(const tinygltf::Primitive& primitive, const tinygltf::Model& gltfModel, const GltfBuffers& buffers, const char* attribute, int componentType, T* firstField)
+{
+    const auto it = primitive.attributes.find(attribute);
+    if (it == primitive.attributes.end() || IsStoredAs(gltfModel, it->second, componentType))
+        return;
+
+    const AccessorView<T, Components> view(gltfModel, buffers, it->second);
+    view.CopyTo(firstField, sizeof(Model::Mesh::Vertex));
+}
+
+VertexDecoder::Streams VertexDecoder::ResolveStreams(const tinygltf::Primitive& primitive, const tinygltf::Model& gltfModel, const GltfBuffers& buffers)
+{
+    Streams streams;
+
+    const auto position = primitive.attributes.find("POSITION");
+    if (position == primitive.attributes.end())
+        throw std::runtime_error("Primitive has no POSITION attribute.");
+    streams.m_Count = gltfModel.accessors.at(position->second).count;
+
+    // Every attribute needs one element per vertex. A shorter stream would be read past its end, a longer one
+    // converted past the primitive's vertices.
+    static const char* const attributes[] = { "NORMAL", "TEXCOORD_0", "TANGENT", "BITANGENT", "JOINTS_0", "WEIGHTS_0" };
+    for (const char* attribute : attributes)
+    {
+        const auto it = primitive.attributes.find(attribute);
+        if (it != primitive.attributes.end() && gltfModel.accessors.at(it->second).count != streams.m_Count)
+            throw std::runtime_error(std::string("Primitive attribute ") + attribute + " has " + std::to_string(gltfModel.accessors.at(it->second).count) +
+                " elements for " + std::to_string(streams.m_Count) + " vertices.");
+    }
+
+    streams.m_Positions = FindStream(primitive, gltfModel, buffers, "POSITION", TINYGLTF_COMPONENT_TYPE_FLOAT);
+    streams.m_Normals = FindStream(primitive, gltfModel, buffers, "NORMAL", TINYGLTF_COMPONENT_TYPE_FLOAT);
+    streams.m_TexCoords = FindStream(primitive, gltfModel, buffers, "TEXCOORD_0", TINYGLTF_COMPONENT_TYPE_FLOAT);
+    streams.m_Tangents = FindStream(primitive, gltfModel, buffers, "TANGENT", TINYGLTF_COMPONENT_TYPE_FLOAT);
+    streams.m_Bitangents = FindStream(primitive, gltfModel, buffers, "BITANGENT", TINYGLTF_COMPONENT_TYPE_FLOAT);
+
+    // Bone influences are only meaningful as a pair
+    if (primitive.attributes.count("JOINTS_0") && primitive.attributes.count("WEIGHTS_0"))
+    {
+        streams.m_Joints = FindStream(primitive, gltfModel, buffers, "JOINTS_0", TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
+        streams.m_Weights = FindStream(primitive, gltfModel, buffers, "WEIGHTS_0", TINYGLTF_COMPONENT_TYPE_FLOAT);
+    }
+
+    return streams;
+}
+
+size_t VertexDecoder::DecodePrimitive(const tinygltf::Primitive& primitive, const tinygltf::Model& gltfModel, const GltfBuffers& buffers, Model::Mesh::Vertex* out)
+{
+    const Streams streams = ResolveStreams(primitive, gltfModel, buffers);
+    Decode(streams, out);
+
+    // Attributes in any other layout were left zeroed by Decode and are converted here
+    ConvertAttribute<float, 3>(primitive, gltfModel, buffers, "POSITION", TINYGLTF_COMPONENT_TYPE_FLOAT, &out->m_Position.x);
+    ConvertAttribute<float, 3>(primitive, gltfModel, buffers, "NORMAL", TINYGLTF_COMPONENT_TYPE_FLOAT, &out->m_Normal.x);
+    ConvertAttribute<float, 2>(primitive, gltfModel, buffers, "TEXCOORD_0", TINYGLTF_COMPONENT_TYPE_FLOAT, &out->m_TexCoords.x);
+    ConvertAttribute<float, 3>(primitive, gltfModel, buffers, "TANGENT", TINYGLTF_COMPONENT_TYPE_FLOAT, &out->m_Tangent.x);
+    ConvertAttribute<float, 3>(primitive, gltfModel, buffers, "BITANGENT", TINYGLTF_COMPONENT_TYPE_FLOAT, &out->m_Bitangent.x);
+
+    if (primitive.attributes.count("JOINTS_0") && primitive.attributes.count("WEIGHTS_0"))
+    {
+        ConvertAttribute<int, MAX_BONE_INFLUENCE>(primitive, gltfModel, buffers, "JOINTS_0", TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, out->m_BoneIDs);
+        ConvertAttribute<float, MAX_BONE_INFLUENCE>(primitive, gltfModel, buffers, "WEIGHTS_0", TINYGLTF_COMPONENT_TYPE_FLOAT, out->m_Weights);
+    }
+
+    return streams.m_Count;
+}
+
+#if defined(AUTUMN3D_SIMD_SSE2)
+
+// Loads three floats into the low lanes without reading past the element
+static inline __m128 Load3(const unsigned char* source)
+{
+    const float* values = reinterpret_cast<const float*>(source);
+    return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(values))), _mm_load_ss(values + 2));
+}
+
+void VertexDecoder::Decode(const Streams& streams, Model::Mesh::Vertex* out)
+{
+    const unsigned char* positions = streams.m_Positions.m_Data;
+    const unsigned char* normals = streams.m_Normals.m_Data;
+    const unsigned char* texCoords = streams.m_TexCoords.m_Data;
+    const unsigned char* tangents = streams.m_Tangents.m_Data;
+    const unsigned char* bitangents = streams.m_Bitangents.m_Data;
+    const unsigned char* joints = streams.m_Joints.m_Data;
+    const unsigned char* weights = streams.m_Weights.m_Data;
+    const __m128i zero = _mm_setzero_si128();
+
+    for (size_t i = 0; i < streams.m_Count; ++i)
+    {
+        float* vertex = reinterpret_cast<float*>(out + i);
+
+        // Each store spills into the next field, which the following store overwrites
+        _mm_storeu_ps(vertex + 0, Load3(positions));
+        _mm_storeu_ps(vertex + 3, Load3(normals));
+        _mm_storel_pi(reinterpret_cast<__m64*>(vertex + 6), _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(texCoords))));
+        _mm_storeu_ps(vertex + 8, Load3(tangents));
+        _mm_storeu_ps(vertex + 11, Load3(bitangents));
+
+        // Widen the four unsigned short joint indices to ints
+        const __m128i jointIndices = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(joints));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(vertex + 14), _mm_unpacklo_epi16(jointIndices, zero));
+        _mm_storeu_ps(vertex + 18, _mm_loadu_ps(reinterpret_cast<const float*>(weights)));
+
+        positions += streams.m_Positions.m_Stride;
+        normals += streams.m_Normals.m_Stride;
+        texCoords += streams.m_TexCoords.m_Stride;
+        tangents += streams.m_Tangents.m_Stride;
+        bitangents += streams.m_Bitangents.m_Stride;
+        joints += streams.m_Joints.m_Stride;
+        weights += streams.m_Weights.m_Stride;
+    }
+}
+
+#elif defined(AUTUMN3D_SIMD_NEON)
+
+// Loads three floats into the low lanes without reading past the element
+static inline float32x4_t Load3(const unsigned char* source)
+{
+    const float* values = reinterpret_cast<const float*>(source);
+    return vcombine_f32(vld1_f32(values), vld1_lane_f32(values + 2, vdup_n_f32(0.0f), 0));
+}
+
+void VertexDecoder::Decode(const Streams& streams, Model::Mesh::Vertex* out)
+{
+    const unsigned char* positions = streams.m_Positions.m_Data;
+    const unsigned char* normals = streams.m_Normals.m_Data;
+    const unsigned char* texCoords = streams.m_TexCoords.m_Data;
+    const unsigned char* tangents = streams.m_Tangents.m_Data;
+    const unsigned char* bitangents = streams.m_Bitangents.m_Data;
+    const unsigned char* joints = streams.m_Joints.m_Data;
+    const unsigned char* weights = streams.m_Weights.m_Data;
+
+    for (size_t i = 0; i < streams.m_Count; ++i)
+    {
+        float* vertex = reinterpret_cast<float*>(out + i);
+
+        // Each store spills into the next field, which the following store overwrites
+        vst1q_f32(vertex + 0, Load3(positions));
+        vst1q_f32(vertex + 3, Load3(normals));
+        vst1_f32(vertex + 6, vld1_f32(reinterpret_cast<const float*>(texCoords)));
+        vst1q_f32(vertex + 8, Load3(tangents));
+        vst1q_f32(vertex + 11, Load3(bitangents));
+
+        // Widen the four unsigned short joint indices to ints
+        const uint32x4_t jointIndices = vmovl_u16(vld1_u16(reinterpret_cast<const uint16_t*>(joints)));
+        vst1q_s32(reinterpret_cast<int32_t*>(vertex + 14), vreinterpretq_s32_u32(jointIndices));
+        vst1q_f32(vertex + 18, vld1q_f32(reinterpret_cast<const float*>(weights)));
+
+        positions += streams.m_Positions.m_Stride;
+        normals += streams.m_Normals.m_Stride;
+        texCoords += streams.m_TexCoords.m_Stride;
+        tangents += streams.m_Tangents.m_Stride;
+        bitangents += streams.m_Bitangents.m_Stride;
+        joints += streams.m_Joints.m_Stride;
+        weights += streams.m_Weights.m_Stride;
+    }
+}
+
+#else
+
+void VertexDecoder::Decode(const Streams& streams, Model::Mesh::Vertex* out)
+{
+    DecodeScalar(streams, out);
+}
+
+#endif
+
+void VertexDecoder::DecodeScalar(const Streams& streams, Model::Mesh::Vertex* out)
+{
+    for (size_t i = 0; i < streams.m_Count; ++i)
+    {
+        Model::Mesh::Vertex& vertex = out[i];
+
+        std::memcpy(&vertex.m_Position, streams.m_Positions.m_Data + i * streams.m_Positions.m_Stride, sizeof(vertex.m_Position));
+        std::memcpy(&vertex.m_Normal, streams.m_Normals.m_Data + i * streams.m_Normals.m_Stride, sizeof(vertex.m_Normal));
+        std::memcpy(&vertex.m_TexCoords, streams.m_TexCoords.m_Data + i * streams.m_TexCoords.m_Stride, sizeof(vertex.m_TexCoords));
+        std::memcpy(&vertex.m_Tangent, streams.m_Tangents.m_Data + i * streams.m_Tangents.m_Stride, sizeof(vertex.m_Tangent));
+        std::memcpy(&vertex.m_Bitangent, streams.m_Bitangents.m_Data + i * streams.m_Bitangents.m_Stride, sizeof(vertex.m_Bitangent));
+        std::memcpy(vertex.m_Weights, streams.m_Weights.m_Data + i * streams.m_Weights.m_Stride, sizeof(vertex.m_Weights));
+
+        unsigned short joints[MAX_BONE_INFLUENCE];
+        std::memcpy(joints, streams.m_Joints.m_Data + i * streams.m_Joints.m_Stride, sizeof(joints));
+        for (int j = 0; j < MAX_BONE_INFLUENCE; ++j)
+            vertex.m_BoneIDs[j] = joints[j];
+    }
+}
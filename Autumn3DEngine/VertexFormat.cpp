@@ -0,0 +1,123 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "glm/gtc/packing.hpp"
+
+VertexLayout VertexFormat::SelectLayout(const Model::Mesh::Vertex* vertices, size_t vertexCount)
+{
+    bool skinned = false;
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        for (int j = 0; j < MAX_BONE_INFLUENCE; ++j)
+        {
+            if (vertices[i].m_Weights[j] == 0.0f && vertices[i].m_BoneIDs[j] == 0)
+                continue;
+
+            // Skinned vertices pack bone IDs into a byte
+            if (vertices[i].m_BoneIDs[j] < 0 || vertices[i].m_BoneIDs[j] > 255)
+                return VertexLayout::Full;
+            skinned = true;
+        }
+    }
+
+    return skinned ? VertexLayout::Skinned : VertexLayout::Static;
+}
+
+size_t VertexFormat::GetStride(VertexLayout layout)
+{
+    switch (layout)
+    {
+    case VertexLayout::Static: return sizeof(PackedStaticVertex);
+    case VertexLayout::Skinned: return sizeof(PackedSkinnedVertex);
+    default: return sizeof(Model::Mesh::Vertex);
+    }
+}
+
+void VertexFormat::EncodeOctahedral(const glm::vec3& direction, int16_t encoded[2])
+{
+    // Project onto the octahedron, then fold the lower hemisphere over the diagonals
+    const float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    glm::vec2 octahedral = length > 0.0f ? glm::vec2(direction.x, direction.y) / length : glm::vec2(0.0f);
+    if (length > 0.0f && direction.z < 0.0f)
+    {
+        octahedral = glm::vec2(
+            (1.0f - std::abs(octahedral.y)) * (octahedral.x >= 0.0f ? 1.0f : -1.0f),
+            (1.0f - std::abs(octahedral.x)) * (octahedral.y >= 0.0f ? 1.0f : -1.0f));
+    }
+
+    encoded[0] = static_cast<int16_t>(std::round(glm::clamp(octahedral.x, -1.0f, 1.0f) * 32767.0f));
+    encoded[1] = static_cast<int16_t>(std::round(glm::clamp(octahedral.y, -1.0f, 1.0f) * 32767.0f));
+}
+
+// Quantizes a value in [0, 1] to unorm16
+static uint16_t QuantizeUnorm16(float value)
+{
+    return static_cast<uint16_t>(std::round(glm::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+void VertexFormat::Pack(const Model::Mesh::Vertex* vertices, size_t vertexCount, VertexLayout layout,
+    const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<unsigned char>& packed)
+{
+    const size_t stride = GetStride(layout);
+    packed.resize(vertexCount * stride);
+    if (layout == VertexLayout::Full)
+    {
+        std::copy(reinterpret_cast<const unsigned char*>(vertices), reinterpret_cast<const unsigned char*>(vertices + vertexCount), packed.begin());
+        return;
+    }
+
+    // Flat axes get a unit extent so they quantize to 0 instead of dividing by zero
+    const glm::vec3 extent = boundsMax - boundsMin;
+    const glm::vec3 inverseExtent = glm::vec3(
+        extent.x > 0.0f ? 1.0f / extent.x : 1.0f,
+        extent.y > 0.0f ? 1.0f / extent.y : 1.0f,
+        extent.z > 0.0f ? 1.0f / extent.z : 1.0f);
+
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        const Model::Mesh::Vertex& vertex = vertices[i];
+        PackedStaticVertex& target = *reinterpret_cast<PackedStaticVertex*>(&packed[i * stride]);
+
+        const glm::vec3 position = (vertex.m_Position - boundsMin) * inverseExtent;
+        const float bitangentSign = glm::dot(glm::cross(vertex.m_Normal, vertex.m_Tangent), vertex.m_Bitangent) < 0.0f ? 0.0f : 1.0f;
+        target.m_Position[0] = QuantizeUnorm16(position.x);
+        target.m_Position[1] = QuantizeUnorm16(position.y);
+        target.m_Position[2] = QuantizeUnorm16(position.z);
+        target.m_Position[3] = QuantizeUnorm16(bitangentSign);
+
+        EncodeOctahedral(vertex.m_Normal, target.m_Normal);
+        EncodeOctahedral(vertex.m_Tangent, target.m_Tangent);
+
+        target.m_TexCoords[0] = glm::packHalf1x16(vertex.m_TexCoords.x);
+        target.m_TexCoords[1] = glm::packHalf1x16(vertex.m_TexCoords.y);
+
+        if (layout != VertexLayout::Skinned)
+            continue;
+
+        PackedSkinnedVertex& skinned = *reinterpret_cast<PackedSkinnedVertex*>(&packed[i * stride]);
+
+        // Round the weights to unorm8 and give the rounding error to the largest one so they still sum to 1
+        int weightSum = 0, largest = 0;
+        for (int j = 0; j < MAX_BONE_INFLUENCE; ++j)
+        {
+            skinned.m_BoneIDs[j] = static_cast<uint8_t>(vertex.m_BoneIDs[j]);
+            skinned.m_Weights[j] = static_cast<uint8_t>(std::round(glm::clamp(vertex.m_Weights[j], 0.0f, 1.0f) * 255.0f));
+            weightSum += skinned.m_Weights[j];
+            if (skinned.m_Weights[j] > skinned.m_Weights[largest])
+                largest = j;
+        }
+        if (weightSum > 0)
+            skinned.m_Weights[largest] = static_cast<uint8_t>(glm::clamp(skinned.m_Weights[largest] + 255 - weightSum, 0, 255));
+    }
+}
+
+glm::vec3 VertexFormat::UnpackPosition(const unsigned char* record, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    // Both layouts start with the static record
+    uint16_t position[4];
+    std::memcpy(position, record + offsetof(PackedStaticVertex, m_Position), sizeof(position));
+    return boundsMin + glm::vec3(position[0], position[1], position[2]) / 65535.0f * (boundsMax - boundsMin);
+}
@@ -0,0 +1,201 @@
+#include "VertexWelder.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <future>
+
+static_assert(sizeof(Model::Mesh::Vertex) % sizeof(uint64_t) == 0, "Vertex must be a whole number of 64-bit words");
+
+VertexWelder::Key VertexWelder::MakeKey(const Model::Mesh::Vertex& vertex, float inverseEpsilon)
+{
+    uint32_t words[KEY_WORDS];
+    std::memcpy(words, &vertex, sizeof(words));
+
+    // Bone IDs are integers and compare exactly; every other field is a float
+    const size_t boneFirst = offsetof(Model::Mesh::Vertex, m_BoneIDs) / sizeof(float);
+    const size_t boneEnd = boneFirst + MAX_BONE_INFLUENCE;
+
+    Key key;
+    for (size_t i = 0; i < KEY_WORDS; ++i)
+    {
+        if (inverseEpsilon == 0.0f || (i >= boneFirst && i < boneEnd))
+        {
+            key.m_Words[i] = words[i];
+            continue;
+        }
+
+        // Values outside the grid (NaN, infinities, huge magnitudes) compare bit-exactly
+        float value;
+        std::memcpy(&value, &words[i], sizeof(value));
+        const double cell = std::floor(static_cast<double>(value) * inverseEpsilon);
+        key.m_Words[i] = std::abs(cell) < 4.0e18 ? static_cast<int64_t>(cell) : static_cast<int64_t>(words[i]) | (int64_t(1) << 62);
+    }
+    return key;
+}
+
+// Mixes 64-bit words into a hash
+static uint64_t MixWords(const uint64_t* words, size_t count)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < count; ++i)
+    {
+        hash ^= words[i];
+        hash *= 1099511628211ull;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+uint64_t VertexWelder::HashKey(const Key& key)
+{
+    return MixWords(reinterpret_cast<const uint64_t*>(key.m_Words), KEY_WORDS);
+}
+
+uint64_t VertexWelder::HashBytes(const Model::Mesh::Vertex& vertex)
+{
+    uint64_t words[sizeof(Model::Mesh::Vertex) / sizeof(uint64_t)];
+    std::memcpy(words, &vertex, sizeof(words));
+    return MixWords(words, sizeof(words) / sizeof(uint64_t));
+}
+
+// Runs body(begin, end) over [0, count) split across a pool, or inline without one
+static void ParallelFor(ThreadPool* pool, size_t count, const std::function<void(size_t, size_t)>& body)
+{
+    if (!pool || count < 2)
+    {
+        body(0, count);
+        return;
+    }
+
+    const size_t chunkCount = pool->GetThreadCount() * 4;
+    const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    std::vector<std::future<void>> chunks;
+    for (size_t begin = 0; begin < count; begin += chunkSize)
+    {
+        const size_t end = std::min(count, begin + chunkSize);
+        chunks.emplace_back(pool->Submit([&body, begin, end]() { body(begin, end); }));
+    }
+    for (auto& chunk : chunks)
+        chunk.get();
+}
+
+size_t VertexWelder::Weld(std::vector<Model::Mesh::Vertex>& vertices, std::vector<unsigned int>& indices, float epsilon, ThreadPool* pool)
+{
+    const size_t vertexCount = vertices.size();
+    if (vertexCount < 2 || indices.empty())
+        return vertexCount;
+
+    // Small meshes are not worth the thread hand-off
+    if (vertexCount < 65536)
+        pool = nullptr;
+
+    const float inverseEpsilon = epsilon > 0.0f ? 1.0f / epsilon : 0.0f;
+    const uint32_t empty = ~0u;
+
+    // Power of two table at most half full
+    size_t tableSize = 1;
+    while (tableSize < vertexCount * 2)
+        tableSize <<= 1;
+    const size_t mask = tableSize - 1;
+    std::unique_ptr<std::atomic<uint32_t>[]> table(new std::atomic<uint32_t>[tableSize]);
+    ParallelFor(pool, tableSize, [&table, empty](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            table[i].store(empty, std::memory_order_relaxed);
+    });
+
+    // Hash every vertex up front so probes compare hashes before building full keys
+    std::vector<uint64_t> hashes(vertexCount);
+    ParallelFor(pool, vertexCount, [&](size_t begin, size_t end)
+    {
+        for (size_t v = begin; v < end; ++v)
+            hashes[v] = inverseEpsilon == 0.0f ? HashBytes(vertices[v]) : HashKey(MakeKey(vertices[v], inverseEpsilon));
+    });
+
+    // Bit-identical welding compares the raw records; epsilon welding compares the grid cells
+    auto equal = [&](uint32_t a, uint32_t b)
+    {
+        if (hashes[a] != hashes[b])
+            return false;
+        if (inverseEpsilon == 0.0f)
+            return std::memcmp(&vertices[a], &vertices[b], sizeof(Model::Mesh::Vertex)) == 0;
+
+        const Key keyA = MakeKey(vertices[a], inverseEpsilon);
+        const Key keyB = MakeKey(vertices[b], inverseEpsilon);
+        return std::memcmp(&keyA, &keyB, sizeof(Key)) == 0;
+    };
+
+    // Finds the slot holding the key of a vertex, claiming an empty one if it is not in the table yet
+    auto findSlot = [&](uint32_t vertex) -> size_t
+    {
+        for (size_t slot = hashes[vertex] & mask;; slot = (slot + 1) & mask)
+        {
+            uint32_t occupant = table[slot].load(std::memory_order_acquire);
+            if (occupant == empty)
+            {
+                if (table[slot].compare_exchange_strong(occupant, vertex, std::memory_order_acq_rel))
+                    return slot;
+                // Another thread claimed the slot first; occupant now holds its vertex
+            }
+
+            if (equal(occupant, vertex))
+                return slot;
+        }
+    };
+
+    // Insert every vertex, lowering each slot to the first vertex of its duplicates
+    std::vector<uint32_t> slots(vertexCount);
+    ParallelFor(pool, vertexCount, [&](size_t begin, size_t end)
+    {
+        for (size_t v = begin; v < end; ++v)
+        {
+            const size_t slot = findSlot(static_cast<uint32_t>(v));
+            slots[v] = static_cast<uint32_t>(slot);
+
+            uint32_t occupant = table[slot].load(std::memory_order_relaxed);
+            while (occupant > v && !table[slot].compare_exchange_weak(occupant, static_cast<uint32_t>(v), std::memory_order_relaxed))
+            {
+            }
+        }
+    });
+
+    // A vertex survives if it is the representative of its slot; survivors keep their relative order
+    std::vector<uint32_t> remap(vertexCount);
+    size_t weldedCount = 0;
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        if (table[slots[v]].load(std::memory_order_relaxed) == v)
+            remap[v] = static_cast<uint32_t>(weldedCount++);
+    }
+
+    if (weldedCount == vertexCount)
+        return vertexCount;
+
+    std::vector<Model::Mesh::Vertex> welded(weldedCount);
+    ParallelFor(pool, vertexCount, [&](size_t begin, size_t end)
+    {
+        for (size_t v = begin; v < end; ++v)
+        {
+            const uint32_t representative = table[slots[v]].load(std::memory_order_relaxed);
+            if (representative == v)
+                welded[remap[v]] = vertices[v];
+            else
+                remap[v] = remap[representative];
+        }
+    });
+
+    ParallelFor(pool, indices.size(), [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (indices[i] < vertexCount)
+                indices[i] = remap[indices[i]];
+        }
+    });
+
+    vertices.swap(welded);
+    return weldedCount;
+}
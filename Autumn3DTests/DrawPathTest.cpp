@@ -0,0 +1,324 @@
+#include "Renderer.h"
+#include "MeshCache.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tiny_gltf.h"
+
+// Renders a synthetic scene through every draw path of the renderer into an offscreen framebuffer and checks that they
+// produce the same pixels: the classic path with one multi-draw per mesh, the indirect path with glMultiDrawElementsIndirect,
+// and the indirect path behind GPU culling.
+// Needs a GL 4.5 context with ARB_shader_draw_parameters. A headless machine runs it on Mesa's llvmpipe, e.g. with Mesa's
+// opengl32.dll next to the executable and GALLIUM_DRIVER=llvmpipe set.
+// Usage: Autumn3DTests [shaderDirectory]
+
+static const int FRAME_WIDTH = 256;
+static const int FRAME_HEIGHT = 256;
+
+// Appends values to the scene's buffer behind a new buffer view and accessor. Returns the accessor index.
+template <typename T>
+static int AddAccessor(tinygltf::Model& scene, const std::vector<T>& values, int componentType, int type, int target)
+{
+    std::vector<unsigned char>& buffer = scene.buffers[0].data;
+    buffer.resize((buffer.size() + 3) & ~size_t(3));
+
+    tinygltf::BufferView view;
+    view.buffer = 0;
+    view.byteOffset = buffer.size();
+    view.byteLength = values.size() * sizeof(T);
+    view.target = target;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values.data());
+    buffer.insert(buffer.end(), bytes, bytes + view.byteLength);
+    scene.bufferViews.push_back(view);
+
+    tinygltf::Accessor accessor;
+    accessor.bufferView = static_cast<int>(scene.bufferViews.size() - 1);
+    accessor.componentType = componentType;
+    accessor.type = type;
+    accessor.count = values.size() / tinygltf::GetNumComponentsInType(static_cast<uint32_t>(type));
+    scene.accessors.push_back(accessor);
+    return static_cast<int>(scene.accessors.size() - 1);
+}
+
+// Appends a primitive with positions, normals and texture coordinates, indexed with Index (uint16_t or uint32_t)
+template <typename Index>
+static tinygltf::Primitive AddPrimitive(tinygltf::Model& scene, const std::vector<float>& positions, const std::vector<float>& normals,
+    const std::vector<float>& texCoords, const std::vector<Index>& indices, int material)
+{
+    tinygltf::Primitive primitive;
+    primitive.mode = TINYGLTF_MODE_TRIANGLES;
+    primitive.material = material;
+    primitive.attributes["POSITION"] = AddAccessor(scene, positions, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, TINYGLTF_TARGET_ARRAY_BUFFER);
+    primitive.attributes["NORMAL"] = AddAccessor(scene, normals, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, TINYGLTF_TARGET_ARRAY_BUFFER);
+    primitive.attributes["TEXCOORD_0"] = AddAccessor(scene, texCoords, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC2, TINYGLTF_TARGET_ARRAY_BUFFER);
+    primitive.indices = AddAccessor(scene, indices, sizeof(Index) == 2 ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT : TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT,
+        TINYGLTF_TYPE_SCALAR, TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER);
+
+    // The POSITION accessor must carry its bounds
+    tinygltf::Accessor& accessor = scene.accessors[primitive.attributes["POSITION"]];
+    accessor.minValues = { 1e30, 1e30, 1e30 };
+    accessor.maxValues = { -1e30, -1e30, -1e30 };
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        accessor.minValues[i % 3] = (std::min)(accessor.minValues[i % 3], double(positions[i]));
+        accessor.maxValues[i % 3] = (std::max)(accessor.maxValues[i % 3], double(positions[i]));
+    }
+    return primitive;
+}
+
+// A unit cube with 16-bit indices, split into two primitives of three faces each
+static tinygltf::Mesh MakeCube(tinygltf::Model& scene, int firstMaterial)
+{
+    static const float faceNormals[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+
+    tinygltf::Mesh mesh;
+    for (int half = 0; half < 2; ++half)
+    {
+        std::vector<float> positions, normals, texCoords;
+        std::vector<uint16_t> indices;
+        for (int face = half * 3; face < half * 3 + 3; ++face)
+        {
+            // Two axes spanning the face, with u x v along the normal so the triangles wind counter-clockwise
+            const float* n = faceNormals[face];
+            const float up[3] = { 0.0f, n[1] != 0.0f ? 0.0f : 1.0f, n[1] != 0.0f ? 1.0f : 0.0f };
+            const float u[3] = { up[1] * n[2] - up[2] * n[1], up[2] * n[0] - up[0] * n[2], up[0] * n[1] - up[1] * n[0] };
+            const uint16_t base = static_cast<uint16_t>(positions.size() / 3);
+            for (int corner = 0; corner < 4; ++corner)
+            {
+                const float s = (corner & 1) ? 0.5f : -0.5f, t = (corner & 2) ? 0.5f : -0.5f;
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    positions.push_back(0.5f * n[axis] + s * u[axis] + t * up[axis]);
+                    normals.push_back(n[axis]);
+                }
+                texCoords.push_back(s + 0.5f);
+                texCoords.push_back(t + 0.5f);
+            }
+            for (const int index : { 0, 1, 3, 0, 3, 2 })
+                indices.push_back(static_cast<uint16_t>(base + index));
+        }
+        mesh.primitives.push_back(AddPrimitive(scene, positions, normals, texCoords, indices, firstMaterial + half));
+    }
+    return mesh;
+}
+
+// A grid of quads facing +Z in [-0.5, 0.5]^2 with 32-bit indices
+static tinygltf::Mesh MakePlane(tinygltf::Model& scene, int material, int cells)
+{
+    std::vector<float> positions, normals, texCoords;
+    std::vector<uint32_t> indices;
+    for (int y = 0; y <= cells; ++y)
+    {
+        for (int x = 0; x <= cells; ++x)
+        {
+            const float s = float(x) / cells, t = float(y) / cells;
+            positions.insert(positions.end(), { s - 0.5f, t - 0.5f, 0.0f });
+            normals.insert(normals.end(), { 0.0f, 0.0f, 1.0f });
+            texCoords.insert(texCoords.end(), { s * 4.0f, t * 4.0f });
+        }
+    }
+    for (int y = 0; y < cells; ++y)
+    {
+        for (int x = 0; x < cells; ++x)
+        {
+            const uint32_t corner = y * (cells + 1) + x;
+            indices.insert(indices.end(), { corner, corner + 1, corner + cells + 2, corner, corner + cells + 2, corner + cells + 1 });
+        }
+    }
+
+    tinygltf::Mesh mesh;
+    mesh.primitives.push_back(AddPrimitive(scene, positions, normals, texCoords, indices, material));
+    return mesh;
+}
+
+// A 2x2 checker texture of two colours, so texture coordinates and bindings show in the frame
+static void AddCheckerMaterial(tinygltf::Model& scene, uint32_t colorA, uint32_t colorB)
+{
+    tinygltf::Image image;
+    image.width = 2;
+    image.height = 2;
+    image.component = 4;
+    image.bits = 8;
+    image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+    image.mimeType = "image/png";
+    for (const uint32_t color : { colorA, colorB, colorB, colorA })
+    {
+        for (int channel = 0; channel < 4; ++channel)
+            image.image.push_back(static_cast<unsigned char>(channel == 3 ? 255 : color >> (16 - 8 * channel)));
+    }
+    scene.images.push_back(image);
+
+    tinygltf::Texture texture;
+    texture.source = static_cast<int>(scene.images.size() - 1);
+    scene.textures.push_back(texture);
+
+    tinygltf::Material material;
+    material.pbrMetallicRoughness.baseColorTexture.index = static_cast<int>(scene.textures.size() - 1);
+    scene.materials.push_back(material);
+}
+
+// Appends a node and returns its index
+static int AddNode(tinygltf::Model& scene, int mesh, const std::vector<double>& translation, double angle, const std::vector<double>& axis, double scale)
+{
+    tinygltf::Node node;
+    node.mesh = mesh;
+    node.translation = translation;
+    const double sine = std::sin(angle * 0.5);
+    node.rotation = { axis[0] * sine, axis[1] * sine, axis[2] * sine, std::cos(angle * 0.5) };
+    node.scale = { scale, scale, scale };
+    scene.nodes.push_back(node);
+    return static_cast<int>(scene.nodes.size() - 1);
+}
+
+// Writes the test scene: a backdrop plane, a grid of rotated cubes and a rotated group of instances in front of the
+// renderer's default camera
+static void WriteTestScene(const std::string& path)
+{
+    tinygltf::Model scene;
+    scene.asset.version = "2.0";
+    scene.buffers.resize(1);
+
+    AddCheckerMaterial(scene, 0xD04030, 0x902010);
+    AddCheckerMaterial(scene, 0x30C050, 0x108030);
+    AddCheckerMaterial(scene, 0x4060E0, 0x203090);
+    scene.meshes.push_back(MakeCube(scene, 0));
+    scene.meshes.push_back(MakePlane(scene, 2, 16));
+
+    tinygltf::Scene root;
+    root.nodes.push_back(AddNode(scene, 1, { 0.0, 0.0, -8.0 }, 0.0, { 0.0, 1.0, 0.0 }, 14.0));
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int column = 0; column < 4; ++column)
+        {
+            const double angle = 0.4 + 0.35 * (row * 4 + column);
+            root.nodes.push_back(AddNode(scene, 0, { -3.0 + 2.0 * column, -2.0 + 2.0 * row, -4.0 }, angle, { 0.48, 0.8, 0.36 }, 0.9));
+        }
+    }
+
+    // A parent node whose transform its children inherit
+    const int group = AddNode(scene, -1, { 0.0, 0.0, -2.5 }, 0.5, { 0.0, 1.0, 0.0 }, 1.0);
+    scene.nodes[group].children.push_back(AddNode(scene, 0, { -1.0, -0.5, 0.0 }, 0.8, { 1.0, 0.0, 0.0 }, 0.6));
+    scene.nodes[group].children.push_back(AddNode(scene, 0, { 1.0, 0.5, 0.0 }, 1.6, { 0.0, 0.0, 1.0 }, 0.6));
+    scene.nodes[group].children.push_back(AddNode(scene, 1, { 0.0, 0.0, -0.5 }, 0.3, { 1.0, 0.0, 0.0 }, 1.5));
+    root.nodes.push_back(group);
+
+    scene.scenes.push_back(root);
+    scene.defaultScene = 0;
+
+    tinygltf::TinyGLTF writer;
+    if (!writer.WriteGltfSceneToFile(&scene, path, true, true, false, true))
+        throw std::runtime_error("Failed to write the test scene: " + path);
+}
+
+// Renders two frames into the framebuffer and returns the pixels of the second, which reuses the state of the first
+static std::vector<uint32_t> RenderFrames(Renderer& renderer, unsigned int framebuffer)
+{
+    std::vector<uint32_t> pixels(FRAME_WIDTH * FRAME_HEIGHT);
+    for (int frame = 0; frame < 2; ++frame)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, FRAME_WIDTH, FRAME_HEIGHT);
+        renderer.RenderFrame();
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glReadPixels(0, 0, FRAME_WIDTH, FRAME_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    if (const GLenum error = glGetError(); error != GL_NO_ERROR)
+        throw std::runtime_error("GL error " + std::to_string(error) + " while rendering.");
+    return pixels;
+}
+
+// Number of pixels that differ between two frames
+static size_t CountDifferences(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+{
+    size_t differences = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        differences += a[i] != b[i];
+    return differences;
+}
+
+int main(int argc, char** argv)
+{
+    const std::string shaderDirectory = argc > 1 ? argv[1] : "../Shaders/";
+    const std::string scenePath = (std::filesystem::temp_directory_path() / "Autumn3DDrawPathTest.glb").string();
+
+    int result = 0;
+    try
+    {
+        WriteTestScene(scenePath);
+
+        Renderer renderer;
+        renderer.SetShaderDirectory(shaderDirectory);
+        renderer.CreateGLFWWindow(FRAME_WIDTH, FRAME_HEIGHT, false);
+        renderer.InitializeOpenGL();
+        renderer.Load3DModel(scenePath);
+        if (!renderer.IsIndirectDrawingActive())
+            throw std::runtime_error("Indirect drawing is unavailable on " + std::string(reinterpret_cast<const char*>(glGetString(GL_RENDERER))) + ".");
+
+        // The window's default framebuffer may have another size or no pixels at all when hidden
+        unsigned int framebuffer = 0, renderbuffers[2] = {};
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, FRAME_WIDTH, FRAME_HEIGHT);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, FRAME_WIDTH, FRAME_HEIGHT);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            throw std::runtime_error("The test framebuffer is incomplete.");
+
+        renderer.SetGpuCulling(false);
+        renderer.SetIndirectDrawing(false);
+        const std::vector<uint32_t> classic = RenderFrames(renderer, framebuffer);
+
+        renderer.SetIndirectDrawing(true);
+        const std::vector<uint32_t> indirect = RenderFrames(renderer, framebuffer);
+
+        renderer.SetGpuCulling(true);
+        const bool gpuCulling = renderer.IsGpuCullingActive();
+        const std::vector<uint32_t> gpuCulled = gpuCulling ? RenderFrames(renderer, framebuffer) : indirect;
+
+        // The scene fills the frame with several textures; a frame of one colour would compare equal without testing anything
+        const size_t varied = CountDifferences(classic, std::vector<uint32_t>(classic.size(), classic[classic.size() / 2]));
+
+        const size_t indirectDifferences = CountDifferences(classic, indirect);
+        const size_t gpuCulledDifferences = CountDifferences(classic, gpuCulled);
+        std::cout << "Draw paths on " << glGetString(GL_RENDERER) << ": " << indirectDifferences << " pixels differ on the indirect path, "
+            << gpuCulledDifferences << " with GPU culling" << (gpuCulling ? "" : " (unavailable, skipped)") << std::endl;
+
+        if (varied < classic.size() / 8)
+        {
+            std::cerr << "FAILED: the classic path rendered an almost uniform frame." << std::endl;
+            result = 1;
+        }
+        if (indirectDifferences != 0 || gpuCulledDifferences != 0)
+        {
+            std::cerr << "FAILED: the draw paths rendered different frames." << std::endl;
+            result = 1;
+        }
+
+        glDeleteRenderbuffers(2, renderbuffers);
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "FAILED: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    std::error_code error;
+    std::filesystem::remove(scenePath, error);
+    std::filesystem::remove(MeshCache::GetCachePath(scenePath), error);
+
+    if (result == 0)
+        std::cout << "PASSED" << std::endl;
+    return result;
+}
@@ -0,0 +1,124 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// One invocation per candidate command of IndirectDrawList. Both phases test the world bounds of the command's instance;
+// survivors are appended to their call's range of the phase's output with an atomic counter (see GpuCuller.h).
+
+struct DrawData
+{
+    mat4 modelMatrix;
+    vec4 positionOffset;
+    vec4 positionScale;
+    uint material;
+    uint packedVertex;
+    uint instance;
+    uint call;
+};
+
+// DrawElementsIndirectCommand records of five uints
+layout (std430, binding = 0) readonly buffer InputCommands { uint inputCommands[]; };
+layout (std430, binding = 1) readonly buffer InputData { DrawData inputData[]; };
+layout (std430, binding = 2) readonly buffer CallFirsts { uint callFirsts[]; };
+// Minimum and maximum corner per instance; the minimum's w holds the bits of the instance's stable ID
+layout (std430, binding = 3) readonly buffer InstanceBounds { vec4 instanceBounds[]; };
+// Indexed by stable ID, since an instance's position in the draw list changes from frame to frame
+layout (std430, binding = 4) readonly buffer PreviousVisibility { uint previousVisibility[]; };
+layout (std430, binding = 5) writeonly buffer CurrentVisibility { uint currentVisibility[]; };
+layout (std430, binding = 6) writeonly buffer OutputCommands { uint outputCommands[]; };
+layout (std430, binding = 7) writeonly buffer OutputData { DrawData outputData[]; };
+layout (std430, binding = 8) buffer Counters { uint counters[]; };
+
+uniform int phase;          // 0: last frame's visible set, 1: everything else against the Hi-Z pyramid
+uniform int commandCount;
+uniform int callCount;
+uniform mat4 viewProjection;
+uniform vec4 frustumPlanes[6];
+uniform vec2 screenSize;
+uniform int hiZLevels;
+uniform sampler2D hiZ;      // farthest depth per texel, level 0 at screen resolution
+
+bool IsInFrustum(vec3 boxMin, vec3 boxMax)
+{
+    if (any(greaterThan(boxMin, boxMax)))
+        return false;
+
+    // The box is outside once its corner farthest along a plane normal is behind the plane
+    for (int i = 0; i < 6; ++i)
+    {
+        vec3 corner = mix(boxMin, boxMax, greaterThanEqual(frustumPlanes[i].xyz, vec3(0.0)));
+        if (dot(frustumPlanes[i].xyz, corner) + frustumPlanes[i].w < 0.0)
+            return false;
+    }
+    return true;
+}
+
+bool IsOccluded(vec3 boxMin, vec3 boxMax)
+{
+    // Screen rectangle and nearest depth of the box; boxes crossing the near plane are never occluded
+    vec2 rectMin = vec2(1.0), rectMax = vec2(0.0);
+    float nearestDepth = 1.0;
+    for (int i = 0; i < 8; ++i)
+    {
+        vec3 corner = vec3((i & 1) != 0 ? boxMax.x : boxMin.x, (i & 2) != 0 ? boxMax.y : boxMin.y, (i & 4) != 0 ? boxMax.z : boxMin.z);
+        vec4 clip = viewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        rectMin = min(rectMin, ndc.xy * 0.5 + 0.5);
+        rectMax = max(rectMax, ndc.xy * 0.5 + 0.5);
+        nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+    }
+    vec2 pixelMin = clamp(rectMin, 0.0, 1.0) * screenSize;
+    vec2 pixelMax = clamp(rectMax, 0.0, 1.0) * screenSize;
+
+    // The level where the rectangle spans at most 2x2 texels
+    float extent = max(pixelMax.x - pixelMin.x, pixelMax.y - pixelMin.y);
+    int level = clamp(int(ceil(log2(max(extent, 1.0)))), 0, hiZLevels - 1);
+    // Not textureSize(): some drivers return the size of one invocation's level for the whole group
+    ivec2 levelSize = max(ivec2(screenSize) >> level, ivec2(1));
+    ivec2 texelMin = clamp(ivec2(pixelMin) >> level, ivec2(0), levelSize - 1);
+    ivec2 texelMax = clamp(ivec2(pixelMax) >> level, ivec2(0), min(levelSize - 1, texelMin + 1));
+
+    float farthestDepth = 0.0;
+    for (int y = texelMin.y; y <= texelMax.y; ++y)
+        for (int x = texelMin.x; x <= texelMax.x; ++x)
+            farthestDepth = max(farthestDepth, texelFetch(hiZ, ivec2(x, y), level).r);
+    return nearestDepth > farthestDepth;
+}
+
+void Emit(uint command, uint call)
+{
+    uint slot = uint(phase * commandCount) + callFirsts[call] + atomicAdd(counters[phase * callCount + int(call)], 1u);
+    for (uint i = 0u; i < 5u; ++i)
+        outputCommands[slot * 5u + i] = inputCommands[command * 5u + i];
+    outputData[slot] = inputData[command];
+}
+
+void main()
+{
+    uint command = gl_GlobalInvocationID.x;
+    if (command >= uint(commandCount))
+        return;
+
+    DrawData draw = inputData[command];
+    vec4 boundsMin = instanceBounds[draw.instance * 2u];
+    vec3 boxMin = boundsMin.xyz;
+    vec3 boxMax = instanceBounds[draw.instance * 2u + 1u].xyz;
+    uint id = floatBitsToUint(boundsMin.w);
+    bool inFrustum = IsInFrustum(boxMin, boxMax);
+    bool drawnInPhase1 = inFrustum && previousVisibility[id] != 0u;
+
+    if (phase == 0)
+    {
+        if (drawnInPhase1)
+            Emit(command, draw.call);
+        return;
+    }
+
+    // Every command of an instance computes the same visibility, so the duplicate writes agree
+    bool visible = inFrustum && !IsOccluded(boxMin, boxMax);
+    if (visible)
+        currentVisibility[id] = 1u;
+    if (visible && !drawnInPhase1)
+        Emit(command, draw.call);
+}
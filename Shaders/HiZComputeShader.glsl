@@ -0,0 +1,33 @@
+#version 430 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// Builds one level of the Hi-Z pyramid (see GpuCuller.h). Every texel keeps the farthest depth of the texels it covers
+// in the level above, including the extra row and column when that level has an odd size, so tests stay conservative.
+
+uniform bool copyDepth;          // level 0: copy the depth texture
+uniform sampler2D depthTexture;
+layout (r32f, binding = 0) readonly uniform image2D sourceLevel;
+layout (r32f, binding = 1) writeonly uniform image2D targetLevel;
+
+void main()
+{
+    ivec2 target = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 targetSize = imageSize(targetLevel);
+    if (any(greaterThanEqual(target, targetSize)))
+        return;
+
+    if (copyDepth)
+    {
+        imageStore(targetLevel, target, vec4(texelFetch(depthTexture, target, 0).r));
+        return;
+    }
+
+    ivec2 sourceSize = imageSize(sourceLevel);
+    ivec2 first = target * 2;
+    ivec2 last = min(first + 1 + ivec2(equal(target, targetSize - 1)) * (sourceSize & 1), sourceSize - 1);
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; ++y)
+        for (int x = first.x; x <= last.x; ++x)
+            depth = max(depth, imageLoad(sourceLevel, ivec2(x, y)).r);
+    imageStore(targetLevel, target, vec4(depth));
+}
@@ -0,0 +1,63 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+layout (location = 0) in vec4 aPos;       // full: xyz; packed: unorm16 in the mesh bounds, w = bitangent sign
+layout (location = 1) in vec4 aNormal;    // full: xyz; packed: octahedral xy
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec4 aTangent;   // full: xyz; packed: octahedral xy
+layout (location = 4) in vec3 aBitangent; // full layout only
+
+out vec2 m_TexCoords;
+out vec3 m_Normal;
+out vec3 m_Tangent;
+out vec3 m_Bitangent;
+
+// Per-draw data written by IndirectDrawList, one entry per indirect command
+struct DrawData
+{
+    mat4 modelMatrix;
+    vec4 positionOffset; // compact vertex layouts (see VertexFormat.h); full vertices use a scale of 1 and an offset of 0
+    vec4 positionScale;
+    uint material;
+    uint packedVertex;
+    uint instance;       // tested by GPU culling
+    uint call;
+};
+
+layout (std430, binding = 0) readonly buffer DrawDataBuffer
+{
+    DrawData draws[];
+};
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+uniform int drawOffset; // first command of the current glMultiDrawElementsIndirect call
+
+vec3 DecodeOctahedral(vec2 encoded)
+{
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (direction.z < 0.0)
+        direction.xy = (1.0 - abs(direction.yx)) * vec2(direction.x >= 0.0 ? 1.0 : -1.0, direction.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(direction);
+}
+
+void main()
+{
+    DrawData draw = draws[drawOffset + gl_DrawIDARB];
+    vec3 position = draw.positionOffset.xyz + draw.positionScale.xyz * aPos.xyz;
+
+    if (draw.packedVertex != 0u)
+    {
+        m_Normal = DecodeOctahedral(aNormal.xy);
+        m_Tangent = DecodeOctahedral(aTangent.xy);
+        m_Bitangent = cross(m_Normal, m_Tangent) * (aPos.w * 2.0 - 1.0);
+    }
+    else
+    {
+        m_Normal = aNormal.xyz;
+        m_Tangent = aTangent.xyz;
+        m_Bitangent = aBitangent;
+    }
+
+    m_TexCoords = aTexCoords;
+    gl_Position = projectionMatrix * viewMatrix * draw.modelMatrix * vec4(position, 1.0);
+}
@@ -1,16 +1,49 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 0) in vec4 aPos;       // full: xyz; packed: unorm16 in the mesh bounds, w = bitangent sign
+layout (location = 1) in vec4 aNormal;    // full: xyz; packed: octahedral xy
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec4 aTangent;   // full: xyz; packed: octahedral xy
+layout (location = 4) in vec3 aBitangent; // full layout only
 
 out vec2 m_TexCoords;
+out vec3 m_Normal;
+out vec3 m_Tangent;
+out vec3 m_Bitangent;
 
 uniform mat4 modelMatrix;
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
 
+// Compact vertex layouts (see VertexFormat.h). Full vertices use a scale of 1 and an offset of 0.
+uniform bool packedVertex;
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+vec3 DecodeOctahedral(vec2 encoded)
+{
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (direction.z < 0.0)
+        direction.xy = (1.0 - abs(direction.yx)) * vec2(direction.x >= 0.0 ? 1.0 : -1.0, direction.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(direction);
+}
+
 void main()
 {
-    m_TexCoords = aTexCoords;    
-    gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    vec3 position = positionOffset + positionScale * aPos.xyz;
+
+    if (packedVertex)
+    {
+        m_Normal = DecodeOctahedral(aNormal.xy);
+        m_Tangent = DecodeOctahedral(aTangent.xy);
+        m_Bitangent = cross(m_Normal, m_Tangent) * (aPos.w * 2.0 - 1.0);
+    }
+    else
+    {
+        m_Normal = aNormal.xyz;
+        m_Tangent = aTangent.xyz;
+        m_Bitangent = aBitangent;
+    }
+
+    m_TexCoords = aTexCoords;
+    gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(position, 1.0);
+}